@@ -2,6 +2,7 @@
 
 #include "SDL/SDL.hpp"
 #include "console.hpp"
+#include "asyncloader.hpp"
 #include "camera.hpp"
 #include "render/vulkan/vulkan_renderer.hpp"
 
@@ -20,6 +21,9 @@ void MainLoop(CVulkanRenderer& renderer) {
         deltaTime = static_cast<float>(currentFrame) - lastFrame;
         lastFrame = static_cast<float>(currentFrame);
 
+        // Completion callbacks of async loads run on the main thread, between frames
+        AsyncLoader()->DispatchCallbacks();
+
         const bool* keyState = SDL_GetKeyboardState(nullptr);
         if (keyState[SDL_SCANCODE_W]) {
             g_camera.ProcessKeyboard(FORWARD, deltaTime);
@@ -36,6 +40,15 @@ void MainLoop(CVulkanRenderer& renderer) {
         if (keyState[SDL_SCANCODE_ESCAPE]) {
             quit = true;
         }
+        if (keyState[SDL_SCANCODE_F1]) {
+            renderer.SetPresentPolicy(EPresentPolicy::LowLatency);
+        }
+        if (keyState[SDL_SCANCODE_F2]) {
+            renderer.SetPresentPolicy(EPresentPolicy::Throughput);
+        }
+        if (keyState[SDL_SCANCODE_F3]) {
+            renderer.SetPresentPolicy(EPresentPolicy::PowerSaving);
+        }
         if (keyState[SDL_SCANCODE_LSHIFT]) {
             g_camera.MoveFaster();
         } else {
@@ -56,7 +69,7 @@ void MainLoop(CVulkanRenderer& renderer) {
                 minimized = false;
                 break;
             case SDL_EVENT_WINDOW_RESIZED:
-                //renderer.m_frameBufferResized = true;
+                renderer.m_frameBufferResized = true;
                 break;
             case SDL_EVENT_MOUSE_MOTION:
                 g_camera.ProcessMouseMovement(e.motion.xrel, -e.motion.yrel);
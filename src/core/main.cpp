@@ -2,7 +2,10 @@
 #include "launcher.hpp"
 #include "publicapi.hpp"
 #include "console.hpp"
+#include "deriveddatacache.hpp"
+#include "resourceloader.hpp"
 #include "SDL/SDL.hpp"
+#include "tools/tools.hpp"
 
 #ifdef PLATFORM_WINDOWS
 #include <windows.h>
@@ -53,8 +56,18 @@ DLL_EXPORT int CoreInit(const int argc, char* argv[]) {
     SetupConsole();
 #endif
 
+    if (Tools::Run()) {
+        return 0;
+    }
+
+    resource_loader::MountPacks();
+    if (const int ddcParam = CommandLine()->FindParam("-ddc")) {
+        DerivedDataCache()->SetDirectory(CommandLine()->GetParam(ddcParam + 1));
+    }
+
     CLauncher launcher;
     launcher.Run();
+    DerivedDataCache()->PrintStatistics();
 
     Msg << "Press Enter to exit.";
     std::cin.ignore();
@@ -0,0 +1,339 @@
+#include "cooked_mesh.hpp"
+
+#include "index_compaction.hpp"
+#include "mesh_lod.hpp"
+#include "mesh_optimizer.hpp"
+#include "obj_importer.hpp"
+
+#include "atomicfile.hpp"
+#include "console.hpp"
+#include "resourceloader.hpp"
+
+#include <cstring>
+#include <format>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+
+namespace Mesh
+{
+namespace
+{
+struct CSectionBlob
+{
+    ECookedMeshSection type;
+    uint32_t elementCount;
+    std::span<const std::byte> data;
+};
+
+uint64_t AlignUp(const uint64_t value, const uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void CookImportedMesh(
+    CMeshData mesh,
+    const std::string_view name,
+    const std::filesystem::path& destination,
+    const CMeshCookOptions& options
+) {
+    const std::size_t sourceBytes = mesh.vertices.size() * sizeof(CVertex) + mesh.indices.size() * sizeof(uint32_t);
+
+    GenerateLods(mesh, options.lodCount);
+    OptimizeMesh(mesh, options.optimizeOverdraw);
+
+    const EIndexFormat indexFormat = CompactIndices(mesh, GetVertexFormatStride(options.vertexFormat));
+    const std::vector<CMeshlet> meshlets = options.buildMeshlets ? BuildMeshlets(mesh) : std::vector<CMeshlet> {};
+    WriteCookedMesh(destination, mesh, options.vertexFormat, indexFormat, meshlets);
+
+    Msg(
+        "Cooked \"{}\" -> \"{}\": {} vertices, {} indices in {} LODs, {} submeshes and {} meshlets, {}-bit indices, "
+        "{} -> {} bytes",
+        name,
+        destination.string(),
+        mesh.vertices.size(),
+        mesh.indices.size(),
+        mesh.lods.size(),
+        mesh.submeshes.size(),
+        meshlets.size(),
+        GetIndexFormatSize(indexFormat) * 8,
+        sourceBytes,
+        mesh.vertices.size() * GetVertexFormatStride(options.vertexFormat) +
+            mesh.indices.size() * GetIndexFormatSize(indexFormat)
+    );
+}
+}
+
+bool CCookedMesh::Load(const std::filesystem::path& path) {
+    m_sections = {};
+    m_vertices = nullptr;
+    m_indices = nullptr;
+    m_submeshes = {};
+    m_meshlets = {};
+    m_lods = {};
+
+    if (!m_file.Open(path)) {
+        return false;
+    }
+
+    const auto fail = [&](const std::string_view reason) {
+        Warning("Cooked mesh \"{}\" is ignored: {}", path.string(), reason);
+        m_file.Close();
+        m_sections = {};
+        m_vertices = nullptr;
+        m_indices = nullptr;
+        m_submeshes = {};
+        m_meshlets = {};
+        m_lods = {};
+        return false;
+    };
+
+    const std::span<const std::byte> view = m_file.GetView();
+    if (view.size() < sizeof(CCookedMeshHeader)) {
+        return fail("file is truncated");
+    }
+
+    std::memcpy(&m_header, view.data(), sizeof(m_header));
+    if (m_header.magic != COOKED_MESH_MAGIC) {
+        return fail("not a cooked mesh");
+    }
+    if (m_header.version != COOKED_MESH_VERSION) {
+        return fail("cooked by another version");
+    }
+    if (m_header.vertexFormat > EVertexFormat::Snorm16 ||
+        m_header.vertexStride != GetVertexFormatStride(m_header.vertexFormat)) {
+        return fail("unknown vertex layout");
+    }
+    if (m_header.indexFormat > EIndexFormat::Uint32) {
+        return fail("unknown index format");
+    }
+
+    const uint64_t tableEnd = sizeof(CCookedMeshHeader) + sizeof(CCookedMeshSection) * uint64_t { m_header.sectionCount };
+    if (view.size() < tableEnd) {
+        return fail("section table is truncated");
+    }
+
+    // File mappings are page aligned, so the table can be used in place
+    m_sections = {
+        reinterpret_cast<const CCookedMeshSection*>(view.data() + sizeof(CCookedMeshHeader)),
+        m_header.sectionCount
+    };
+
+    for (const CCookedMeshSection& section : m_sections) {
+        if (section.offset % COOKED_MESH_ALIGNMENT != 0 || section.offset > view.size() ||
+            section.size > view.size() - section.offset) {
+            return fail("section is out of bounds");
+        }
+    }
+
+    m_vertices = _FindSection(ECookedMeshSection::Vertices);
+    m_indices = _FindSection(ECookedMeshSection::Indices);
+    if (!m_vertices || !m_indices) {
+        return fail("vertex or index data is missing");
+    }
+    if (m_vertices->size != uint64_t { m_vertices->elementCount } * m_header.vertexStride ||
+        m_indices->size != uint64_t { m_indices->elementCount } * GetIndexSize()) {
+        return fail("vertex or index data is malformed");
+    }
+
+    const CCookedMeshSection* quantization = _FindSection(ECookedMeshSection::Quantization);
+    if (!quantization || quantization->size != sizeof(CVertexQuantization)) {
+        return fail("vertex quantization is missing");
+    }
+    std::memcpy(&m_quantization, _GetBlob(*quantization).data(), sizeof(m_quantization));
+
+    const CCookedMeshSection* submeshes = _FindSection(ECookedMeshSection::Submeshes);
+    if (!submeshes || submeshes->elementCount == 0 ||
+        submeshes->size != uint64_t { submeshes->elementCount } * sizeof(CSubmesh)) {
+        return fail("submeshes are missing");
+    }
+    m_submeshes = {
+        reinterpret_cast<const CSubmesh*>(_GetBlob(*submeshes).data()),
+        submeshes->elementCount
+    };
+    for (const CSubmesh& submesh : m_submeshes) {
+        const uint64_t indexEnd = uint64_t { submesh.firstIndex } + submesh.indexCount;
+        const int64_t vertexEnd = int64_t { submesh.vertexOffset } + submesh.vertexCount;
+        if (indexEnd > m_indices->elementCount || submesh.vertexOffset < 0 || vertexEnd > m_vertices->elementCount) {
+            return fail("submesh is out of bounds");
+        }
+    }
+
+    if (const CCookedMeshSection* meshlets = _FindSection(ECookedMeshSection::Meshlets)) {
+        if (meshlets->size != uint64_t { meshlets->elementCount } * sizeof(CMeshlet)) {
+            return fail("meshlets are malformed");
+        }
+        m_meshlets = {
+            reinterpret_cast<const CMeshlet*>(_GetBlob(*meshlets).data()),
+            meshlets->elementCount
+        };
+        for (const CMeshlet& meshlet : m_meshlets) {
+            const uint64_t indexEnd = uint64_t { meshlet.firstIndex } + meshlet.indexCount;
+            if (indexEnd > m_indices->elementCount || meshlet.vertexOffset < 0 ||
+                meshlet.vertexOffset > int64_t { m_vertices->elementCount }) {
+                return fail("meshlet is out of bounds");
+            }
+        }
+    }
+
+    const CCookedMeshSection* lods = _FindSection(ECookedMeshSection::Lods);
+    if (!lods || lods->elementCount == 0 || lods->size != uint64_t { lods->elementCount } * sizeof(CMeshLod)) {
+        return fail("LODs are missing");
+    }
+    m_lods = {
+        reinterpret_cast<const CMeshLod*>(_GetBlob(*lods).data()),
+        lods->elementCount
+    };
+    for (const CMeshLod& lod : m_lods) {
+        if (uint64_t { lod.firstSubmesh } + lod.submeshCount > m_submeshes.size() ||
+            uint64_t { lod.firstMeshlet } + lod.meshletCount > m_meshlets.size()) {
+            return fail("LOD is out of bounds");
+        }
+    }
+
+    const CCookedMeshSection* bounds = _FindSection(ECookedMeshSection::Bounds);
+    if (!bounds || bounds->size != sizeof(glm::vec4)) {
+        return fail("bounds are missing");
+    }
+    std::memcpy(&m_boundingSphere, _GetBlob(*bounds).data(), sizeof(m_boundingSphere));
+
+    return true;
+}
+
+const CCookedMeshSection* CCookedMesh::_FindSection(const ECookedMeshSection type) const {
+    for (const CCookedMeshSection& section : m_sections) {
+        if (section.type == type) {
+            return &section;
+        }
+    }
+    return nullptr;
+}
+
+void WriteCookedMesh(
+    const std::filesystem::path& path,
+    const CMeshData& mesh,
+    const EVertexFormat vertexFormat,
+    const EIndexFormat indexFormat,
+    const std::span<const CMeshlet> meshlets
+) {
+    const CVertexQuantization quantization = ComputeVertexQuantization(mesh.vertices, vertexFormat);
+    const std::vector<std::byte> vertices = EncodeVertices(mesh.vertices, vertexFormat, quantization);
+    const std::vector<std::byte> indices = EncodeIndices(mesh.indices, indexFormat);
+    const glm::vec4 boundingSphere = ComputeBoundingSphere(mesh.vertices);
+
+    const std::vector<CMeshLod> lods = mesh.lods.empty()
+        ? std::vector<CMeshLod> {
+              { 0, static_cast<uint32_t>(mesh.submeshes.size()), 0, static_cast<uint32_t>(meshlets.size()), 0.0f }
+          }
+        : mesh.lods;
+
+    std::vector<CSectionBlob> blobs = {
+        {
+            ECookedMeshSection::Vertices,
+            static_cast<uint32_t>(mesh.vertices.size()),
+            vertices
+        },
+        {
+            ECookedMeshSection::Indices,
+            static_cast<uint32_t>(mesh.indices.size()),
+            indices
+        },
+        {
+            ECookedMeshSection::Quantization,
+            1,
+            std::as_bytes(std::span(&quantization, 1))
+        },
+        {
+            ECookedMeshSection::Submeshes,
+            static_cast<uint32_t>(mesh.submeshes.size()),
+            std::as_bytes(std::span(mesh.submeshes))
+        },
+    };
+    if (!meshlets.empty()) {
+        blobs.push_back({ ECookedMeshSection::Meshlets, static_cast<uint32_t>(meshlets.size()), std::as_bytes(meshlets) });
+    }
+    blobs.push_back({ ECookedMeshSection::Lods, static_cast<uint32_t>(lods.size()), std::as_bytes(std::span(lods)) });
+    blobs.push_back({ ECookedMeshSection::Bounds, 1, std::as_bytes(std::span(&boundingSphere, 1)) });
+
+    CCookedMeshHeader header {};
+    header.magic = COOKED_MESH_MAGIC;
+    header.version = COOKED_MESH_VERSION;
+    header.sectionCount = static_cast<uint32_t>(blobs.size());
+    header.vertexStride = GetVertexFormatStride(vertexFormat);
+    header.vertexFormat = vertexFormat;
+    header.indexFormat = indexFormat;
+
+    std::vector<CCookedMeshSection> sections;
+    uint64_t offset = AlignUp(sizeof(header) + sizeof(CCookedMeshSection) * blobs.size(), COOKED_MESH_ALIGNMENT);
+    for (const CSectionBlob& blob : blobs) {
+        sections.push_back({ blob.type, blob.elementCount, offset, blob.data.size() });
+        offset = AlignUp(offset + blob.data.size(), COOKED_MESH_ALIGNMENT);
+    }
+
+    const bool written = WriteFileAtomically(path, [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(sections.data()), sizeof(CCookedMeshSection) * sections.size());
+
+        uint64_t position = sizeof(header) + sizeof(CCookedMeshSection) * sections.size();
+        constexpr char padding[COOKED_MESH_ALIGNMENT] = {};
+        for (std::size_t i = 0; i < blobs.size(); ++i) {
+            file.write(padding, static_cast<std::streamsize>(sections[i].offset - position));
+            file.write(reinterpret_cast<const char*>(blobs[i].data.data()), static_cast<std::streamsize>(blobs[i].data.size()));
+            position = sections[i].offset + sections[i].size;
+        }
+    });
+    if (!written) {
+        throw std::runtime_error(std::format("Failed to write cooked mesh \"{}\"!", path.string()));
+    }
+}
+
+void CookMesh(
+    const std::filesystem::path& source,
+    const std::filesystem::path& destination,
+    const CMeshCookOptions& options
+) {
+    CookImportedMesh(ImportObj(source), source.string(), destination, options);
+}
+
+void CookMesh(
+    const std::span<const std::byte> source,
+    const std::string_view name,
+    const std::filesystem::path& destination,
+    const CMeshCookOptions& options
+) {
+    CookImportedMesh(ImportObj(source, name), name, destination, options);
+}
+
+CDerivedDataKey GetMeshCookKey(const std::span<const std::byte> source, const CMeshCookOptions& options) {
+    CDerivedDataKey key("mesh", MESH_COOKER_VERSION);
+    key.Add(COOKED_MESH_VERSION)
+        .Add(source)
+        .Add(options.optimizeOverdraw)
+        .Add(options.vertexFormat)
+        .Add(options.buildMeshlets)
+        .Add(options.lodCount);
+    return key;
+}
+
+bool LoadCachedMesh(CCookedMesh& mesh, const std::string_view source, const CMeshCookOptions& options) {
+    const CMappedFile file = resource_loader::MapFile(source);
+    if (!file.IsOpen()) {
+        return false;
+    }
+    const CDerivedDataKey key = GetMeshCookKey(file.GetView(), options);
+
+    // Cooked from the same bytes the key hashes, the source may live in a pack
+    const auto cook = [&](const std::filesystem::path& destination) {
+        CookMesh(file.GetView(), source, destination, options);
+    };
+    if (mesh.Load(DerivedDataCache()->Get(key, cook))) {
+        return true;
+    }
+
+    // Damaged entry, or one left by a cooker change that forgot to bump MESH_COOKER_VERSION
+    DerivedDataCache()->Invalidate(key);
+    if (!mesh.Load(DerivedDataCache()->Get(key, cook))) {
+        throw std::runtime_error(std::format("Failed to load freshly cooked mesh \"{}\"!", source));
+    }
+    return true;
+}
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "mesh.hpp"
+#include "meshlets.hpp"
+#include "vertex_quantization.hpp"
+
+#include "deriveddatacache.hpp"
+#include "mappedfile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace Mesh
+{
+// Cooked mesh file layout:
+// [CCookedMeshHeader][CCookedMeshSection x sectionCount][section blobs]
+// Every blob starts at COOKED_MESH_ALIGNMENT and is stored exactly as the GPU consumes it,
+// so loading is a file mapping plus one memcpy per buffer into staging memory.
+constexpr uint32_t COOKED_MESH_MAGIC = 0x48534D53; // "SMSH"
+constexpr uint32_t COOKED_MESH_VERSION = 6;
+// Bump when cooking writes different data in the same format, e.g. after an importer or optimizer change,
+// so derived data cached by the old code is rebuilt
+constexpr uint32_t MESH_COOKER_VERSION = 1;
+constexpr uint64_t COOKED_MESH_ALIGNMENT = 16;
+
+enum class ECookedMeshSection : uint32_t
+{
+    Vertices = 0,
+    Indices = 1,
+    // Single CVertexQuantization
+    Quantization = 2,
+    // CSubmesh array covering all indices
+    Submeshes = 3,
+    // CMeshlet array covering all indices, optional
+    Meshlets = 4,
+    // CMeshLod array, full detail first
+    Lods = 5,
+    // Bounding sphere as glm::vec4
+    Bounds = 6,
+};
+
+struct CCookedMeshHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t vertexStride;
+    EVertexFormat vertexFormat;
+    EIndexFormat indexFormat;
+};
+
+struct CCookedMeshSection
+{
+    ECookedMeshSection type;
+    uint32_t elementCount;
+    uint64_t offset;
+    uint64_t size;
+};
+
+class CCookedMesh
+{
+public:
+    // Maps a cooked file. Returns false if it is missing, corrupted or cooked by another version.
+    bool Load(const std::filesystem::path& path);
+
+    [[nodiscard]] EVertexFormat GetVertexFormat() const { return m_header.vertexFormat; }
+    [[nodiscard]] uint32_t GetVertexStride() const { return m_header.vertexStride; }
+    [[nodiscard]] uint32_t GetVertexCount() const { return m_vertices->elementCount; }
+    [[nodiscard]] std::span<const std::byte> GetVertexData() const { return _GetBlob(*m_vertices); }
+
+    [[nodiscard]] EIndexFormat GetIndexFormat() const { return m_header.indexFormat; }
+    [[nodiscard]] uint32_t GetIndexCount() const { return m_indices->elementCount; }
+    [[nodiscard]] uint32_t GetIndexSize() const { return GetIndexFormatSize(m_header.indexFormat); }
+    [[nodiscard]] std::span<const std::byte> GetIndexData() const { return _GetBlob(*m_indices); }
+
+    [[nodiscard]] std::span<const CSubmesh> GetSubmeshes() const { return m_submeshes; }
+
+    // Empty if the mesh was cooked without meshlets
+    [[nodiscard]] std::span<const CMeshlet> GetMeshlets() const { return m_meshlets; }
+
+    // At least one level
+    [[nodiscard]] std::span<const CMeshLod> GetLods() const { return m_lods; }
+    [[nodiscard]] std::span<const CSubmesh> GetLodSubmeshes(const CMeshLod& lod) const {
+        return m_submeshes.subspan(lod.firstSubmesh, lod.submeshCount);
+    }
+
+    [[nodiscard]] const glm::vec4& GetBoundingSphere() const { return m_boundingSphere; }
+
+    [[nodiscard]] const CVertexQuantization& GetQuantization() const { return m_quantization; }
+
+private:
+    [[nodiscard]] const CCookedMeshSection* _FindSection(ECookedMeshSection type) const;
+    [[nodiscard]] std::span<const std::byte> _GetBlob(const CCookedMeshSection& section) const {
+        return m_file.GetView().subspan(section.offset, section.size);
+    }
+
+    CMappedFile m_file;
+    CCookedMeshHeader m_header {};
+    std::span<const CCookedMeshSection> m_sections;
+    const CCookedMeshSection* m_vertices = nullptr;
+    const CCookedMeshSection* m_indices = nullptr;
+    std::span<const CSubmesh> m_submeshes;
+    std::span<const CMeshlet> m_meshlets;
+    std::span<const CMeshLod> m_lods;
+    CVertexQuantization m_quantization {};
+    glm::vec4 m_boundingSphere {};
+};
+
+struct CMeshCookOptions
+{
+    // Sort triangle clusters front to back at a small vertex cache cost
+    bool optimizeOverdraw = true;
+    EVertexFormat vertexFormat = EVertexFormat::Snorm16;
+    // Split submeshes into meshlets for GPU culling
+    bool buildMeshlets = true;
+    // Levels of detail including the full mesh, up to MAX_LOD_COUNT
+    uint32_t lodCount = 4;
+};
+
+// Mesh must be prepared with CompactIndices, so it has submeshes and indices fitting `indexFormat`.
+// Meshlets section is omitted if `meshlets` is empty. A mesh without LODs is written as a single level.
+void WriteCookedMesh(
+    const std::filesystem::path& path,
+    const CMeshData& mesh,
+    EVertexFormat vertexFormat,
+    EIndexFormat indexFormat,
+    std::span<const CMeshlet> meshlets = {}
+);
+
+// Imports source asset, optimizes it for the GPU and writes cooked file
+void CookMesh(
+    const std::filesystem::path& source,
+    const std::filesystem::path& destination,
+    const CMeshCookOptions& options = {}
+);
+// Same, from source file contents already in memory. `name` only shows up in logs and errors.
+void CookMesh(
+    std::span<const std::byte> source,
+    std::string_view name,
+    const std::filesystem::path& destination,
+    const CMeshCookOptions& options = {}
+);
+
+// Derived data cache key of cooking `source`, which holds the source file's contents
+CDerivedDataKey GetMeshCookKey(std::span<const std::byte> source, const CMeshCookOptions& options);
+
+// Loads the cooked result of `source` from DerivedDataCache(), cooking it on a miss.
+// Returns false if the source doesn't exist.
+// \param source UTF-8 encoded path to file from the application's root
+bool LoadCachedMesh(CCookedMesh& mesh, std::string_view source, const CMeshCookOptions& options = {});
+}
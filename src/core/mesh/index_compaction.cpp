@@ -0,0 +1,121 @@
+#include "index_compaction.hpp"
+
+#include <cstring>
+
+namespace Mesh
+{
+namespace
+{
+CSubmesh WholeMesh(const CMeshData& mesh) {
+    return { 0, static_cast<uint32_t>(mesh.indices.size()), 0, static_cast<uint32_t>(mesh.vertices.size()) };
+}
+
+struct CSplitMesh
+{
+    std::vector<CVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<CSubmesh> submeshes;
+    // First resulting submesh of every source submesh, plus the total count
+    std::vector<uint32_t> sourceSubmeshStarts;
+};
+
+// Walks triangles in their optimized order and starts a new submesh whenever the next triangle
+// would reference more than MAX_SHORT_INDEX_VERTICES vertices. Vertices used by several submeshes are duplicated.
+CSplitMesh SplitMesh(const CMeshData& mesh) {
+    constexpr uint32_t NO_SUBMESH = UINT32_MAX;
+
+    CSplitMesh result;
+    result.indices.reserve(mesh.indices.size());
+
+    std::vector<uint32_t> owner(mesh.vertices.size(), NO_SUBMESH);
+    std::vector<uint32_t> localIndex(mesh.vertices.size());
+
+    for (const CSubmesh& source : mesh.submeshes) {
+        result.sourceSubmeshStarts.push_back(static_cast<uint32_t>(result.submeshes.size()));
+
+        CSubmesh submesh {};
+        submesh.firstIndex = static_cast<uint32_t>(result.indices.size());
+        submesh.vertexOffset = static_cast<int32_t>(result.vertices.size());
+        auto submeshId = static_cast<uint32_t>(result.submeshes.size());
+        for (std::size_t i = source.firstIndex; i < source.firstIndex + source.indexCount; i += 3) {
+            const uint32_t* triangle = &mesh.indices[i];
+
+            uint32_t newVertices = 0;
+            for (uint32_t corner = 0; corner < 3; ++corner) {
+                const bool repeated = (corner > 0 && triangle[corner] == triangle[0]) ||
+                                      (corner > 1 && triangle[corner] == triangle[1]);
+                if (owner[triangle[corner]] != submeshId && !repeated) {
+                    ++newVertices;
+                }
+            }
+
+            if (submesh.vertexCount + newVertices > MAX_SHORT_INDEX_VERTICES) {
+                result.submeshes.push_back(submesh);
+                submesh = {};
+                submesh.firstIndex = static_cast<uint32_t>(result.indices.size());
+                submesh.vertexOffset = static_cast<int32_t>(result.vertices.size());
+                submeshId = static_cast<uint32_t>(result.submeshes.size());
+            }
+
+            for (uint32_t corner = 0; corner < 3; ++corner) {
+                const uint32_t vertex = triangle[corner];
+                if (owner[vertex] != submeshId) {
+                    owner[vertex] = submeshId;
+                    localIndex[vertex] = submesh.vertexCount++;
+                    result.vertices.push_back(mesh.vertices[vertex]);
+                }
+                result.indices.push_back(localIndex[vertex]);
+            }
+            submesh.indexCount += 3;
+        }
+        result.submeshes.push_back(submesh);
+    }
+    result.sourceSubmeshStarts.push_back(static_cast<uint32_t>(result.submeshes.size()));
+
+    return result;
+}
+}
+
+EIndexFormat CompactIndices(CMeshData& mesh, const uint32_t vertexStride) {
+    if (mesh.submeshes.empty()) {
+        mesh.submeshes = { WholeMesh(mesh) };
+    }
+
+    if (mesh.vertices.size() <= MAX_SHORT_INDEX_VERTICES) {
+        return EIndexFormat::Uint16;
+    }
+
+    CSplitMesh split = SplitMesh(mesh);
+
+    const std::size_t duplicatedBytes = (split.vertices.size() - mesh.vertices.size()) * vertexStride;
+    const std::size_t savedBytes = mesh.indices.size() * (sizeof(uint32_t) - sizeof(uint16_t));
+    if (duplicatedBytes >= savedBytes) {
+        return EIndexFormat::Uint32;
+    }
+
+    for (CMeshLod& lod : mesh.lods) {
+        const uint32_t firstSubmesh = split.sourceSubmeshStarts[lod.firstSubmesh];
+        lod.submeshCount = split.sourceSubmeshStarts[lod.firstSubmesh + lod.submeshCount] - firstSubmesh;
+        lod.firstSubmesh = firstSubmesh;
+    }
+
+    mesh.vertices = std::move(split.vertices);
+    mesh.indices = std::move(split.indices);
+    mesh.submeshes = std::move(split.submeshes);
+    return EIndexFormat::Uint16;
+}
+
+std::vector<std::byte> EncodeIndices(const std::span<const uint32_t> indices, const EIndexFormat format) {
+    if (format == EIndexFormat::Uint32) {
+        const std::span<const std::byte> bytes = std::as_bytes(indices);
+        return { bytes.begin(), bytes.end() };
+    }
+
+    std::vector<std::byte> result(indices.size() * sizeof(uint16_t));
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        const auto index = static_cast<uint16_t>(indices[i]);
+        std::memcpy(result.data() + i * sizeof(uint16_t), &index, sizeof(index));
+    }
+    return result;
+}
+}
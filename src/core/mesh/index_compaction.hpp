@@ -0,0 +1,23 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Mesh
+{
+// Vertices addressable by a 16-bit index
+constexpr uint32_t MAX_SHORT_INDEX_VERTICES = 65536;
+
+// Chooses index width of the mesh. Meshes with more than MAX_SHORT_INDEX_VERTICES vertices are split into
+// submeshes with local indices when the vertices duplicated along the splits cost less than the index memory saved.
+// Otherwise the mesh keeps 32-bit indices. Existing submeshes (LOD levels) are split separately and mesh.lods
+// is updated to the resulting ranges; a mesh without submeshes is treated as one.
+EIndexFormat CompactIndices(CMeshData& mesh, uint32_t vertexStride);
+
+// Converts indices to `format`. Every index must fit into it.
+std::vector<std::byte> EncodeIndices(std::span<const uint32_t> indices, EIndexFormat format);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "vertex.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace Mesh
+{
+enum class EIndexFormat : uint32_t
+{
+    Uint16 = 0,
+    Uint32 = 1,
+};
+
+// Range of a mesh drawn with one drawIndexed call. Indices are relative to vertexOffset.
+struct CSubmesh
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+    uint32_t vertexCount;
+};
+
+// Level of detail, a range of submeshes and the meshlets built from them. Levels go from full detail to coarsest.
+struct CMeshLod
+{
+    uint32_t firstSubmesh;
+    uint32_t submeshCount;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    // Distance from the full detail surface in mesh space units
+    float error;
+};
+
+// CPU side mesh as it comes out of an importer
+struct CMeshData
+{
+    std::vector<CVertex> vertices;
+    std::vector<uint32_t> indices;
+    // Empty until the mesh is prepared for cooking, then covers all indices
+    std::vector<CSubmesh> submeshes;
+    // Empty until LODs are generated, then every level owns consecutive submeshes
+    std::vector<CMeshLod> lods;
+};
+
+constexpr uint32_t GetIndexFormatSize(const EIndexFormat format) {
+    return format == EIndexFormat::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+}
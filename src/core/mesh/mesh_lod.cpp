@@ -0,0 +1,109 @@
+#include "mesh_lod.hpp"
+
+#include "mesh_simplifier.hpp"
+
+#include "console.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Mesh
+{
+namespace
+{
+// A level removing less than this fraction of triangles isn't worth its memory
+constexpr float MIN_LOD_REDUCTION = 0.1f;
+
+// Keeps the projection finite when the camera is inside the bounds
+constexpr float MIN_LOD_DISTANCE = 1e-3f;
+}
+
+void GenerateLods(CMeshData& mesh, const uint32_t lodCount) {
+    const auto vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    const auto addLevel = [&](const std::span<const uint32_t> indices, const float error) {
+        const auto level = static_cast<uint32_t>(mesh.submeshes.size());
+        mesh.submeshes.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(indices.size()), 0, vertexCount });
+        mesh.lods.push_back({ level, 1, 0, 0, error });
+        mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+    };
+
+    std::vector<uint32_t> previous = std::move(mesh.indices);
+    mesh.indices.clear();
+    mesh.submeshes.clear();
+    mesh.lods.clear();
+    addLevel(previous, 0.0f);
+
+    float error = 0.0f;
+    for (uint32_t level = 1; level < std::clamp(lodCount, 1u, MAX_LOD_COUNT); ++level) {
+        const auto targetIndexCount =
+            static_cast<std::size_t>(static_cast<float>(previous.size() / 3) * LOD_TRIANGLE_RATIO) * 3;
+        CSimplifiedMesh simplified =
+            SimplifyMesh(previous, mesh.vertices, targetIndexCount, std::numeric_limits<float>::max());
+        if (static_cast<float>(simplified.indices.size()) > static_cast<float>(previous.size()) * (1.0f - MIN_LOD_REDUCTION)) {
+            break;
+        }
+
+        // Simplifying from the previous level is much faster, summing errors keeps the bound conservative
+        error += simplified.error;
+        addLevel(simplified.indices, error);
+        previous = std::move(simplified.indices);
+    }
+
+    for (std::size_t level = 0; level < mesh.lods.size(); ++level) {
+        Msg(
+            "LOD {}: {} triangles, error {:.6f}",
+            level,
+            mesh.submeshes[level].indexCount / 3,
+            mesh.lods[level].error
+        );
+    }
+}
+
+glm::vec4 ComputeBoundingSphere(const std::span<const CVertex> vertices) {
+    if (vertices.empty()) {
+        return glm::vec4(0.0f);
+    }
+
+    glm::vec3 boundsMin { std::numeric_limits<float>::max() };
+    glm::vec3 boundsMax { std::numeric_limits<float>::lowest() };
+    for (const CVertex& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+
+    const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = 0.0f;
+    for (const CVertex& vertex : vertices) {
+        radius = std::max(radius, glm::length(vertex.pos - center));
+    }
+    return glm::vec4(center, radius);
+}
+
+uint32_t SelectLod(
+    const std::span<const CMeshLod> lods,
+    const glm::vec4& boundingSphere,
+    const glm::vec3& cameraPosition,
+    const float fov,
+    const uint32_t viewportHeight,
+    const float maxPixelError
+) {
+    const float distance = std::max(
+        glm::length(glm::vec3(boundingSphere) - cameraPosition) - boundingSphere.w,
+        MIN_LOD_DISTANCE
+    );
+
+    // Size of one mesh space unit on screen at that distance
+    const float pixelsPerUnit =
+        static_cast<float>(viewportHeight) / (2.0f * distance * std::tan(glm::radians(fov) * 0.5f));
+
+    uint32_t selected = 0;
+    for (uint32_t level = 1; level < lods.size(); ++level) {
+        if (lods[level].error * pixelsPerUnit > maxPixelError) {
+            break;
+        }
+        selected = level;
+    }
+    return selected;
+}
+}
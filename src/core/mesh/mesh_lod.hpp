@@ -0,0 +1,34 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+
+namespace Mesh
+{
+constexpr uint32_t MAX_LOD_COUNT = 5;
+
+// Every level keeps about this fraction of the previous level's triangles
+constexpr float LOD_TRIANGLE_RATIO = 0.5f;
+
+// Replaces the index buffer with `lodCount` levels simplified one from another, each level gets one submesh.
+// Stops early when a mesh can't be simplified further.
+void GenerateLods(CMeshData& mesh, uint32_t lodCount);
+
+// Bounding sphere in mesh space: xyz center, w radius
+glm::vec4 ComputeBoundingSphere(std::span<const CVertex> vertices);
+
+// Picks the coarsest level whose error projects to at most `maxPixelError` pixels on screen.
+// `fov` is the vertical field of view in degrees.
+uint32_t SelectLod(
+    std::span<const CMeshLod> lods,
+    const glm::vec4& boundingSphere,
+    const glm::vec3& cameraPosition,
+    float fov,
+    uint32_t viewportHeight,
+    float maxPixelError = 1.0f
+);
+}
@@ -0,0 +1,373 @@
+#include "mesh_optimizer.hpp"
+
+#include "console.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <format>
+#include <numeric>
+
+namespace Mesh
+{
+namespace
+{
+// Cache size the scoring function is tuned for, independent of the measured one
+constexpr uint32_t SCORING_CACHE_SIZE = 32;
+constexpr uint32_t MAX_SCORED_VALENCE = 32;
+
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+struct CVertexScoreTables
+{
+    std::array<float, SCORING_CACHE_SIZE> cache {};
+    std::array<float, MAX_SCORED_VALENCE + 1> valence {};
+
+    CVertexScoreTables() {
+        for (uint32_t i = 0; i < SCORING_CACHE_SIZE; ++i) {
+            // Vertices of the last triangle get a fixed score, so the next triangle doesn't simply reuse them
+            if (i < 3) {
+                cache[i] = LAST_TRIANGLE_SCORE;
+            } else {
+                const float scale = 1.0f / static_cast<float>(SCORING_CACHE_SIZE - 3);
+                cache[i] = std::pow(1.0f - static_cast<float>(i - 3) * scale, CACHE_DECAY_POWER);
+            }
+        }
+        // Vertices with few triangles left are preferred, so lone triangles don't get stranded
+        for (uint32_t i = 1; i <= MAX_SCORED_VALENCE; ++i) {
+            valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+        }
+    }
+
+    [[nodiscard]] float Score(const int32_t cachePosition, const uint32_t remainingTriangles) const {
+        if (remainingTriangles == 0) {
+            return -1.0f;
+        }
+        float score = valence[std::min(remainingTriangles, MAX_SCORED_VALENCE)];
+        if (cachePosition >= 0) {
+            score += cache[static_cast<std::size_t>(cachePosition)];
+        }
+        return score;
+    }
+};
+
+// FIFO cache simulated with timestamps: a vertex is cached if it was transformed less than `cacheSize` misses ago
+class CFifoCache
+{
+public:
+    CFifoCache(const std::size_t vertexCount, const uint32_t cacheSize) :
+        m_timestamps(vertexCount, 0), m_cacheSize(cacheSize), m_time(cacheSize + 1) { }
+
+    uint32_t Access(const uint32_t vertex) {
+        if (m_time - m_timestamps[vertex] > m_cacheSize) {
+            m_timestamps[vertex] = m_time++;
+            return 1;
+        }
+        return 0;
+    }
+
+    uint32_t AccessTriangle(const uint32_t* triangle) {
+        return Access(triangle[0]) + Access(triangle[1]) + Access(triangle[2]);
+    }
+
+    void Flush() { m_time += m_cacheSize + 1; }
+
+private:
+    std::vector<uint32_t> m_timestamps;
+    uint32_t m_cacheSize;
+    uint32_t m_time;
+};
+
+glm::vec3 TriangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+    // Not normalized, the length is twice the triangle area
+    return glm::cross(b - a, c - a);
+}
+}
+
+CVertexCacheStats AnalyzeVertexCache(
+    const std::span<const uint32_t> indices,
+    const std::size_t vertexCount,
+    const uint32_t cacheSize
+) {
+    if (indices.empty() || vertexCount == 0) {
+        return {};
+    }
+
+    CFifoCache cache(vertexCount, cacheSize);
+    std::size_t misses = 0;
+    for (std::size_t i = 0; i < indices.size(); i += 3) {
+        misses += cache.AccessTriangle(&indices[i]);
+    }
+
+    return {
+        static_cast<float>(misses) / static_cast<float>(indices.size() / 3),
+        static_cast<float>(misses) / static_cast<float>(vertexCount)
+    };
+}
+
+void OptimizeVertexCache(const std::span<uint32_t> indices, const std::size_t vertexCount) {
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    static const CVertexScoreTables scoreTables;
+    const std::vector<uint32_t> source(indices.begin(), indices.end());
+
+    // Triangles of every vertex, remaining ones are kept at the front of each range
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (const uint32_t index : source) {
+        ++remaining[index];
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    std::partial_sum(remaining.begin(), remaining.end(), adjacencyOffsets.begin() + 1);
+    std::vector<uint32_t> adjacency(source.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (std::size_t i = 0; i < source.size(); ++i) {
+            adjacency[fill[source[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int32_t> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (std::size_t v = 0; v < vertexCount; ++v) {
+        vertexScores[v] = scoreTables.Score(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (std::size_t t = 0; t < triangleCount; ++t) {
+        const uint32_t* triangle = &source[t * 3];
+        triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+    }
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(SCORING_CACHE_SIZE + 3);
+    newCache.reserve(SCORING_CACHE_SIZE + 3);
+
+    auto best = static_cast<int64_t>(
+        std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin()
+    );
+    std::size_t deadEndCursor = 0;
+
+    for (std::size_t output = 0; output < triangleCount; ++output) {
+        // Nothing in the cache has triangles left, continue from the next triangle in input order
+        if (best < 0) {
+            while (emitted[deadEndCursor]) {
+                ++deadEndCursor;
+            }
+            best = static_cast<int64_t>(deadEndCursor);
+        }
+
+        const uint32_t* triangle = &source[static_cast<std::size_t>(best) * 3];
+        std::copy(triangle, triangle + 3, indices.begin() + static_cast<std::ptrdiff_t>(output * 3));
+        emitted[static_cast<std::size_t>(best)] = true;
+
+        newCache.clear();
+        for (uint32_t i = 0; i < 3; ++i) {
+            const uint32_t vertex = triangle[i];
+            const uint32_t begin = adjacencyOffsets[vertex];
+            const auto end = begin + remaining[vertex];
+            std::iter_swap(
+                std::find(adjacency.begin() + begin, adjacency.begin() + end, static_cast<uint32_t>(best)),
+                adjacency.begin() + end - 1
+            );
+            --remaining[vertex];
+            // Degenerate triangles reference a vertex twice
+            if (std::find(newCache.begin(), newCache.end(), vertex) == newCache.end()) {
+                newCache.push_back(vertex);
+            }
+        }
+        for (const uint32_t vertex : cache) {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                newCache.push_back(vertex);
+            }
+        }
+
+        for (std::size_t i = 0; i < newCache.size(); ++i) {
+            const uint32_t vertex = newCache[i];
+            cachePositions[vertex] = i < SCORING_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+            vertexScores[vertex] = scoreTables.Score(cachePositions[vertex], remaining[vertex]);
+        }
+
+        // Only triangles touching the cache could change their score
+        best = -1;
+        float bestScore = -1.0f;
+        for (const uint32_t vertex : newCache) {
+            const uint32_t begin = adjacencyOffsets[vertex];
+            for (uint32_t i = begin; i < begin + remaining[vertex]; ++i) {
+                const uint32_t t = adjacency[i];
+                const uint32_t* candidate = &source[t * 3];
+                triangleScores[t] =
+                    vertexScores[candidate[0]] + vertexScores[candidate[1]] + vertexScores[candidate[2]];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+
+        cache.assign(newCache.begin(), newCache.begin() + std::min<std::size_t>(newCache.size(), SCORING_CACHE_SIZE));
+    }
+}
+
+void OptimizeOverdraw(
+    const std::span<uint32_t> indices,
+    const std::span<const CVertex> vertices,
+    const float threshold
+) {
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Hard boundaries: triangles that miss the cache on every vertex start a new cluster anyway
+    std::vector<std::size_t> hardClusters;
+    {
+        CFifoCache cache(vertices.size(), VERTEX_CACHE_SIZE);
+        for (std::size_t t = 0; t < triangleCount; ++t) {
+            if (cache.AccessTriangle(&indices[t * 3]) == 3 || t == 0) {
+                hardClusters.push_back(t);
+            }
+        }
+    }
+    hardClusters.push_back(triangleCount);
+
+    // Soft boundaries: inside a hard cluster, split as soon as the running ACMR is close enough to the cluster's
+    std::vector<std::size_t> clusters;
+    {
+        CFifoCache cache(vertices.size(), VERTEX_CACHE_SIZE);
+        for (std::size_t c = 0; c + 1 < hardClusters.size(); ++c) {
+            const std::size_t begin = hardClusters[c];
+            const std::size_t end = hardClusters[c + 1];
+
+            cache.Flush();
+            uint32_t clusterMisses = 0;
+            for (std::size_t t = begin; t < end; ++t) {
+                clusterMisses += cache.AccessTriangle(&indices[t * 3]);
+            }
+            const float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+            clusters.push_back(begin);
+            cache.Flush();
+            uint32_t runningMisses = 0;
+            uint32_t runningTriangles = 0;
+            for (std::size_t t = begin; t < end; ++t) {
+                runningMisses += cache.AccessTriangle(&indices[t * 3]);
+                ++runningTriangles;
+                if (static_cast<float>(runningMisses) <= clusterThreshold * static_cast<float>(runningTriangles)) {
+                    clusters.push_back(t + 1);
+                    cache.Flush();
+                    runningMisses = 0;
+                    runningTriangles = 0;
+                }
+            }
+
+            // The tail never reached the target, so it stays with the previous cluster
+            if (clusters.back() == end || (runningTriangles != 0 && clusters.back() != begin)) {
+                clusters.pop_back();
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    glm::vec3 meshCentroid { 0.0f };
+    for (const uint32_t index : indices) {
+        meshCentroid += vertices[index].pos;
+    }
+    meshCentroid /= static_cast<float>(indices.size());
+
+    // Clusters facing away from the mesh center occlude the rest, so they are drawn first
+    const std::size_t clusterCount = clusters.size() - 1;
+    std::vector<float> sortKeys(clusterCount);
+    for (std::size_t cluster = 0; cluster < clusterCount; ++cluster) {
+        glm::vec3 centroid { 0.0f };
+        glm::vec3 normal { 0.0f };
+        float area = 0.0f;
+
+        for (std::size_t t = clusters[cluster]; t < clusters[cluster + 1]; ++t) {
+            const glm::vec3& a = vertices[indices[t * 3 + 0]].pos;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3& c = vertices[indices[t * 3 + 2]].pos;
+            const glm::vec3 triangleNormal = TriangleNormal(a, b, c);
+            const float triangleArea = glm::length(triangleNormal);
+
+            centroid += (a + b + c) * (triangleArea / 3.0f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+
+        const float normalLength = glm::length(normal);
+        centroid = area > 0.0f ? centroid / area : vertices[indices[clusters[cluster] * 3]].pos;
+        sortKeys[cluster] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+    }
+
+    std::vector<std::size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](const std::size_t a, const std::size_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    const std::vector<uint32_t> source(indices.begin(), indices.end());
+    auto output = indices.begin();
+    for (const std::size_t cluster : order) {
+        output = std::copy(
+            source.begin() + static_cast<std::ptrdiff_t>(clusters[cluster] * 3),
+            source.begin() + static_cast<std::ptrdiff_t>(clusters[cluster + 1] * 3),
+            output
+        );
+    }
+}
+
+void OptimizeVertexFetch(CMeshData& mesh) {
+    constexpr uint32_t UNUSED = UINT32_MAX;
+
+    std::vector<uint32_t> remap(mesh.vertices.size(), UNUSED);
+    std::vector<CVertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (uint32_t& index : mesh.indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    mesh.vertices = std::move(vertices);
+    for (CSubmesh& submesh : mesh.submeshes) {
+        submesh.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    }
+}
+
+void OptimizeMesh(CMeshData& mesh, const bool optimizeOverdraw) {
+    const CVertexCacheStats before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    // LOD levels are separate draws, triangles never move between them
+    const std::vector<CSubmesh> ranges =
+        mesh.submeshes.empty() ? std::vector<CSubmesh> { { 0, static_cast<uint32_t>(mesh.indices.size()), 0, 0 } }
+                               : mesh.submeshes;
+    for (const CSubmesh& range : ranges) {
+        const std::span<uint32_t> indices = std::span(mesh.indices).subspan(range.firstIndex, range.indexCount);
+        OptimizeVertexCache(indices, mesh.vertices.size());
+        if (optimizeOverdraw) {
+            OptimizeOverdraw(indices, mesh.vertices);
+        }
+    }
+    OptimizeVertexFetch(mesh);
+
+    const CVertexCacheStats after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+    Msg(
+        "Mesh optimized: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+        before.acmr,
+        after.acmr,
+        before.atvr,
+        after.atvr
+    );
+}
+}
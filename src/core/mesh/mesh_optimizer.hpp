@@ -0,0 +1,43 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace Mesh
+{
+// Post-transform cache size assumed when measuring index buffers. Current GPUs batch
+// vertices differently, but a small FIFO is still a good predictor of vertex shader invocations.
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct CVertexCacheStats
+{
+    // Average cache miss ratio: transformed vertices per triangle, 0.5 at best, 3 at worst
+    float acmr;
+    // Average transform to vertex ratio: transformed vertices per unique vertex, 1 at best
+    float atvr;
+};
+
+// Simulates a FIFO post-transform cache over a triangle list
+CVertexCacheStats AnalyzeVertexCache(
+    std::span<const uint32_t> indices,
+    std::size_t vertexCount,
+    uint32_t cacheSize = VERTEX_CACHE_SIZE
+);
+
+// Reorders triangles for post-transform cache locality (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+void OptimizeVertexCache(std::span<uint32_t> indices, std::size_t vertexCount);
+
+// Splits cache-optimized triangles into clusters and sorts them so outward facing ones are drawn first,
+// trading at most `threshold` times the ACMR for less overdraw
+void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const CVertex> vertices, float threshold = 1.05f);
+
+// Reorders vertices by first use in the index buffer and drops unused ones.
+// Submeshes, if any, must address all vertices as they do before CompactIndices.
+void OptimizeVertexFetch(CMeshData& mesh);
+
+// Runs the passes above in order, separately for every submesh, and logs ACMR/ATVR before and after
+void OptimizeMesh(CMeshData& mesh, bool optimizeOverdraw = true);
+}
@@ -0,0 +1,475 @@
+#include "mesh_simplifier.hpp"
+
+#include "vertex_weld.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Mesh
+{
+namespace
+{
+// Weight of the planes that hold borders and seams in place, relative to surface planes
+constexpr float EDGE_CONSTRAINT_WEIGHT = 10.0f;
+
+// Collapses may rotate a surrounding triangle by up to ~75 degrees
+constexpr float MIN_FLIP_COSINE = 0.25f;
+
+// A pass performs collapses up to this factor of the error of the one that would reach the target on its own,
+// so expensive collapses wait for cheaper ones that become available after the neighborhood changed
+constexpr float PASS_ERROR_SLACK = 1.5f;
+
+// Symmetric quadric of weighted squared distances to a set of planes
+struct CQuadric
+{
+    double a00, a11, a22, a01, a02, a12;
+    double b0, b1, b2;
+    double c;
+    double weight;
+
+    // Plane dot(normal, p) + distance = 0, normal is unit length
+    void AddPlane(const glm::vec3& normal, const float distance, const float planeWeight) {
+        const double x = normal.x, y = normal.y, z = normal.z, d = distance, w = planeWeight;
+        a00 += w * x * x;
+        a11 += w * y * y;
+        a22 += w * z * z;
+        a01 += w * x * y;
+        a02 += w * x * z;
+        a12 += w * y * z;
+        b0 += w * x * d;
+        b1 += w * y * d;
+        b2 += w * z * d;
+        c += w * d * d;
+        weight += w;
+    }
+
+    void Add(const CQuadric& other) {
+        a00 += other.a00;
+        a11 += other.a11;
+        a22 += other.a22;
+        a01 += other.a01;
+        a02 += other.a02;
+        a12 += other.a12;
+        b0 += other.b0;
+        b1 += other.b1;
+        b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+    }
+
+    // Weighted mean squared distance from `p` to the planes
+    [[nodiscard]] float Evaluate(const glm::vec3& p) const {
+        if (weight <= 0.0) {
+            return 0.0f;
+        }
+        const double x = p.x, y = p.y, z = p.z;
+        const double error = a00 * x * x + a11 * y * y + a22 * z * z +
+                             2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                             2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return static_cast<float>(std::max(error, 0.0) / weight);
+    }
+};
+
+enum class EVertexKind : uint8_t
+{
+    // Interior vertex with one set of attributes, collapses anywhere
+    Manifold,
+    // On an open border, collapses along the border
+    Border,
+    // On a texture seam between two charts, collapses along the seam
+    Seam,
+    // Non-manifold or where several seams/borders meet, never collapses
+    Locked,
+};
+
+struct CEdge
+{
+    uint32_t position;
+    uint32_t triangleCount;
+    uint32_t firstTriangle;
+    // Corner vertices of the first triangle, used to tell seams apart from regular edges
+    uint32_t wedge;
+    uint32_t otherWedge;
+    bool seam;
+};
+
+struct CCollapse
+{
+    uint32_t position;
+    uint32_t target;
+    float error;
+};
+
+// Triangles around every position, as offsets into one flat array
+struct CTriangleFan
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+};
+
+class CSimplifier
+{
+public:
+    CSimplifier(const std::span<const uint32_t> indices, const std::span<const CVertex> vertices) :
+        m_vertices(vertices),
+        m_vertexPosition(vertices.size()),
+        m_vertexRemap(vertices.size()) {
+        // Vertices split by texture coordinates share a position, topology is tracked per position
+        CVertexWeldTable<glm::vec3> positionTable(vertices.size());
+        for (std::size_t i = 0; i < vertices.size(); ++i) {
+            m_vertexPosition[i] = positionTable.Insert(vertices[i].pos, m_positions);
+            m_vertexRemap[i] = static_cast<uint32_t>(i);
+        }
+
+        m_indices.reserve(indices.size());
+        for (std::size_t i = 0; i < indices.size(); i += 3) {
+            if (!_IsDegenerate(&indices[i])) {
+                m_indices.insert(m_indices.end(), &indices[i], &indices[i] + 3);
+            }
+        }
+
+        m_quadrics.assign(m_positions.size(), CQuadric {});
+        m_touched.resize(m_positions.size());
+    }
+
+    CSimplifiedMesh Simplify(const std::size_t targetIndexCount, const float maxError) {
+        _BuildFans();
+        _InitializeQuadrics();
+
+        const float maxCost = maxError * maxError;
+        float error = 0.0f;
+        while (m_indices.size() > targetIndexCount) {
+            _BuildFans();
+
+            std::vector<CCollapse> collapses = _FindCollapses(maxCost);
+            if (collapses.empty()) {
+                break;
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const CCollapse& a, const CCollapse& b) {
+                return a.error < b.error;
+            });
+
+            // Each collapse removes two triangles on average. A floor on the goal keeps passes from stalling
+            // on meshes where nearly every collapse costs nothing.
+            const std::size_t goal = std::min(
+                std::max((m_indices.size() - targetIndexCount) / 6, collapses.size() / 8),
+                collapses.size() - 1
+            );
+            const float passMaxCost = collapses[goal].error * PASS_ERROR_SLACK;
+
+            const std::size_t performed = _PerformCollapses(collapses, targetIndexCount, passMaxCost, error);
+            _RemapTriangles();
+            if (performed == 0) {
+                break;
+            }
+        }
+
+        return { std::move(m_indices), std::sqrt(error) };
+    }
+
+private:
+    [[nodiscard]] bool _IsDegenerate(const uint32_t* triangle) const {
+        const uint32_t a = m_vertexPosition[triangle[0]];
+        const uint32_t b = m_vertexPosition[triangle[1]];
+        const uint32_t c = m_vertexPosition[triangle[2]];
+        return a == b || b == c || a == c;
+    }
+
+    void _BuildFans() {
+        m_fans.offsets.assign(m_positions.size() + 1, 0);
+        for (const uint32_t index : m_indices) {
+            ++m_fans.offsets[m_vertexPosition[index] + 1];
+        }
+        for (std::size_t i = 0; i < m_positions.size(); ++i) {
+            m_fans.offsets[i + 1] += m_fans.offsets[i];
+        }
+
+        m_fans.triangles.resize(m_indices.size());
+        std::vector<uint32_t> fill(m_fans.offsets.begin(), m_fans.offsets.end() - 1);
+        for (std::size_t i = 0; i < m_indices.size(); ++i) {
+            m_fans.triangles[fill[m_vertexPosition[m_indices[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    // Corner of `triangle` at `position`
+    [[nodiscard]] uint32_t _GetCorner(const uint32_t triangle, const uint32_t position) const {
+        const uint32_t* corners = &m_indices[triangle * 3];
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            if (m_vertexPosition[corners[corner]] == position) {
+                return corner;
+            }
+        }
+        return 0;
+    }
+
+    // Collects edges around `position` into m_edges and returns the number of distinct wedges
+    uint32_t _CollectEdges(const uint32_t position) {
+        m_edges.clear();
+        uint32_t wedges[2] = { UINT32_MAX, UINT32_MAX };
+        uint32_t wedgeCount = 0;
+
+        for (uint32_t i = m_fans.offsets[position]; i < m_fans.offsets[position + 1]; ++i) {
+            const uint32_t triangle = m_fans.triangles[i];
+            const uint32_t* corners = &m_indices[triangle * 3];
+            const uint32_t corner = _GetCorner(triangle, position);
+
+            const uint32_t wedge = corners[corner];
+            if (wedge != wedges[0] && wedge != wedges[1]) {
+                if (wedgeCount < 2) {
+                    wedges[wedgeCount] = wedge;
+                }
+                ++wedgeCount;
+            }
+
+            for (const uint32_t other : { corners[(corner + 1) % 3], corners[(corner + 2) % 3] }) {
+                const uint32_t otherPosition = m_vertexPosition[other];
+                auto edge = std::find_if(m_edges.begin(), m_edges.end(), [&](const CEdge& e) {
+                    return e.position == otherPosition;
+                });
+                if (edge == m_edges.end()) {
+                    m_edges.push_back({ otherPosition, 1, triangle, wedge, other, false });
+                } else {
+                    ++edge->triangleCount;
+                    edge->seam = edge->seam || edge->wedge != wedge || edge->otherWedge != other;
+                }
+            }
+        }
+
+        return wedgeCount;
+    }
+
+    void _InitializeQuadrics() {
+        for (std::size_t i = 0; i < m_indices.size(); i += 3) {
+            const glm::vec3& a = m_vertices[m_indices[i + 0]].pos;
+            const glm::vec3& b = m_vertices[m_indices[i + 1]].pos;
+            const glm::vec3& c = m_vertices[m_indices[i + 2]].pos;
+            const glm::vec3 normal = glm::cross(b - a, c - a);
+            const float length = glm::length(normal);
+            if (length == 0.0f) {
+                continue;
+            }
+
+            const glm::vec3 unitNormal = normal / length;
+            const float distance = -glm::dot(unitNormal, a);
+            for (uint32_t corner = 0; corner < 3; ++corner) {
+                m_quadrics[m_vertexPosition[m_indices[i + corner]]].AddPlane(unitNormal, distance, length * 0.5f);
+            }
+        }
+
+        // Planes through borders and seams, perpendicular to the surface, keep them from drifting
+        for (uint32_t position = 0; position < m_positions.size(); ++position) {
+            _CollectEdges(position);
+            for (const CEdge& edge : m_edges) {
+                if (edge.position < position || (edge.triangleCount != 1 && !edge.seam)) {
+                    continue;
+                }
+
+                const uint32_t* corners = &m_indices[edge.firstTriangle * 3];
+                const glm::vec3& a = m_vertices[corners[0]].pos;
+                const glm::vec3& b = m_vertices[corners[1]].pos;
+                const glm::vec3& c = m_vertices[corners[2]].pos;
+                const glm::vec3 direction = m_positions[edge.position] - m_positions[position];
+                const glm::vec3 normal = glm::cross(direction, glm::cross(b - a, c - a));
+                const float length = glm::length(normal);
+                if (length == 0.0f) {
+                    continue;
+                }
+
+                const glm::vec3 unitNormal = normal / length;
+                const float distance = -glm::dot(unitNormal, m_positions[position]);
+                const float weight = glm::dot(direction, direction) * EDGE_CONSTRAINT_WEIGHT;
+                m_quadrics[position].AddPlane(unitNormal, distance, weight);
+                m_quadrics[edge.position].AddPlane(unitNormal, distance, weight);
+            }
+        }
+    }
+
+    [[nodiscard]] EVertexKind _ClassifyVertex(const uint32_t wedgeCount) const {
+        bool border = false;
+        bool complex = false;
+        for (const CEdge& edge : m_edges) {
+            border = border || edge.triangleCount == 1;
+            complex = complex || edge.triangleCount > 2;
+        }
+
+        if (complex || wedgeCount > 2 || (border && wedgeCount > 1)) {
+            return EVertexKind::Locked;
+        }
+        if (border) {
+            return EVertexKind::Border;
+        }
+        return wedgeCount == 2 ? EVertexKind::Seam : EVertexKind::Manifold;
+    }
+
+    // Every wedge of `position` has to land on one wedge of `target`, taken from the triangles they share
+    [[nodiscard]] bool _MapWedges(const uint32_t position, const uint32_t target) {
+        m_wedgeMap.clear();
+        for (uint32_t i = m_fans.offsets[position]; i < m_fans.offsets[position + 1]; ++i) {
+            const uint32_t triangle = m_fans.triangles[i];
+            const uint32_t* corners = &m_indices[triangle * 3];
+            const uint32_t wedge = corners[_GetCorner(triangle, position)];
+
+            uint32_t targetWedge = UINT32_MAX;
+            for (uint32_t corner = 0; corner < 3; ++corner) {
+                if (m_vertexPosition[corners[corner]] == target) {
+                    targetWedge = corners[corner];
+                }
+            }
+
+            auto mapping = std::find_if(m_wedgeMap.begin(), m_wedgeMap.end(), [&](const auto& entry) {
+                return entry.first == wedge;
+            });
+            if (mapping == m_wedgeMap.end()) {
+                m_wedgeMap.emplace_back(wedge, targetWedge);
+            } else if (mapping->second == UINT32_MAX) {
+                mapping->second = targetWedge;
+            } else if (targetWedge != UINT32_MAX && mapping->second != targetWedge) {
+                return false;
+            }
+        }
+
+        return std::all_of(m_wedgeMap.begin(), m_wedgeMap.end(), [](const auto& entry) {
+            return entry.second != UINT32_MAX;
+        });
+    }
+
+    std::vector<CCollapse> _FindCollapses(const float maxCost) {
+        std::vector<CCollapse> collapses;
+        for (uint32_t position = 0; position < m_positions.size(); ++position) {
+            if (m_fans.offsets[position] == m_fans.offsets[position + 1]) {
+                continue;
+            }
+
+            const EVertexKind kind = _ClassifyVertex(_CollectEdges(position));
+            if (kind == EVertexKind::Locked) {
+                continue;
+            }
+            CCollapse best { position, UINT32_MAX, std::numeric_limits<float>::max() };
+            for (const CEdge& edge : m_edges) {
+                if ((kind == EVertexKind::Border && edge.triangleCount != 1) || (kind == EVertexKind::Seam && !edge.seam)) {
+                    continue;
+                }
+                const float error = m_quadrics[position].Evaluate(m_positions[edge.position]);
+                if (error < best.error && error <= maxCost) {
+                    best.target = edge.position;
+                    best.error = error;
+                }
+            }
+
+            if (best.target != UINT32_MAX) {
+                collapses.push_back(best);
+            }
+        }
+        return collapses;
+    }
+
+    // Triangles around `position` that survive the collapse must not flip or degenerate
+    [[nodiscard]] bool _IsCollapseSafe(const uint32_t position, const uint32_t target) const {
+        const glm::vec3& from = m_positions[position];
+        const glm::vec3& to = m_positions[target];
+        for (uint32_t i = m_fans.offsets[position]; i < m_fans.offsets[position + 1]; ++i) {
+            const uint32_t triangle = m_fans.triangles[i];
+            const uint32_t* corners = &m_indices[triangle * 3];
+            const uint32_t corner = _GetCorner(triangle, position);
+            const uint32_t b = m_vertexPosition[corners[(corner + 1) % 3]];
+            const uint32_t c = m_vertexPosition[corners[(corner + 2) % 3]];
+            if (b == target || c == target) {
+                continue;
+            }
+
+            const glm::vec3 before = glm::cross(m_positions[b] - from, m_positions[c] - from);
+            const glm::vec3 after = glm::cross(m_positions[b] - to, m_positions[c] - to);
+            if (glm::dot(before, after) < MIN_FLIP_COSINE * glm::length(before) * glm::length(after) ||
+                glm::length(after) == 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t _PerformCollapses(
+        const std::span<const CCollapse> collapses,
+        const std::size_t targetIndexCount,
+        const float passMaxCost,
+        float& error
+    ) {
+        std::fill(m_touched.begin(), m_touched.end(), false);
+
+        std::size_t triangleCount = m_indices.size() / 3;
+        std::size_t performed = 0;
+        for (const CCollapse& collapse : collapses) {
+            if (triangleCount * 3 <= targetIndexCount || collapse.error > passMaxCost) {
+                break;
+            }
+            if (m_touched[collapse.position] || m_touched[collapse.target]) {
+                continue;
+            }
+            if (!_IsCollapseSafe(collapse.position, collapse.target) || !_MapWedges(collapse.position, collapse.target)) {
+                continue;
+            }
+
+            for (const auto& [wedge, targetWedge] : m_wedgeMap) {
+                m_vertexRemap[wedge] = targetWedge;
+            }
+            m_quadrics[collapse.target].Add(m_quadrics[collapse.position]);
+
+            // Neighbors' triangles change shape, their collapses are reconsidered in the next pass
+            _CollectEdges(collapse.position);
+            for (const CEdge& edge : m_edges) {
+                m_touched[edge.position] = true;
+                if (edge.position == collapse.target) {
+                    triangleCount -= edge.triangleCount;
+                }
+            }
+            m_touched[collapse.position] = true;
+
+            error = std::max(error, collapse.error);
+            ++performed;
+        }
+        return performed;
+    }
+
+    void _RemapTriangles() {
+        std::size_t write = 0;
+        for (std::size_t i = 0; i < m_indices.size(); i += 3) {
+            const uint32_t triangle[3] = {
+                m_vertexRemap[m_indices[i + 0]],
+                m_vertexRemap[m_indices[i + 1]],
+                m_vertexRemap[m_indices[i + 2]],
+            };
+            if (!_IsDegenerate(triangle)) {
+                std::copy(triangle, triangle + 3, m_indices.begin() + static_cast<std::ptrdiff_t>(write));
+                write += 3;
+            }
+        }
+        m_indices.resize(write);
+    }
+
+    std::span<const CVertex> m_vertices;
+    std::vector<glm::vec3> m_positions;
+    std::vector<uint32_t> m_vertexPosition;
+    // Collapsed vertices point to the vertex that replaced them, others to themselves
+    std::vector<uint32_t> m_vertexRemap;
+    std::vector<uint32_t> m_indices;
+
+    std::vector<CQuadric> m_quadrics;
+    std::vector<bool> m_touched;
+    CTriangleFan m_fans;
+
+    // Scratch space reused between vertices
+    std::vector<CEdge> m_edges;
+    std::vector<std::pair<uint32_t, uint32_t>> m_wedgeMap;
+};
+}
+
+CSimplifiedMesh SimplifyMesh(
+    const std::span<const uint32_t> indices,
+    const std::span<const CVertex> vertices,
+    const std::size_t targetIndexCount,
+    const float maxError
+) {
+    CSimplifier simplifier(indices, vertices);
+    return simplifier.Simplify(targetIndexCount, maxError);
+}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "vertex.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Mesh
+{
+struct CSimplifiedMesh
+{
+    std::vector<uint32_t> indices;
+    // Largest deviation introduced by a collapse, in mesh space units
+    float error;
+};
+
+// Removes triangles by collapsing edges with the least quadric error (Garland & Heckbert) until `targetIndexCount`
+// is reached or the next collapse would exceed `maxError`. Only indices change, so the result references the
+// same vertices and LOD levels can share one vertex buffer. Open borders and texture seams only collapse
+// along themselves to keep silhouettes and UV charts in place.
+CSimplifiedMesh SimplifyMesh(
+    std::span<const uint32_t> indices,
+    std::span<const CVertex> vertices,
+    std::size_t targetIndexCount,
+    float maxError
+);
+}
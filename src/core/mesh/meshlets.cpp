@@ -0,0 +1,265 @@
+#include "meshlets.hpp"
+
+#include "vertex_weld.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+
+namespace Mesh
+{
+namespace
+{
+// Normal cones wider than this can't be culled from any direction in practice
+constexpr float MIN_CONE_COSINE = 0.1f;
+
+// How much a triangle facing away from the meshlet is penalized, in new vertices
+constexpr float CONE_WEIGHT = 0.5f;
+
+// Small preference for triangles whose vertices have few triangles left, keeps meshlets compact
+constexpr float LIVE_WEIGHT = 0.05f;
+
+glm::vec3 GetTriangleNormal(const uint32_t* triangle, const std::span<const CVertex> vertices) {
+    const glm::vec3& a = vertices[triangle[0]].pos;
+    const glm::vec3& b = vertices[triangle[1]].pos;
+    const glm::vec3& c = vertices[triangle[2]].pos;
+    const glm::vec3 normal = glm::cross(b - a, c - a);
+    const float length = glm::length(normal);
+    return length > 0.0f ? normal / length : glm::vec3 { 0.0f };
+}
+
+void ComputeMeshletBounds(
+    CMeshlet& meshlet,
+    const std::span<const uint32_t> indices,
+    const std::span<const CVertex> vertices
+) {
+    glm::vec3 boundsMin { std::numeric_limits<float>::max() };
+    glm::vec3 boundsMax { std::numeric_limits<float>::lowest() };
+    for (const uint32_t index : indices) {
+        boundsMin = glm::min(boundsMin, vertices[index].pos);
+        boundsMax = glm::max(boundsMax, vertices[index].pos);
+    }
+
+    const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = 0.0f;
+    for (const uint32_t index : indices) {
+        radius = std::max(radius, glm::length(vertices[index].pos - center));
+    }
+    meshlet.sphere = glm::vec4(center, radius);
+
+    std::vector<glm::vec3> normals;
+    normals.reserve(indices.size() / 3);
+    glm::vec3 axis { 0.0f };
+    for (std::size_t i = 0; i < indices.size(); i += 3) {
+        const glm::vec3 normal = GetTriangleNormal(&indices[i], vertices);
+        if (normal != glm::vec3 { 0.0f }) {
+            normals.push_back(normal);
+            axis += normal;
+        }
+    }
+
+    meshlet.cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    const float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength == 0.0f) {
+        return;
+    }
+    axis /= axisLength;
+
+    float minCosine = 1.0f;
+    for (const glm::vec3& normal : normals) {
+        minCosine = std::min(minCosine, glm::dot(axis, normal));
+    }
+    if (minCosine <= MIN_CONE_COSINE) {
+        return;
+    }
+
+    // Sine of the cone half-angle: the view direction has to be within 90 degrees of every normal
+    meshlet.cone = glm::vec4(axis, std::sqrt(1.0f - minCosine * minCosine));
+}
+
+// Triangles referencing each vertex, as offsets into one flat array
+struct CTriangleAdjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+};
+
+// Vertices split only by their texture coordinates share a position, so adjacency is built over unique positions
+std::vector<uint32_t> RemapByPosition(const std::span<const CVertex> vertices) {
+    CVertexWeldTable<glm::vec3> positionTable(vertices.size());
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> remap(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+        remap[i] = positionTable.Insert(vertices[i].pos, positions);
+    }
+    return remap;
+}
+
+CTriangleAdjacency BuildAdjacency(const std::span<const uint32_t> indices, const std::span<const uint32_t> remap) {
+    CTriangleAdjacency adjacency;
+    adjacency.offsets.assign(remap.size() + 1, 0);
+    for (const uint32_t index : indices) {
+        ++adjacency.offsets[remap[index] + 1];
+    }
+    for (std::size_t i = 0; i < remap.size(); ++i) {
+        adjacency.offsets[i + 1] += adjacency.offsets[i];
+    }
+
+    adjacency.triangles.resize(indices.size());
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        adjacency.triangles[fill[remap[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+    }
+    return adjacency;
+}
+
+// Builds meshlets of one submesh. `indices` are local to `vertices` and are rewritten in meshlet order.
+void BuildSubmeshMeshlets(
+    const CSubmesh& submesh,
+    const std::span<uint32_t> indices,
+    const std::span<const CVertex> vertices,
+    std::vector<CMeshlet>& meshlets
+) {
+    const std::size_t triangleCount = indices.size() / 3;
+    const std::vector<uint32_t> remap = RemapByPosition(vertices);
+    const CTriangleAdjacency adjacency = BuildAdjacency(indices, remap);
+
+    std::vector<glm::vec3> normals(triangleCount);
+    for (std::size_t i = 0; i < triangleCount; ++i) {
+        normals[i] = GetTriangleNormal(&indices[i * 3], vertices);
+    }
+
+    // Triangles not emitted yet around every position
+    std::vector<uint32_t> liveTriangles(adjacency.offsets.size() - 1);
+    for (std::size_t i = 0; i < liveTriangles.size(); ++i) {
+        liveTriangles[i] = adjacency.offsets[i + 1] - adjacency.offsets[i];
+    }
+
+    std::vector<uint32_t> ordered;
+    ordered.reserve(indices.size());
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> usedBy(vertices.size(), UINT32_MAX);
+    std::vector<uint32_t> meshletVertices;
+    meshletVertices.reserve(MAX_MESHLET_VERTICES);
+
+    CMeshlet meshlet {};
+    meshlet.firstIndex = submesh.firstIndex;
+    meshlet.vertexOffset = submesh.vertexOffset;
+    auto meshletId = static_cast<uint32_t>(meshlets.size());
+    glm::vec3 normalSum { 0.0f };
+    std::size_t seedCursor = 0;
+
+    const auto countNewVertices = [&](const std::size_t triangle) {
+        const uint32_t* corners = &indices[triangle * 3];
+        uint32_t count = 0;
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            const bool repeated = (corner > 0 && corners[corner] == corners[0]) ||
+                                  (corner > 1 && corners[corner] == corners[1]);
+            if (usedBy[corners[corner]] != meshletId && !repeated) {
+                ++count;
+            }
+        }
+        return count;
+    };
+
+    const auto flush = [&] {
+        const std::span<const uint32_t> meshletIndices(ordered.data() + (meshlet.firstIndex - submesh.firstIndex), meshlet.indexCount);
+        ComputeMeshletBounds(meshlet, meshletIndices, vertices);
+        meshlets.push_back(meshlet);
+
+        meshlet.firstIndex += meshlet.indexCount;
+        meshlet.indexCount = 0;
+        meshletId = static_cast<uint32_t>(meshlets.size());
+        meshletVertices.clear();
+        normalSum = glm::vec3 { 0.0f };
+    };
+
+    for (std::size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        // Best adjacent triangle: fewest new vertices, then closest to the meshlet's average normal
+        const float axisLength = glm::length(normalSum);
+        const glm::vec3 axis = axisLength > 0.0f ? normalSum / axisLength : glm::vec3 { 0.0f };
+        std::size_t best = triangleCount;
+        float bestScore = std::numeric_limits<float>::max();
+        for (const uint32_t vertex : meshletVertices) {
+            const uint32_t position = remap[vertex];
+            for (uint32_t i = adjacency.offsets[position]; i < adjacency.offsets[position + 1]; ++i) {
+                const uint32_t triangle = adjacency.triangles[i];
+                if (emitted[triangle]) {
+                    continue;
+                }
+                const uint32_t newVertices = countNewVertices(triangle);
+                if (meshletVertices.size() + newVertices > MAX_MESHLET_VERTICES) {
+                    continue;
+                }
+                const uint32_t* corners = &indices[triangle * 3];
+                const uint32_t live = liveTriangles[remap[corners[0]]] + liveTriangles[remap[corners[1]]] +
+                                      liveTriangles[remap[corners[2]]];
+                const float score = static_cast<float>(newVertices) +
+                                    CONE_WEIGHT * (1.0f - glm::dot(axis, normals[triangle])) +
+                                    LIVE_WEIGHT * static_cast<float>(live - 3);
+                if (score < bestScore) {
+                    bestScore = score;
+                    best = triangle;
+                }
+            }
+        }
+
+        // Nothing adjacent fits, continue from the next triangle in the original order
+        if (best == triangleCount) {
+            while (emitted[seedCursor]) {
+                ++seedCursor;
+            }
+            best = seedCursor;
+            if (meshletVertices.size() + countNewVertices(best) > MAX_MESHLET_VERTICES) {
+                flush();
+            }
+        }
+
+        const uint32_t* corners = &indices[best * 3];
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            if (usedBy[corners[corner]] != meshletId) {
+                usedBy[corners[corner]] = meshletId;
+                meshletVertices.push_back(corners[corner]);
+            }
+            ordered.push_back(corners[corner]);
+            --liveTriangles[remap[corners[corner]]];
+        }
+        emitted[best] = true;
+        normalSum += normals[best];
+        meshlet.indexCount += 3;
+
+        if (meshlet.indexCount / 3 == MAX_MESHLET_TRIANGLES || meshletVertices.size() == MAX_MESHLET_VERTICES) {
+            flush();
+        }
+    }
+
+    if (meshlet.indexCount != 0) {
+        flush();
+    }
+
+    std::copy(ordered.begin(), ordered.end(), indices.begin());
+}
+}
+
+std::vector<CMeshlet> BuildMeshlets(CMeshData& mesh) {
+    std::vector<CMeshlet> meshlets;
+    std::vector<uint32_t> submeshStarts;
+
+    for (const CSubmesh& submesh : mesh.submeshes) {
+        submeshStarts.push_back(static_cast<uint32_t>(meshlets.size()));
+        const std::span<uint32_t> indices = std::span(mesh.indices).subspan(submesh.firstIndex, submesh.indexCount);
+        const std::span<const CVertex> vertices =
+            std::span(mesh.vertices).subspan(static_cast<std::size_t>(submesh.vertexOffset), submesh.vertexCount);
+        BuildSubmeshMeshlets(submesh, indices, vertices, meshlets);
+    }
+    submeshStarts.push_back(static_cast<uint32_t>(meshlets.size()));
+
+    for (CMeshLod& lod : mesh.lods) {
+        lod.firstMeshlet = submeshStarts[lod.firstSubmesh];
+        lod.meshletCount = submeshStarts[lod.firstSubmesh + lod.submeshCount] - lod.firstMeshlet;
+    }
+
+    return meshlets;
+}
+}
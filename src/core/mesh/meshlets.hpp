@@ -0,0 +1,37 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace Mesh
+{
+constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+// Small cluster of triangles that is culled as a whole. Laid out for std430, see shaders/cull.comp.
+struct CMeshlet
+{
+    // Bounding sphere in mesh space: xyz center, w radius
+    glm::vec4 sphere;
+    // Normal cone: xyz axis, w cutoff. The meshlet faces away from a camera at `p` if
+    //     dot(center - p, axis) >= cutoff * length(center - p) + radius
+    // Cutoff is 1 for meshlets that can't be cone culled.
+    glm::vec4 cone;
+
+    // Draw range, as in CSubmesh
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+    uint32_t padding;
+};
+
+// Splits every submesh into meshlets of at most MAX_MESHLET_VERTICES vertices and MAX_MESHLET_TRIANGLES triangles.
+// Meshlets grow over adjacent triangles preferring those facing the same way, so normal cones stay narrow.
+// Triangles of each submesh are reordered so that every meshlet is a contiguous index range.
+// Meshlet ranges of mesh.lods are filled in.
+std::vector<CMeshlet> BuildMeshlets(CMeshData& mesh);
+}
@@ -0,0 +1,368 @@
+#include "obj_importer.hpp"
+#include "vertex_weld.hpp"
+
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace Mesh
+{
+namespace
+{
+// Amount of OBJ text held in memory at once. It is split between the workers,
+// so peak memory of the parser doesn't depend on the file size.
+constexpr std::size_t CHUNK_BUDGET = 32 * 1024 * 1024;
+
+enum ECornerFlags : uint8_t
+{
+    CORNER_RELATIVE_POSITION = 1 << 0,
+    CORNER_RELATIVE_TEXCOORD = 1 << 1,
+    CORNER_NO_TEXCOORD = 1 << 2,
+};
+
+// Face corner as written in the file. Relative indices are stored relative to the chunk start,
+// because a worker doesn't know how many attributes the previous chunks declared.
+struct CCorner
+{
+    int32_t position;
+    int32_t texCoord;
+    uint8_t flags;
+};
+
+struct CParsedChunk
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<CCorner> corners;
+    std::vector<uint32_t> faceSizes;
+
+    void Clear() {
+        positions.clear();
+        texCoords.clear();
+        corners.clear();
+        faceSizes.clear();
+    }
+};
+
+struct CMergeState
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    CVertexWeldTable<CVertex> weldTable;
+    std::vector<uint32_t> faceVertices;
+};
+
+bool IsSpace(const char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* SkipSpaces(const char* p, const char* end) {
+    while (p < end && IsSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+bool ParseFloat(const char*& p, const char* end, float& value) {
+    p = SkipSpaces(p, end);
+    if (p < end && *p == '+') {
+        ++p;
+    }
+    const auto [ptr, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc()) {
+        return false;
+    }
+    p = ptr;
+    return true;
+}
+
+bool ParseInt(const char*& p, const char* end, int32_t& value) {
+    const auto [ptr, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc()) {
+        return false;
+    }
+    p = ptr;
+    return true;
+}
+
+[[noreturn]] void ThrowMalformedLine(const char* begin, const char* end) {
+    throw std::runtime_error(std::format("Malformed OBJ line: \"{}\"", std::string_view(begin, end)));
+}
+
+// Converts OBJ index (1-based or negative) into a chunk-local one
+bool ResolveLocalIndex(const int32_t index, const std::size_t localCount, int32_t& result) {
+    if (index > 0) {
+        result = index - 1;
+        return false;
+    }
+    result = static_cast<int32_t>(localCount) + index;
+    return true;
+}
+
+void ParseFace(const char* p, const char* end, const char* lineBegin, CParsedChunk& chunk) {
+    uint32_t cornerCount = 0;
+
+    while (true) {
+        p = SkipSpaces(p, end);
+        if (p == end) {
+            break;
+        }
+
+        int32_t position = 0;
+        if (!ParseInt(p, end, position) || position == 0) {
+            ThrowMalformedLine(lineBegin, end);
+        }
+
+        CCorner corner {};
+        corner.flags = CORNER_NO_TEXCOORD;
+        if (ResolveLocalIndex(position, chunk.positions.size(), corner.position)) {
+            corner.flags |= CORNER_RELATIVE_POSITION;
+        }
+
+        // v, v/vt, v//vn or v/vt/vn. Normals are not used by the renderer.
+        if (p < end && *p == '/') {
+            ++p;
+            int32_t texCoord = 0;
+            if (p < end && *p != '/') {
+                if (!ParseInt(p, end, texCoord) || texCoord == 0) {
+                    ThrowMalformedLine(lineBegin, end);
+                }
+                corner.flags &= ~CORNER_NO_TEXCOORD;
+                if (ResolveLocalIndex(texCoord, chunk.texCoords.size(), corner.texCoord)) {
+                    corner.flags |= CORNER_RELATIVE_TEXCOORD;
+                }
+            }
+            if (p < end && *p == '/') {
+                ++p;
+                int32_t normal = 0;
+                if (!ParseInt(p, end, normal)) {
+                    ThrowMalformedLine(lineBegin, end);
+                }
+            }
+        }
+
+        if (p < end && !IsSpace(*p)) {
+            ThrowMalformedLine(lineBegin, end);
+        }
+
+        chunk.corners.push_back(corner);
+        ++cornerCount;
+    }
+
+    if (cornerCount < 3) {
+        ThrowMalformedLine(lineBegin, end);
+    }
+    chunk.faceSizes.push_back(cornerCount);
+}
+
+void ParseLine(const char* begin, const char* end, CParsedChunk& chunk) {
+    const char* keywordBegin = SkipSpaces(begin, end);
+    const char* keywordEnd = keywordBegin;
+    while (keywordEnd < end && !IsSpace(*keywordEnd)) {
+        ++keywordEnd;
+    }
+    const std::string_view keyword(keywordBegin, static_cast<std::size_t>(keywordEnd - keywordBegin));
+
+    // Comments, normals, groups, materials and other statements are not consumed
+    if (keyword == "v") {
+        glm::vec3 position {};
+        const char* cursor = keywordEnd;
+        if (!ParseFloat(cursor, end, position.x) ||
+            !ParseFloat(cursor, end, position.y) ||
+            !ParseFloat(cursor, end, position.z)) {
+            ThrowMalformedLine(begin, end);
+        }
+        chunk.positions.push_back(position);
+    } else if (keyword == "vt") {
+        glm::vec2 texCoord { 0.0f };
+        const char* cursor = keywordEnd;
+        if (!ParseFloat(cursor, end, texCoord.x)) {
+            ThrowMalformedLine(begin, end);
+        }
+        ParseFloat(cursor, end, texCoord.y);
+        texCoord.y = 1.0f - texCoord.y;
+        chunk.texCoords.push_back(texCoord);
+    } else if (keyword == "f") {
+        ParseFace(keywordEnd, end, begin, chunk);
+    }
+}
+
+void ParseChunk(const std::string_view text, CParsedChunk& chunk) {
+    chunk.Clear();
+
+    const char* p = text.data();
+    const char* end = text.data() + text.size();
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        ParseLine(p, lineEnd, chunk);
+        // Forming end + 1 for an unterminated last line would be undefined
+        p = lineEnd == end ? end : lineEnd + 1;
+    }
+}
+
+// Splits text into roughly equal parts that start at line beginnings
+std::vector<std::string_view> SplitByLines(const std::string_view text, const std::size_t parts) {
+    std::vector<std::string_view> result;
+
+    std::size_t begin = 0;
+    for (std::size_t i = 1; i <= parts && begin < text.size(); ++i) {
+        std::size_t end = text.size();
+        if (i != parts) {
+            end = std::max(begin, text.size() * i / parts);
+            end = text.find('\n', end);
+            end = end == std::string_view::npos ? text.size() : end + 1;
+        }
+        result.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+
+    return result;
+}
+
+uint32_t ResolveAttribute(
+    const int32_t index,
+    const bool relative,
+    const std::size_t chunkBase,
+    const std::size_t count,
+    const char* attribute
+) {
+    const int64_t resolved = relative ? static_cast<int64_t>(chunkBase) + index : static_cast<int64_t>(index);
+    if (resolved < 0 || resolved >= static_cast<int64_t>(count)) {
+        // OBJ only allows references to attributes declared above the face
+        throw std::runtime_error(std::format("OBJ face references undeclared {} #{}", attribute, resolved + 1));
+    }
+    return static_cast<uint32_t>(resolved);
+}
+
+void MergeChunk(const CParsedChunk& chunk, CMergeState& state, CMeshData& mesh) {
+    const std::size_t positionBase = state.positions.size();
+    const std::size_t texCoordBase = state.texCoords.size();
+    state.positions.insert(state.positions.end(), chunk.positions.begin(), chunk.positions.end());
+    state.texCoords.insert(state.texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+
+    // Corners of a typical mesh are shared by about three faces
+    state.weldTable.Reserve(mesh.vertices.size() + chunk.corners.size() / 3);
+
+    std::size_t cornerIndex = 0;
+    for (const uint32_t faceSize : chunk.faceSizes) {
+        state.faceVertices.clear();
+
+        for (uint32_t i = 0; i < faceSize; ++i) {
+            const CCorner& corner = chunk.corners[cornerIndex++];
+
+            CVertex vertex {};
+            vertex.pos = state.positions[ResolveAttribute(
+                corner.position,
+                corner.flags & CORNER_RELATIVE_POSITION,
+                positionBase,
+                state.positions.size(),
+                "position"
+            )];
+            if (!(corner.flags & CORNER_NO_TEXCOORD)) {
+                vertex.texCoord = state.texCoords[ResolveAttribute(
+                    corner.texCoord,
+                    corner.flags & CORNER_RELATIVE_TEXCOORD,
+                    texCoordBase,
+                    state.texCoords.size(),
+                    "texture coordinate"
+                )];
+            }
+
+            state.faceVertices.push_back(state.weldTable.Insert(vertex, mesh.vertices));
+        }
+
+        // Polygons are triangulated as fans
+        for (uint32_t i = 2; i < faceSize; ++i) {
+            mesh.indices.push_back(state.faceVertices[0]);
+            mesh.indices.push_back(state.faceVertices[i - 1]);
+            mesh.indices.push_back(state.faceVertices[i]);
+        }
+    }
+}
+
+// Parser state carried across windows of whole lines
+struct CObjImport
+{
+    std::vector<CParsedChunk> chunks = std::vector<CParsedChunk>(ThreadPool()->GetThreadCount() + 1);
+    CMergeState state;
+    CMeshData mesh;
+
+    void Parse(const std::string_view text) {
+        const std::vector<std::string_view> parts = SplitByLines(text, chunks.size());
+        ThreadPool()->ParallelFor(parts.size(), [&](const std::size_t i) { ParseChunk(parts[i], chunks[i]); });
+
+        // Merging is ordered, because relative indices and welding depend on declaration order
+        for (std::size_t i = 0; i < parts.size(); ++i) {
+            MergeChunk(chunks[i], state, mesh);
+        }
+    }
+};
+}
+
+CMeshData ImportObj(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::format("Cannot open \"{}\"!", path.string()));
+    }
+
+    CObjImport import;
+    std::vector<char> window(CHUNK_BUDGET);
+
+    std::size_t carried = 0;
+    bool endOfFile = false;
+    while (!endOfFile) {
+        file.read(window.data() + carried, static_cast<std::streamsize>(window.size() - carried));
+        const std::size_t filled = carried + static_cast<std::size_t>(file.gcount());
+        endOfFile = !file;
+
+        // Only whole lines are parsed, the tail is carried into the next window
+        std::size_t usable = filled;
+        if (!endOfFile) {
+            const auto lastNewLine = std::find(window.rbegin() + (window.size() - filled), window.rend(), '\n');
+            if (lastNewLine == window.rend()) {
+                throw std::runtime_error(std::format("\"{}\" has a line longer than import chunk", path.string()));
+            }
+            usable = static_cast<std::size_t>(window.rend() - lastNewLine);
+        }
+
+        import.Parse({ window.data(), usable });
+
+        carried = filled - usable;
+        std::memmove(window.data(), window.data() + usable, carried);
+    }
+
+    return std::move(import.mesh);
+}
+
+CMeshData ImportObj(const std::span<const std::byte> data, const std::string_view name) {
+    const std::string_view text(reinterpret_cast<const char*>(data.data()), data.size());
+    CObjImport import;
+
+    // Already in memory, only cut into whole lines so the per-window buffers stay bounded
+    std::size_t offset = 0;
+    while (offset < text.size()) {
+        std::size_t usable = text.size() - offset;
+        if (usable > CHUNK_BUDGET) {
+            const std::size_t lastNewLine = text.substr(offset, CHUNK_BUDGET).rfind('\n');
+            if (lastNewLine == std::string_view::npos) {
+                throw std::runtime_error(std::format("\"{}\" has a line longer than import chunk", name));
+            }
+            usable = lastNewLine + 1;
+        }
+
+        import.Parse(text.substr(offset, usable));
+        offset += usable;
+    }
+
+    return std::move(import.mesh);
+}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace Mesh
+{
+// Loads all shapes of an OBJ file into one welded, triangulated mesh
+CMeshData ImportObj(const std::filesystem::path& path);
+// Same, from OBJ text already in memory. `name` only shows up in errors.
+CMeshData ImportObj(std::span<const std::byte> data, std::string_view name);
+}
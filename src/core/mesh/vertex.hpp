@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../render/vulkan/vertex_layout.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+
+// Full precision vertex produced by importers and consumed by mesh processing
+struct CVertex
+{
+    glm::vec3 pos;
+    glm::vec2 texCoord;
+
+    bool operator==(const CVertex& other) const { return pos == other.pos && texCoord == other.texCoord; }
+};
+
+// Quantized vertices store positions normalized to the mesh bounds and texture coordinates normalized
+// to their range, see CVertexQuantization. W of the position is padding.
+struct CHalfVertex
+{
+    Vulkan::CHalf4 pos;
+    Vulkan::CUnorm16x2 texCoord;
+};
+
+struct CSnormVertex
+{
+    Vulkan::CSnorm16x4 pos;
+    Vulkan::CUnorm16x2 texCoord;
+};
+
+using CFloatVertexLayout = Vulkan::CVertexLayout<
+    CVertex,
+    VERTEX_ATTRIBUTE(CVertex, pos, 0),
+    VERTEX_ATTRIBUTE(CVertex, texCoord, 1)>;
+
+using CHalfVertexLayout = Vulkan::CVertexLayout<
+    CHalfVertex,
+    VERTEX_ATTRIBUTE(CHalfVertex, pos, 0),
+    VERTEX_ATTRIBUTE(CHalfVertex, texCoord, 1)>;
+
+using CSnormVertexLayout = Vulkan::CVertexLayout<
+    CSnormVertex,
+    VERTEX_ATTRIBUTE(CSnormVertex, pos, 0),
+    VERTEX_ATTRIBUTE(CSnormVertex, texCoord, 1)>;
+
+// Vertex format of GPU vertex buffers, stored in cooked files
+enum class EVertexFormat : uint32_t
+{
+    Float = 0,
+    Half = 1,
+    Snorm16 = 2,
+};
+
+struct CVertexInputState
+{
+    vk::VertexInputBindingDescription binding;
+    std::span<const vk::VertexInputAttributeDescription> attributes;
+};
+
+template <typename Layout>
+constexpr CVertexInputState MakeVertexInputState() {
+    return { Layout::GetBindingDescription(), Layout::GetAttributeDescriptions() };
+}
+
+constexpr CVertexInputState GetVertexInputState(const EVertexFormat format) {
+    switch (format) {
+        case EVertexFormat::Half:
+            return MakeVertexInputState<CHalfVertexLayout>();
+        case EVertexFormat::Snorm16:
+            return MakeVertexInputState<CSnormVertexLayout>();
+        case EVertexFormat::Float:
+        default:
+            return MakeVertexInputState<CFloatVertexLayout>();
+    }
+}
+
+constexpr uint32_t GetVertexFormatStride(const EVertexFormat format) {
+    return GetVertexInputState(format).binding.stride;
+}
@@ -0,0 +1,128 @@
+#include "vertex_quantization.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace Mesh
+{
+namespace
+{
+// Keeps flat meshes and constant texture coordinates from producing a zero scale
+constexpr float MIN_QUANTIZATION_RANGE = 1e-6f;
+
+uint16_t FloatToHalf(const float value) {
+    const auto bits = std::bit_cast<uint32_t>(value);
+    const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const uint32_t magnitude = bits & 0x7FFFFFFF;
+
+    // Too large for half, infinity or NaN
+    if (magnitude >= 0x47800000) {
+        return sign | (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00);
+    }
+
+    // Subnormal half, counted in 2^-24 units
+    if (magnitude < 0x38800000) {
+        const float units = std::bit_cast<float>(magnitude) * 16777216.0f;
+        return sign | static_cast<uint16_t>(std::nearbyint(units));
+    }
+
+    // Rebias exponent from 127 to 15 and round mantissa to nearest even
+    const uint32_t rounded = magnitude + 0x0FFF + ((magnitude >> 13) & 1);
+    return sign | static_cast<uint16_t>((rounded - 0x38000000) >> 13);
+}
+
+int16_t FloatToSnorm16(const float value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+uint16_t FloatToUnorm16(const float value) {
+    return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+template <typename QuantizedVertex, typename EncodePosition>
+std::vector<std::byte> EncodeQuantizedVertices(
+    const std::span<const CVertex> vertices,
+    const CVertexQuantization& quantization,
+    EncodePosition&& encodePosition
+) {
+    std::vector<std::byte> result(vertices.size() * sizeof(QuantizedVertex));
+
+    const glm::vec3 positionScale = 1.0f / quantization.positionScale;
+    const glm::vec2 texCoordScale = 1.0f / quantization.texCoordScale;
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+        const glm::vec3 position = (vertices[i].pos - quantization.positionOffset) * positionScale;
+        const glm::vec2 texCoord = (vertices[i].texCoord - quantization.texCoordOffset) * texCoordScale;
+
+        QuantizedVertex vertex {};
+        vertex.pos.x = encodePosition(position.x);
+        vertex.pos.y = encodePosition(position.y);
+        vertex.pos.z = encodePosition(position.z);
+        vertex.texCoord.x = FloatToUnorm16(texCoord.x);
+        vertex.texCoord.y = FloatToUnorm16(texCoord.y);
+        std::memcpy(result.data() + i * sizeof(QuantizedVertex), &vertex, sizeof(vertex));
+    }
+
+    return result;
+}
+}
+
+CVertexQuantization ComputeVertexQuantization(const std::span<const CVertex> vertices, const EVertexFormat format) {
+    if (format == EVertexFormat::Float || vertices.empty()) {
+        return { glm::vec3 { 0.0f }, glm::vec3 { 1.0f }, glm::vec2 { 0.0f }, glm::vec2 { 1.0f } };
+    }
+
+    glm::vec3 positionMin { std::numeric_limits<float>::max() };
+    glm::vec3 positionMax { std::numeric_limits<float>::lowest() };
+    glm::vec2 texCoordMin { std::numeric_limits<float>::max() };
+    glm::vec2 texCoordMax { std::numeric_limits<float>::lowest() };
+    for (const CVertex& vertex : vertices) {
+        positionMin = glm::min(positionMin, vertex.pos);
+        positionMax = glm::max(positionMax, vertex.pos);
+        texCoordMin = glm::min(texCoordMin, vertex.texCoord);
+        texCoordMax = glm::max(texCoordMax, vertex.texCoord);
+    }
+
+    // Positions are centered, so the signed range is used symmetrically
+    CVertexQuantization quantization {};
+    quantization.positionOffset = (positionMin + positionMax) * 0.5f;
+    quantization.positionScale = glm::max((positionMax - positionMin) * 0.5f, glm::vec3 { MIN_QUANTIZATION_RANGE });
+    quantization.texCoordOffset = texCoordMin;
+    quantization.texCoordScale = glm::max(texCoordMax - texCoordMin, glm::vec2 { MIN_QUANTIZATION_RANGE });
+    return quantization;
+}
+
+std::vector<std::byte> EncodeVertices(
+    const std::span<const CVertex> vertices,
+    const EVertexFormat format,
+    const CVertexQuantization& quantization
+) {
+    switch (format) {
+        case EVertexFormat::Half:
+            return EncodeQuantizedVertices<CHalfVertex>(vertices, quantization, FloatToHalf);
+        case EVertexFormat::Snorm16:
+            return EncodeQuantizedVertices<CSnormVertex>(vertices, quantization, FloatToSnorm16);
+        case EVertexFormat::Float:
+        default:
+        {
+            const std::span<const std::byte> bytes = std::as_bytes(vertices);
+            return { bytes.begin(), bytes.end() };
+        }
+    }
+}
+
+glm::mat4 GetDequantizationMatrix(const CVertexQuantization& quantization) {
+    return glm::scale(glm::translate(glm::mat4(1.0f), quantization.positionOffset), quantization.positionScale);
+}
+
+glm::vec4 GetTexCoordTransform(const CVertexQuantization& quantization) {
+    return { quantization.texCoordOffset.x,
+             quantization.texCoordOffset.y,
+             quantization.texCoordScale.x,
+             quantization.texCoordScale.y };
+}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "vertex.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace Mesh
+{
+// Maps quantized vertex attributes back to mesh space:
+//     position = positionOffset + positionScale * pos.xyz   (pos in [-1, 1])
+//     texCoord = texCoordOffset + texCoordScale * texCoord  (texCoord in [0, 1])
+// Identity for EVertexFormat::Float.
+struct CVertexQuantization
+{
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+    glm::vec2 texCoordOffset;
+    glm::vec2 texCoordScale;
+};
+
+// Fits positions and texture coordinates of the mesh into the range of `format`
+CVertexQuantization ComputeVertexQuantization(std::span<const CVertex> vertices, EVertexFormat format);
+
+// Converts vertices to `format`, returns a buffer of GetVertexFormatStride(format) sized vertices
+std::vector<std::byte> EncodeVertices(
+    std::span<const CVertex> vertices,
+    EVertexFormat format,
+    const CVertexQuantization& quantization
+);
+
+// Position dequantization as a transform, so it can be folded into the model matrix
+glm::mat4 GetDequantizationMatrix(const CVertexQuantization& quantization);
+
+// Texture coordinate dequantization packed as offset.xy, scale.zw for shaders
+glm::vec4 GetTexCoordTransform(const CVertexQuantization& quantization);
+}
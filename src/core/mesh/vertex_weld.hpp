@@ -0,0 +1,92 @@
+#pragma once
+
+#include "hash.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace Mesh
+{
+// Flat open-addressing table that welds bitwise identical vertices.
+// Slots hold only a hash tag and an index into the caller's vertex array, so a lookup is one linear
+// probe over 8-byte slots that either finds the vertex or claims the empty slot it stopped at.
+template <typename Vertex>
+class CVertexWeldTable
+{
+    static_assert(std::is_trivially_copyable_v<Vertex>, "Vertices are hashed and compared as raw bytes");
+
+public:
+    explicit CVertexWeldTable(const std::size_t expectedVertices = 0) { Reserve(expectedVertices); }
+
+    // Sizes the table so that `expectedVertices` fit without rehashing
+    void Reserve(const std::size_t expectedVertices) {
+        const std::size_t capacity = std::bit_ceil(std::max<std::size_t>(MIN_CAPACITY, expectedVertices * 2));
+        if (capacity > m_slots.size()) {
+            _Rehash(capacity);
+        }
+    }
+
+    // Returns index of the vertex in `vertices`, appending it if no identical vertex was inserted before
+    uint32_t Insert(const Vertex& vertex, std::vector<Vertex>& vertices) {
+        // Load factor is kept at or below 1/2, so probe sequences stay short
+        if ((m_count + 1) * 2 > m_slots.size()) {
+            _Rehash(m_slots.size() * 2);
+        }
+
+        const auto tag = static_cast<uint32_t>(hash::Hash64(&vertex, sizeof(Vertex)));
+        for (std::size_t slot = tag & m_mask;; slot = (slot + 1) & m_mask) {
+            CSlot& entry = m_slots[slot];
+            if (entry.index == EMPTY_SLOT) {
+                entry.tag = tag;
+                entry.index = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(vertex);
+                ++m_count;
+                return entry.index;
+            }
+            if (entry.tag == tag && std::memcmp(&vertices[entry.index], &vertex, sizeof(Vertex)) == 0) {
+                return entry.index;
+            }
+        }
+    }
+
+    [[nodiscard]] std::size_t GetSize() const { return m_count; }
+
+private:
+    static constexpr std::size_t MIN_CAPACITY = 16;
+    static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    struct CSlot
+    {
+        uint32_t tag = 0;
+        uint32_t index = EMPTY_SLOT;
+    };
+
+    // The slot is derived from the stored tag, so growing never touches the vertices
+    void _Rehash(const std::size_t capacity) {
+        std::vector<CSlot> slots(capacity);
+        const std::size_t mask = capacity - 1;
+
+        for (const CSlot& entry : m_slots) {
+            if (entry.index == EMPTY_SLOT) {
+                continue;
+            }
+            std::size_t slot = entry.tag & mask;
+            while (slots[slot].index != EMPTY_SLOT) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = entry;
+        }
+
+        m_slots = std::move(slots);
+        m_mask = mask;
+    }
+
+    std::vector<CSlot> m_slots;
+    std::size_t m_mask = 0;
+    std::size_t m_count = 0;
+};
+}
@@ -2,6 +2,18 @@
 
 #include "../window.hpp"
 
+// Trades latency against frame rate and power. The renderer picks the present mode and the number of frames the
+// CPU may record ahead of the GPU from it.
+enum class EPresentPolicy
+{
+    // Mailbox or immediate, one frame in flight
+    LowLatency,
+    // Mailbox if available, two or three frames in flight
+    Throughput,
+    // FIFO, rendering is capped at the refresh rate
+    PowerSaving,
+};
+
 class IRenderer
 {
 public:
@@ -14,4 +26,6 @@ public:
 
     virtual bool Initialize(IWindow* window) = 0;
     virtual void Draw() = 0;
+    // Takes effect at the start of the next frame, no restart needed
+    virtual void SetPresentPolicy(EPresentPolicy policy) = 0;
 };
@@ -76,9 +76,11 @@ void CInstance::Create(IVulkanWindow* window) {
     //====================
     const void* instancePNextChain = nullptr;
 
+#ifdef _DEBUG
     if (debugMessengerAvailable) {
         instancePNextChain = &debugUtilsMessengerCreateInfo;
     }
+#endif
 
     //====================
     vk::InstanceCreateInfo instanceCreateInfo;
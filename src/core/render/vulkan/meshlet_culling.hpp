@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace Vulkan
+{
+// Workgroup size of shaders/cull.comp
+constexpr uint32_t MESHLET_CULL_GROUP_SIZE = 64;
+
+// Push constants of shaders/cull.comp. Fits the 128 bytes every device supports.
+struct CMeshletCullConstants
+{
+    // Normalized planes facing into the frustum
+    std::array<glm::vec4, 6> frustumPlanes;
+    glm::vec4 cameraPosition;
+    // Meshlets of the selected LOD
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+};
+
+static_assert(sizeof(CMeshletCullConstants) <= 128);
+
+// Draw command written by shaders/cull.comp, matches VkDrawIndexedIndirectCommand
+struct CDrawIndexedIndirectCommand
+{
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t firstInstance;
+};
+
+// Planes are extracted from the combined matrix (Gribb & Hartmann), so they are in the space meshlet bounds are in
+inline CMeshletCullConstants MakeMeshletCullConstants(
+    const glm::mat4& viewProjection,
+    const glm::vec3& cameraPosition,
+    const uint32_t firstMeshlet,
+    const uint32_t meshletCount
+) {
+    const auto row = [&](const int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    };
+
+    CMeshletCullConstants constants {};
+    constants.frustumPlanes = {
+        row(3) + row(0),
+        row(3) - row(0),
+        row(3) + row(1),
+        row(3) - row(1),
+        row(2), // Depth is [0, 1]
+        row(3) - row(2),
+    };
+    for (glm::vec4& plane : constants.frustumPlanes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    constants.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+    constants.firstMeshlet = firstMeshlet;
+    constants.meshletCount = meshletCount;
+    return constants;
+}
+}
@@ -0,0 +1,139 @@
+#include "pipeline_cache.hpp"
+
+#include "atomicfile.hpp"
+#include "console.hpp"
+#include "hash.hpp"
+#include "mappedfile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace Vulkan
+{
+namespace
+{
+constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43504B53; // "SKPC"
+constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+// Precedes the driver's data. The driver's own header only names the device, a driver update that keeps
+// the cache UUID and a truncated write are caught here.
+struct CPipelineCacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t driverVersion;
+    uint32_t padding;
+    uint64_t coldMicroseconds;
+    uint64_t dataSize;
+    uint64_t dataHash;
+};
+}
+
+void CPipelineCache::Create(
+    const vk::Device device,
+    const vk::PhysicalDeviceProperties& properties,
+    std::filesystem::path path
+) {
+    m_device = device;
+    m_path = std::move(path);
+    m_vendorId = properties.vendorID;
+    m_deviceId = properties.deviceID;
+    m_driverVersion = properties.driverVersion;
+    std::copy_n(properties.pipelineCacheUUID.data(), VK_UUID_SIZE, m_uuid.begin());
+
+    const auto isValid = [&](const CPipelineCacheFileHeader& header, const std::span<const std::byte> data) {
+        if (header.magic != PIPELINE_CACHE_MAGIC || header.version != PIPELINE_CACHE_VERSION ||
+            header.driverVersion != m_driverVersion || header.dataSize != data.size() ||
+            header.dataHash != hash::Hash64(data.data(), data.size())) {
+            return false;
+        }
+
+        VkPipelineCacheHeaderVersionOne driverHeader {};
+        if (data.size() < sizeof(driverHeader)) {
+            return false;
+        }
+        std::memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+        return driverHeader.headerSize >= sizeof(driverHeader) &&
+            driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+            driverHeader.vendorID == m_vendorId &&
+            driverHeader.deviceID == m_deviceId &&
+            std::equal(m_uuid.begin(), m_uuid.end(), driverHeader.pipelineCacheUUID);
+    };
+
+    vk::PipelineCacheCreateInfo cacheInfo {};
+
+    CMappedFile file;
+    if (file.Open(m_path, EMappedFileAccess::Sequential) && file.GetSize() >= sizeof(CPipelineCacheFileHeader)) {
+        CPipelineCacheFileHeader header {};
+        std::memcpy(&header, file.GetData(), sizeof(header));
+        const std::span<const std::byte> data = file.GetView().subspan(sizeof(header));
+
+        if (isValid(header, data)) {
+            cacheInfo.initialDataSize = data.size();
+            cacheInfo.pInitialData = data.data();
+            m_warm = true;
+            m_coldMicroseconds = header.coldMicroseconds;
+        } else {
+            Warning("Pipeline cache \"{}\" was written for another device or driver, starting cold", m_path.string());
+        }
+    }
+
+    m_handle = m_device.createPipelineCache(cacheInfo);
+}
+
+void CPipelineCache::Save() const {
+    std::lock_guard lock(m_mutex);
+
+    const std::vector<uint8_t> data = m_device.getPipelineCacheData(m_handle);
+
+    CPipelineCacheFileHeader header {};
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_VERSION;
+    header.driverVersion = m_driverVersion;
+    header.coldMicroseconds = m_coldMicroseconds;
+    header.dataSize = data.size();
+    header.dataHash = hash::Hash64(data.data(), data.size());
+
+    const bool written = WriteFileAtomically(m_path, [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    });
+    if (!written) {
+        Warning("Failed to write pipeline cache \"{}\"", m_path.string());
+    }
+}
+
+void CPipelineCache::Destroy() {
+    m_device.destroyPipelineCache(m_handle);
+    m_handle = nullptr;
+}
+
+vk::PipelineCache CPipelineCache::CreateWorkerCache() const {
+    return m_device.createPipelineCache(vk::PipelineCacheCreateInfo {});
+}
+
+void CPipelineCache::Merge(const vk::PipelineCache workerCache) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_device.mergePipelineCaches(m_handle, workerCache);
+    }
+    m_device.destroyPipelineCache(workerCache);
+}
+
+void CPipelineCache::ReportStartup(const std::chrono::microseconds elapsed) {
+    const double milliseconds = static_cast<double>(elapsed.count()) / 1000.0;
+    if (!m_warm) {
+        m_coldMicroseconds = static_cast<uint64_t>(elapsed.count());
+        Msg("Created startup pipelines in {:.1f} ms with a cold pipeline cache", milliseconds);
+        return;
+    }
+    Msg(
+        "Created startup pipelines in {:.1f} ms with a warm pipeline cache, {:.1f} ms cold",
+        milliseconds,
+        static_cast<double>(m_coldMicroseconds) / 1000.0
+    );
+}
+}
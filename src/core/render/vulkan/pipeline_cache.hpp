@@ -0,0 +1,58 @@
+#pragma once
+
+#include "vulkan.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+
+namespace Vulkan
+{
+// Pipeline cache kept on disk between runs, so the driver compiles each pipeline once per device and driver
+class CPipelineCache
+{
+public:
+    CPipelineCache() = default;
+    CPipelineCache(const CPipelineCache&) = delete;
+    CPipelineCache(CPipelineCache&&) = delete;
+    CPipelineCache& operator=(const CPipelineCache&) = delete;
+    CPipelineCache& operator=(CPipelineCache&&) = delete;
+    ~CPipelineCache() = default;
+
+    // Starts from `path` if it was written for the same vendor, device, driver and cache UUID, empty otherwise.
+    // Data of another GPU is never handed to the driver, some crash on it instead of ignoring it.
+    void Create(vk::Device device, const vk::PhysicalDeviceProperties& properties, std::filesystem::path path);
+    // Writes the cache back to where it was loaded from. Losing it only makes the next start cold.
+    void Save() const;
+    void Destroy();
+
+    // Only for the thread that called Create, other threads build into a cache of their own
+    [[nodiscard]] vk::PipelineCache GetHandle() const { return m_handle; }
+    [[nodiscard]] bool IsWarm() const { return m_warm; }
+
+    // Empty cache for pipelines built on another thread, so they don't contend on the driver's cache lock
+    [[nodiscard]] vk::PipelineCache CreateWorkerCache() const;
+    // Thread safe, destroys `workerCache`. Must not overlap with use of GetHandle().
+    void Merge(vk::PipelineCache workerCache);
+
+    // Logs the time it took to create the startup pipelines next to the time of the last cold start
+    void ReportStartup(std::chrono::microseconds elapsed);
+
+private:
+    vk::Device m_device {};
+    vk::PipelineCache m_handle {};
+    std::filesystem::path m_path {};
+    mutable std::mutex m_mutex {};
+
+    uint32_t m_vendorId = 0;
+    uint32_t m_deviceId = 0;
+    uint32_t m_driverVersion = 0;
+    std::array<uint8_t, VK_UUID_SIZE> m_uuid {};
+
+    bool m_warm = false;
+    // Stored with the cache, so warm starts can be compared against it
+    uint64_t m_coldMicroseconds = 0;
+};
+}
@@ -0,0 +1,93 @@
+#include "shader_compiler.hpp"
+
+#include "atomicfile.hpp"
+#include "console.hpp"
+#include "deriveddatacache.hpp"
+
+#include <shaderc/shaderc.hpp>
+
+#include <format>
+#include <ostream>
+#include <stdexcept>
+
+namespace Vulkan
+{
+namespace
+{
+shaderc_shader_kind GetShaderKind(const std::filesystem::path& source) {
+    const std::filesystem::path extension = source.extension();
+    if (extension == ".vert") {
+        return shaderc_vertex_shader;
+    }
+    if (extension == ".frag") {
+        return shaderc_fragment_shader;
+    }
+    if (extension == ".comp") {
+        return shaderc_compute_shader;
+    }
+    throw std::runtime_error(std::format("Unknown shader stage of \"{}\"!", source.string()));
+}
+
+void WriteSpirv(const std::filesystem::path& path, const std::span<const uint32_t> code) {
+    const bool written = WriteFileAtomically(path, [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(code.data()), static_cast<std::streamsize>(code.size_bytes()));
+    });
+    if (!written) {
+        throw std::runtime_error(std::format("Failed to write SPIR-V \"{}\"!", path.string()));
+    }
+}
+}
+
+CMappedFile CompileShader(const std::filesystem::path& source, const std::span<const CShaderDefine> defines) {
+    CMappedFile file;
+    if (!file.Open(source, EMappedFileAccess::Sequential)) {
+        throw std::runtime_error(std::format("Cannot open shader \"{}\"!", source.string()));
+    }
+    const shaderc_shader_kind kind = GetShaderKind(source);
+
+    // Lengths keep {"AB", ""} and {"A", "B"} apart
+    CDerivedDataKey key("spv", SHADER_COMPILER_VERSION);
+    key.Add(file.GetView()).Add(kind).Add(defines.size());
+    for (const CShaderDefine& define : defines) {
+        key.Add(define.name.size()).Add(define.name).Add(define.value.size()).Add(define.value);
+    }
+
+    const auto compile = [&](const std::filesystem::path& destination) {
+        // Same options as the glslc build step, so a reloaded shader behaves like the one built with the project
+        shaderc::CompileOptions options;
+        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+        for (const CShaderDefine& define : defines) {
+            options.AddMacroDefinition(define.name, define.value);
+        }
+
+        const std::string sourceName = source.filename().string();
+        const shaderc::Compiler compiler;
+        const shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(
+            reinterpret_cast<const char*>(file.GetData()),
+            file.GetSize(),
+            kind,
+            sourceName.c_str(),
+            options
+        );
+        if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+            throw std::runtime_error(std::format("Failed to compile \"{}\":\n{}", source.string(), result.GetErrorMessage()));
+        }
+        if (result.GetNumWarnings() > 0) {
+            Warning("{}", result.GetErrorMessage());
+        }
+
+        WriteSpirv(destination, { result.cbegin(), result.cend() });
+    };
+
+    CMappedFile spirv;
+    if (spirv.Open(DerivedDataCache()->Get(key, compile), EMappedFileAccess::Sequential)) {
+        return spirv;
+    }
+
+    DerivedDataCache()->Invalidate(key);
+    if (!spirv.Open(DerivedDataCache()->Get(key, compile), EMappedFileAccess::Sequential)) {
+        throw std::runtime_error(std::format("Failed to load freshly compiled shader \"{}\"!", source.string()));
+    }
+    return spirv;
+}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "mappedfile.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+
+namespace Vulkan
+{
+// Bump whenever the compile options change, so SPIR-V built with the old ones drops out of the cache
+constexpr uint32_t SHADER_COMPILER_VERSION = 1;
+
+struct CShaderDefine
+{
+    std::string name;
+    std::string value;
+};
+
+// Compiles GLSL to SPIR-V in-process, the stage is taken from the extension like glslc does (.vert, .frag, .comp).
+// Results are kept in DerivedDataCache() keyed by the source and `defines`, so only edited shaders are compiled.
+// Sources can't #include other files, their contents wouldn't be part of the key.
+// Throws with the compiler's messages if the shader doesn't compile.
+CMappedFile CompileShader(const std::filesystem::path& source, std::span<const CShaderDefine> defines = {});
+}
@@ -0,0 +1,483 @@
+#include "shader_reflection.hpp"
+
+#include "hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <map>
+#include <optional>
+#include <stdexcept>
+
+namespace Vulkan
+{
+namespace
+{
+constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+constexpr std::size_t SPIRV_HEADER_WORDS = 5;
+
+// Opcodes, see the SPIR-V specification
+constexpr uint32_t OP_ENTRY_POINT = 15;
+constexpr uint32_t OP_TYPE_INT = 21;
+constexpr uint32_t OP_TYPE_FLOAT = 22;
+constexpr uint32_t OP_TYPE_VECTOR = 23;
+constexpr uint32_t OP_TYPE_MATRIX = 24;
+constexpr uint32_t OP_TYPE_IMAGE = 25;
+constexpr uint32_t OP_TYPE_SAMPLER = 26;
+constexpr uint32_t OP_TYPE_SAMPLED_IMAGE = 27;
+constexpr uint32_t OP_TYPE_ARRAY = 28;
+constexpr uint32_t OP_TYPE_RUNTIME_ARRAY = 29;
+constexpr uint32_t OP_TYPE_STRUCT = 30;
+constexpr uint32_t OP_TYPE_POINTER = 32;
+constexpr uint32_t OP_CONSTANT = 43;
+constexpr uint32_t OP_VARIABLE = 59;
+constexpr uint32_t OP_DECORATE = 71;
+constexpr uint32_t OP_MEMBER_DECORATE = 72;
+
+constexpr uint32_t DECORATION_BLOCK = 2;
+constexpr uint32_t DECORATION_BUFFER_BLOCK = 3;
+constexpr uint32_t DECORATION_ARRAY_STRIDE = 6;
+constexpr uint32_t DECORATION_MATRIX_STRIDE = 7;
+constexpr uint32_t DECORATION_BINDING = 33;
+constexpr uint32_t DECORATION_DESCRIPTOR_SET = 34;
+constexpr uint32_t DECORATION_OFFSET = 35;
+
+constexpr uint32_t STORAGE_CLASS_UNIFORM_CONSTANT = 0;
+constexpr uint32_t STORAGE_CLASS_UNIFORM = 2;
+constexpr uint32_t STORAGE_CLASS_PUSH_CONSTANT = 9;
+constexpr uint32_t STORAGE_CLASS_STORAGE_BUFFER = 12;
+
+constexpr uint32_t DIM_BUFFER = 5;
+
+struct CDecorations
+{
+    std::optional<uint32_t> set;
+    std::optional<uint32_t> binding;
+    uint32_t arrayStride = 0;
+    bool block = false;
+    bool bufferBlock = false;
+    std::vector<uint32_t> memberOffsets;
+    std::vector<uint32_t> memberMatrixStrides;
+};
+
+class CSpirvModule
+{
+public:
+    explicit CSpirvModule(const std::span<const std::byte> spirv) {
+        if (spirv.size() < SPIRV_HEADER_WORDS * sizeof(uint32_t) || spirv.size() % sizeof(uint32_t) != 0) {
+            throw std::runtime_error("SPIR-V is truncated!");
+        }
+        m_words.resize(spirv.size() / sizeof(uint32_t));
+        std::memcpy(m_words.data(), spirv.data(), spirv.size());
+        if (m_words[0] != SPIRV_MAGIC) {
+            throw std::runtime_error("Not a SPIR-V module!");
+        }
+
+        const uint32_t bound = m_words[3];
+        m_definitions.resize(bound);
+        m_decorations.resize(bound);
+
+        for (std::size_t offset = SPIRV_HEADER_WORDS; offset < m_words.size();) {
+            const uint32_t wordCount = m_words[offset] >> 16;
+            if (wordCount == 0 || offset + wordCount > m_words.size()) {
+                throw std::runtime_error("SPIR-V instruction runs past the end of the module!");
+            }
+            _ParseInstruction({ m_words.data() + offset, wordCount });
+            offset += wordCount;
+        }
+
+        if (!m_executionModel) {
+            throw std::runtime_error("SPIR-V module has no entry point!");
+        }
+    }
+
+    [[nodiscard]] uint32_t GetExecutionModel() const { return *m_executionModel; }
+    [[nodiscard]] const std::vector<uint32_t>& GetVariables() const { return m_variables; }
+    [[nodiscard]] const CDecorations& GetDecorations(const uint32_t id) const { return m_decorations[id]; }
+
+    // Instruction that defines `id`
+    [[nodiscard]] std::span<const uint32_t> GetDefinition(const uint32_t id) const {
+        if (id >= m_definitions.size() || m_definitions[id].empty()) {
+            throw std::runtime_error(std::format("SPIR-V id {} is used but never defined!", id));
+        }
+        return m_definitions[id];
+    }
+
+    [[nodiscard]] uint32_t GetOpcode(const uint32_t id) const { return GetDefinition(id)[0] & 0xFFFF; }
+
+    // Operand `index` of the definition of `id`, counting the opcode word as 0
+    [[nodiscard]] uint32_t GetOperand(const uint32_t id, const std::size_t index) const {
+        const std::span<const uint32_t> definition = GetDefinition(id);
+        if (index >= definition.size()) {
+            throw std::runtime_error(std::format("SPIR-V definition of id {} is too short!", id));
+        }
+        return definition[index];
+    }
+
+    // Element count of an OpTypeArray, 1 for anything else
+    [[nodiscard]] uint32_t GetArrayLength(const uint32_t type) const {
+        if (GetOpcode(type) != OP_TYPE_ARRAY) {
+            return 1;
+        }
+        return GetOperand(GetOperand(type, 3), 3);
+    }
+
+    // Size in bytes of a type laid out in a block, following its offset and stride decorations
+    [[nodiscard]] uint32_t GetTypeSize(const uint32_t type) const {
+        switch (GetOpcode(type)) {
+            case OP_TYPE_INT:
+            case OP_TYPE_FLOAT:
+                return GetOperand(type, 2) / 8;
+            case OP_TYPE_VECTOR:
+            case OP_TYPE_MATRIX:
+                return GetOperand(type, 3) * GetTypeSize(GetOperand(type, 2));
+            case OP_TYPE_ARRAY: {
+                const uint32_t stride = m_decorations[type].arrayStride;
+                return GetArrayLength(type) * (stride != 0 ? stride : GetTypeSize(GetOperand(type, 2)));
+            }
+            case OP_TYPE_STRUCT: {
+                const CDecorations& decorations = m_decorations[type];
+                const std::span<const uint32_t> definition = GetDefinition(type);
+                uint32_t size = 0;
+                for (std::size_t member = 0; member + 2 < definition.size(); ++member) {
+                    const uint32_t memberType = definition[member + 2];
+                    const uint32_t offset = member < decorations.memberOffsets.size() ? decorations.memberOffsets[member] : 0;
+                    uint32_t memberSize = GetTypeSize(memberType);
+                    if (GetOpcode(memberType) == OP_TYPE_MATRIX && member < decorations.memberMatrixStrides.size() &&
+                        decorations.memberMatrixStrides[member] != 0) {
+                        memberSize = GetOperand(memberType, 3) * decorations.memberMatrixStrides[member];
+                    }
+                    size = std::max(size, offset + memberSize);
+                }
+                return size;
+            }
+            default:
+                return 0;
+        }
+    }
+
+private:
+    void _ParseInstruction(const std::span<const uint32_t> instruction) {
+        const auto require = [&](const std::size_t words) {
+            if (instruction.size() < words) {
+                throw std::runtime_error("SPIR-V instruction is too short!");
+            }
+        };
+        const auto define = [&](const uint32_t id) {
+            if (id >= m_definitions.size()) {
+                throw std::runtime_error(std::format("SPIR-V id {} is out of bounds!", id));
+            }
+            m_definitions[id] = instruction;
+        };
+        const auto decorations = [&](const uint32_t id) -> CDecorations& {
+            if (id >= m_decorations.size()) {
+                throw std::runtime_error(std::format("SPIR-V id {} is out of bounds!", id));
+            }
+            return m_decorations[id];
+        };
+
+        switch (instruction[0] & 0xFFFF) {
+            case OP_ENTRY_POINT:
+                require(3);
+                if (!m_executionModel) {
+                    m_executionModel = instruction[1];
+                }
+                break;
+            case OP_DECORATE: {
+                require(3);
+                CDecorations& target = decorations(instruction[1]);
+                switch (instruction[2]) {
+                    case DECORATION_BLOCK:
+                        target.block = true;
+                        break;
+                    case DECORATION_BUFFER_BLOCK:
+                        target.bufferBlock = true;
+                        break;
+                    case DECORATION_ARRAY_STRIDE:
+                        require(4);
+                        target.arrayStride = instruction[3];
+                        break;
+                    case DECORATION_BINDING:
+                        require(4);
+                        target.binding = instruction[3];
+                        break;
+                    case DECORATION_DESCRIPTOR_SET:
+                        require(4);
+                        target.set = instruction[3];
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            }
+            case OP_MEMBER_DECORATE: {
+                require(4);
+                CDecorations& target = decorations(instruction[1]);
+                const uint32_t member = instruction[2];
+                const auto setMember = [&](std::vector<uint32_t>& values) {
+                    require(5);
+                    if (member >= values.size()) {
+                        values.resize(member + 1, 0);
+                    }
+                    values[member] = instruction[4];
+                };
+                if (instruction[3] == DECORATION_OFFSET) {
+                    setMember(target.memberOffsets);
+                } else if (instruction[3] == DECORATION_MATRIX_STRIDE) {
+                    setMember(target.memberMatrixStrides);
+                }
+                break;
+            }
+            case OP_TYPE_INT:
+            case OP_TYPE_FLOAT:
+            case OP_TYPE_VECTOR:
+            case OP_TYPE_MATRIX:
+            case OP_TYPE_IMAGE:
+            case OP_TYPE_SAMPLER:
+            case OP_TYPE_SAMPLED_IMAGE:
+            case OP_TYPE_ARRAY:
+            case OP_TYPE_RUNTIME_ARRAY:
+            case OP_TYPE_STRUCT:
+            case OP_TYPE_POINTER:
+                require(2);
+                define(instruction[1]);
+                break;
+            case OP_CONSTANT:
+                require(4);
+                define(instruction[2]);
+                break;
+            case OP_VARIABLE:
+                require(4);
+                define(instruction[2]);
+                m_variables.push_back(instruction[2]);
+                break;
+            default:
+                break;
+        }
+    }
+
+    std::vector<uint32_t> m_words;
+    // Views into m_words, empty for ids that aren't types, constants or variables
+    std::vector<std::span<const uint32_t>> m_definitions;
+    std::vector<CDecorations> m_decorations;
+    std::vector<uint32_t> m_variables;
+    std::optional<uint32_t> m_executionModel;
+};
+
+vk::ShaderStageFlagBits GetShaderStage(const uint32_t executionModel) {
+    switch (executionModel) {
+        case 0:
+            return vk::ShaderStageFlagBits::eVertex;
+        case 1:
+            return vk::ShaderStageFlagBits::eTessellationControl;
+        case 2:
+            return vk::ShaderStageFlagBits::eTessellationEvaluation;
+        case 3:
+            return vk::ShaderStageFlagBits::eGeometry;
+        case 4:
+            return vk::ShaderStageFlagBits::eFragment;
+        case 5:
+            return vk::ShaderStageFlagBits::eCompute;
+        default:
+            throw std::runtime_error(std::format("Unsupported SPIR-V execution model {}!", executionModel));
+    }
+}
+
+// Type of the descriptor behind a variable, nullopt for variables that aren't descriptors
+std::optional<vk::DescriptorType> GetDescriptorType(const CSpirvModule& module, const uint32_t storageClass, uint32_t type) {
+    if (module.GetOpcode(type) == OP_TYPE_ARRAY || module.GetOpcode(type) == OP_TYPE_RUNTIME_ARRAY) {
+        type = module.GetOperand(type, 2);
+    }
+
+    switch (storageClass) {
+        case STORAGE_CLASS_UNIFORM_CONSTANT:
+            switch (module.GetOpcode(type)) {
+                case OP_TYPE_SAMPLED_IMAGE:
+                    return vk::DescriptorType::eCombinedImageSampler;
+                case OP_TYPE_SAMPLER:
+                    return vk::DescriptorType::eSampler;
+                case OP_TYPE_IMAGE: {
+                    // Sampled is 1 for images read through a sampler and 2 for storage images
+                    const bool storage = module.GetOperand(type, 7) == 2;
+                    if (module.GetOperand(type, 3) == DIM_BUFFER) {
+                        return storage ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+                    }
+                    return storage ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+                }
+                default:
+                    return std::nullopt;
+            }
+        case STORAGE_CLASS_UNIFORM:
+            // SPIR-V 1.0, which glslc targets for Vulkan 1.0, marks storage buffers as BufferBlock
+            return module.GetDecorations(type).bufferBlock ? vk::DescriptorType::eStorageBuffer
+                                                           : vk::DescriptorType::eUniformBuffer;
+        case STORAGE_CLASS_STORAGE_BUFFER:
+            return vk::DescriptorType::eStorageBuffer;
+        default:
+            return std::nullopt;
+    }
+}
+
+uint64_t HashBinding(const vk::DescriptorSetLayoutBinding& binding, uint64_t seed) {
+    // Field by field, the struct has padding and a pointer
+    const uint32_t fields[] = {
+        binding.binding,
+        static_cast<uint32_t>(binding.descriptorType),
+        binding.descriptorCount,
+        static_cast<uint32_t>(binding.stageFlags),
+    };
+    return hash::Hash64(fields, sizeof(fields), seed);
+}
+}
+
+CShaderReflection ReflectShader(const std::span<const std::byte> spirv) {
+    const CSpirvModule module(spirv);
+
+    CShaderReflection reflection {};
+    reflection.stage = GetShaderStage(module.GetExecutionModel());
+
+    for (const uint32_t variable : module.GetVariables()) {
+        const uint32_t pointerType = module.GetOperand(variable, 1);
+        const uint32_t storageClass = module.GetOperand(variable, 3);
+        const uint32_t type = module.GetOperand(pointerType, 3);
+
+        if (storageClass == STORAGE_CLASS_PUSH_CONSTANT) {
+            reflection.pushConstantSize = std::max(reflection.pushConstantSize, module.GetTypeSize(type));
+            continue;
+        }
+
+        const CDecorations& decorations = module.GetDecorations(variable);
+        if (!decorations.binding) {
+            continue;
+        }
+        const std::optional<vk::DescriptorType> descriptorType = GetDescriptorType(module, storageClass, type);
+        if (!descriptorType) {
+            continue;
+        }
+
+        reflection.bindings.push_back({
+            decorations.set.value_or(0),
+            *decorations.binding,
+            *descriptorType,
+            module.GetArrayLength(type),
+        });
+    }
+
+    return reflection;
+}
+
+void CLayoutCache::Destroy() {
+    std::lock_guard lock(m_mutex);
+    for (const auto& [hash, layout] : m_pipelineLayouts) {
+        m_device.destroyPipelineLayout(layout.handle);
+    }
+    for (const auto& [hash, setLayout] : m_setLayouts) {
+        m_device.destroyDescriptorSetLayout(setLayout);
+    }
+    m_pipelineLayouts.clear();
+    m_setLayouts.clear();
+}
+
+const CPipelineLayout& CLayoutCache::GetPipelineLayout(const std::span<const CShaderReflection> stages) {
+    // Ordered, so the same resources hash the same whatever order the stages declare them in
+    std::map<uint32_t, std::map<uint32_t, vk::DescriptorSetLayoutBinding>> sets;
+    vk::PushConstantRange pushConstants {};
+
+    for (const CShaderReflection& stage : stages) {
+        for (const CShaderBinding& shaderBinding : stage.bindings) {
+            vk::DescriptorSetLayoutBinding& binding = sets[shaderBinding.set][shaderBinding.binding];
+            if (binding.descriptorCount != 0 && binding.descriptorType != shaderBinding.type) {
+                throw std::runtime_error(std::format(
+                    "Stages declare set {} binding {} with different descriptor types!",
+                    shaderBinding.set,
+                    shaderBinding.binding
+                ));
+            }
+            binding.binding = shaderBinding.binding;
+            binding.descriptorType = shaderBinding.type;
+            binding.descriptorCount = std::max(binding.descriptorCount, shaderBinding.count);
+            binding.stageFlags |= stage.stage;
+        }
+        if (stage.pushConstantSize != 0) {
+            pushConstants.stageFlags |= stage.stage;
+            pushConstants.size = std::max(pushConstants.size, stage.pushConstantSize);
+        }
+    }
+
+    const uint32_t setCount = sets.empty() ? 0 : sets.rbegin()->first + 1;
+    std::vector<std::vector<vk::DescriptorSetLayoutBinding>> setBindings(setCount);
+    std::vector<uint64_t> setHashes(setCount);
+    uint64_t pipelineHash = hash::Hash64(&setCount, sizeof(setCount));
+    for (uint32_t set = 0; set < setCount; ++set) {
+        if (const auto it = sets.find(set); it != sets.end()) {
+            for (const auto& [number, binding] : it->second) {
+                setBindings[set].push_back(binding);
+            }
+        }
+
+        const uint64_t bindingCount = setBindings[set].size();
+        setHashes[set] = hash::Hash64(&bindingCount, sizeof(bindingCount));
+        for (const vk::DescriptorSetLayoutBinding& binding : setBindings[set]) {
+            setHashes[set] = HashBinding(binding, setHashes[set]);
+        }
+        pipelineHash = hash::Hash64(&setHashes[set], sizeof(setHashes[set]), pipelineHash);
+    }
+    const uint32_t pushConstantFields[] = { static_cast<uint32_t>(pushConstants.stageFlags), pushConstants.size };
+    pipelineHash = hash::Hash64(pushConstantFields, sizeof(pushConstantFields), pipelineHash);
+
+    std::lock_guard lock(m_mutex);
+    if (const auto it = m_pipelineLayouts.find(pipelineHash); it != m_pipelineLayouts.end()) {
+        return it->second;
+    }
+
+    CPipelineLayout layout {};
+    for (uint32_t set = 0; set < setCount; ++set) {
+        layout.setLayouts.push_back(_GetSetLayout(setBindings[set], setHashes[set]));
+
+        for (const vk::DescriptorSetLayoutBinding& binding : setBindings[set]) {
+            const auto poolSize = std::ranges::find(layout.poolSizes, binding.descriptorType, &vk::DescriptorPoolSize::type);
+            if (poolSize != layout.poolSizes.end()) {
+                poolSize->descriptorCount += binding.descriptorCount;
+            } else {
+                layout.poolSizes.push_back({ binding.descriptorType, binding.descriptorCount });
+            }
+        }
+    }
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo {};
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layout.setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = layout.setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = pushConstants.size != 0 ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstants;
+
+    layout.handle = m_device.createPipelineLayout(pipelineLayoutInfo);
+    return m_pipelineLayouts.emplace(pipelineHash, std::move(layout)).first->second;
+}
+
+std::size_t CLayoutCache::GetPipelineLayoutCount() const {
+    std::lock_guard lock(m_mutex);
+    return m_pipelineLayouts.size();
+}
+
+std::size_t CLayoutCache::GetSetLayoutCount() const {
+    std::lock_guard lock(m_mutex);
+    return m_setLayouts.size();
+}
+
+vk::DescriptorSetLayout CLayoutCache::_GetSetLayout(
+    const std::span<const vk::DescriptorSetLayoutBinding> bindings,
+    const uint64_t hash
+) {
+    if (const auto it = m_setLayouts.find(hash); it != m_setLayouts.end()) {
+        return it->second;
+    }
+
+    vk::DescriptorSetLayoutCreateInfo layoutInfo {};
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    const vk::DescriptorSetLayout setLayout = m_device.createDescriptorSetLayout(layoutInfo);
+    m_setLayouts.emplace(hash, setLayout);
+    return setLayout;
+}
+}
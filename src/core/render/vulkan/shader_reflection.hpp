@@ -0,0 +1,77 @@
+#pragma once
+
+#include "vulkan.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace Vulkan
+{
+// Descriptor a shader declares with layout(set = ..., binding = ...)
+struct CShaderBinding
+{
+    uint32_t set;
+    uint32_t binding;
+    vk::DescriptorType type;
+    // Length of a descriptor array, 1 otherwise
+    uint32_t count;
+};
+
+// Resources a shader module uses, read from its SPIR-V
+struct CShaderReflection
+{
+    vk::ShaderStageFlagBits stage;
+    std::vector<CShaderBinding> bindings;
+    // 0 without a push constant block
+    uint32_t pushConstantSize = 0;
+};
+
+// Reads the stage of the first entry point, its descriptors and push constants. Throws on malformed SPIR-V.
+CShaderReflection ReflectShader(std::span<const std::byte> spirv);
+
+// Pipeline layout with the set layouts it was built from, owned by CLayoutCache
+struct CPipelineLayout
+{
+    vk::PipelineLayout handle;
+    // Indexed by set number, unused sets in between are empty layouts
+    std::vector<vk::DescriptorSetLayout> setLayouts;
+    // Descriptors one copy of every set takes from a pool
+    std::vector<vk::DescriptorPoolSize> poolSizes;
+};
+
+// Builds layouts from reflected shaders. Pipelines with the same resources share one pipeline layout and
+// sets with the same bindings one set layout, they are looked up by a hash of their bindings.
+class CLayoutCache
+{
+public:
+    CLayoutCache() = default;
+    CLayoutCache(const CLayoutCache&) = delete;
+    CLayoutCache(CLayoutCache&&) = delete;
+    CLayoutCache& operator=(const CLayoutCache&) = delete;
+    CLayoutCache& operator=(CLayoutCache&&) = delete;
+    ~CLayoutCache() = default;
+
+    void Create(vk::Device device) { m_device = device; }
+    void Destroy();
+
+    // Merges the bindings and push constants of every stage of a pipeline, a binding used by several stages is
+    // visible to all of them. Throws if stages disagree on the type of a binding. Thread safe, the result stays
+    // valid until Destroy.
+    const CPipelineLayout& GetPipelineLayout(std::span<const CShaderReflection> stages);
+
+    [[nodiscard]] std::size_t GetPipelineLayoutCount() const;
+    [[nodiscard]] std::size_t GetSetLayoutCount() const;
+
+private:
+    vk::DescriptorSetLayout _GetSetLayout(std::span<const vk::DescriptorSetLayoutBinding> bindings, uint64_t hash);
+
+    vk::Device m_device {};
+    mutable std::mutex m_mutex {};
+    std::unordered_map<uint64_t, vk::DescriptorSetLayout> m_setLayouts {};
+    std::unordered_map<uint64_t, CPipelineLayout> m_pipelineLayouts {};
+};
+}
@@ -0,0 +1,386 @@
+#include "upload_manager.hpp"
+
+#include <cstring>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace Vulkan
+{
+namespace
+{
+// Keeps every copy source aligned for any texel block and for optimalBufferCopyOffsetAlignment on common GPUs
+constexpr vk::DeviceSize UPLOAD_ALIGNMENT = 16;
+
+vk::DeviceSize AlignUp(const vk::DeviceSize value, const vk::DeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+}
+
+void CUploadManager::Create(
+    const vk::Device device,
+    const vma::Allocator allocator,
+    const uint32_t graphicsFamily,
+    const vk::Queue graphicsQueue,
+    const std::optional<uint32_t> transferFamily,
+    const vk::Queue transferQueue,
+    const vk::DeviceSize ringSize
+) {
+    m_device = device;
+    m_allocator = allocator;
+    m_graphicsFamily = graphicsFamily;
+    m_graphicsQueue = graphicsQueue;
+    m_transferFamily = transferFamily.value_or(graphicsFamily);
+    m_transferQueue = transferFamily.has_value() ? transferQueue : graphicsQueue;
+
+    vk::SemaphoreTypeCreateInfo semaphoreType {};
+    semaphoreType.semaphoreType = vk::SemaphoreType::eTimeline;
+    semaphoreType.initialValue = 0;
+
+    vk::SemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.pNext = &semaphoreType;
+    m_semaphore = m_device.createSemaphore(semaphoreInfo);
+
+    vk::CommandPoolCreateInfo poolInfo {};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+    poolInfo.queueFamilyIndex = m_transferFamily;
+    m_transferPool = m_device.createCommandPool(poolInfo);
+
+    if (HasDedicatedTransferQueue()) {
+        poolInfo.queueFamilyIndex = m_graphicsFamily;
+        m_acquirePool = m_device.createCommandPool(poolInfo);
+    }
+
+    m_ringSize = ringSize;
+    m_ring = _CreateStagingBuffer(m_ringSize, vma::AllocationCreateFlagBits::eHostAccessSequentialWrite);
+    m_ringData = static_cast<std::byte*>(m_allocator.mapMemory(m_ring.allocation));
+}
+
+void CUploadManager::Destroy() {
+    if (!m_device) {
+        return;
+    }
+
+    Wait(Flush());
+    _RetireBatches(m_submittedValue);
+
+    m_allocator.unmapMemory(m_ring.allocation);
+    m_allocator.destroyBuffer(m_ring.buffer, m_ring.allocation);
+    m_ring = {};
+    m_ringData = nullptr;
+
+    if (m_acquirePool) {
+        m_device.destroyCommandPool(m_acquirePool);
+        m_acquirePool = nullptr;
+    }
+    m_device.destroyCommandPool(m_transferPool);
+    m_transferPool = nullptr;
+    m_device.destroySemaphore(m_semaphore);
+    m_semaphore = nullptr;
+    m_device = nullptr;
+}
+
+void CUploadManager::UploadBuffer(
+    const vk::Buffer destination,
+    const vk::DeviceSize offset,
+    const std::span<const std::byte> data
+) {
+    if (data.empty()) {
+        return;
+    }
+
+    if (const std::optional<vk::DeviceSize> ringOffset = _AllocateRing(data.size())) {
+        std::memcpy(m_ringData + *ringOffset, data.data(), data.size());
+        _RecordBufferCopy(m_ring.buffer, *ringOffset, destination, offset, data.size());
+        return;
+    }
+
+    CStagingBuffer staging = _CreateStagingBuffer(data.size(), vma::AllocationCreateFlagBits::eHostAccessSequentialWrite);
+    void* mapped = m_allocator.mapMemory(staging.allocation);
+    std::memcpy(mapped, data.data(), data.size());
+    m_allocator.unmapMemory(staging.allocation);
+
+    _RecordBufferCopy(staging.buffer, 0, destination, offset, data.size());
+    m_recording.stagingBuffers.push_back(staging);
+}
+
+void CUploadManager::CopyBufferToImage(
+    const vk::Buffer source,
+    const vk::Image image,
+    const vk::ImageSubresourceRange& range,
+    const std::span<const vk::BufferImageCopy> regions
+) {
+    _BeginRecording();
+
+    vk::ImageMemoryBarrier barrier {};
+    barrier.oldLayout = vk::ImageLayout::eUndefined;
+    barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.srcQueueFamilyIndex = vk::QueueFamilyIgnored;
+    barrier.dstQueueFamilyIndex = vk::QueueFamilyIgnored;
+    barrier.image = image;
+    barrier.subresourceRange = range;
+    barrier.srcAccessMask = {};
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+    m_recording.transferCommands.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTopOfPipe,
+        vk::PipelineStageFlagBits::eTransfer,
+        {}, nullptr, nullptr, barrier
+    );
+
+    m_recording.transferCommands.copyBufferToImage(source, image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+    // With a transfer queue of its own this releases the image, the acquire below repeats the same transition
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    if (HasDedicatedTransferQueue()) {
+        barrier.srcQueueFamilyIndex = m_transferFamily;
+        barrier.dstQueueFamilyIndex = m_graphicsFamily;
+        barrier.dstAccessMask = {};
+    }
+
+    m_recording.transferCommands.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        HasDedicatedTransferQueue() ? vk::PipelineStageFlagBits::eBottomOfPipe : vk::PipelineStageFlagBits::eAllCommands,
+        {}, nullptr, nullptr, barrier
+    );
+
+    if (HasDedicatedTransferQueue()) {
+        barrier.srcAccessMask = {};
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        m_recording.acquireCommands.pipelineBarrier(
+            vk::PipelineStageFlagBits::eAllCommands,
+            vk::PipelineStageFlagBits::eAllCommands,
+            {}, nullptr, nullptr, barrier
+        );
+    }
+}
+
+void CUploadManager::ReleaseAfterUpload(std::function<void()> release) {
+    if (!m_isRecording && m_inFlight.empty()) {
+        release();
+        return;
+    }
+    if (m_isRecording) {
+        m_recording.releases.push_back(std::move(release));
+    } else {
+        m_inFlight.back().releases.push_back(std::move(release));
+    }
+}
+
+uint64_t CUploadManager::Flush() {
+    if (!m_isRecording) {
+        return m_submittedValue;
+    }
+    m_isRecording = false;
+
+    CBatch batch = std::move(m_recording);
+    m_recording = {};
+
+    batch.transferCommands.end();
+
+    vk::SubmitInfo submitInfo {};
+    vk::TimelineSemaphoreSubmitInfo timelineInfo {};
+    submitInfo.pNext = &timelineInfo;
+
+    const uint64_t copiedValue = ++m_nextValue;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.transferCommands;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_semaphore;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &copiedValue;
+    m_transferQueue.submit(submitInfo);
+    batch.value = copiedValue;
+
+    if (HasDedicatedTransferQueue()) {
+        batch.acquireCommands.end();
+
+        // Waiting for the copies on the graphics queue also orders every later graphics submission after them
+        const vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+        const uint64_t acquiredValue = ++m_nextValue;
+        submitInfo.pCommandBuffers = &batch.acquireCommands;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &m_semaphore;
+        submitInfo.pWaitDstStageMask = &waitStage;
+        timelineInfo.waitSemaphoreValueCount = 1;
+        timelineInfo.pWaitSemaphoreValues = &copiedValue;
+        timelineInfo.pSignalSemaphoreValues = &acquiredValue;
+        m_graphicsQueue.submit(submitInfo);
+        batch.value = acquiredValue;
+    }
+
+    m_submittedValue = batch.value;
+    m_inFlight.push_back(std::move(batch));
+    return m_submittedValue;
+}
+
+void CUploadManager::Update() {
+    if (!m_inFlight.empty()) {
+        _RetireBatches(GetCompletedValue());
+    }
+}
+
+void CUploadManager::Wait(const uint64_t value) const {
+    vk::SemaphoreWaitInfo waitInfo {};
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &value;
+
+    if (m_device.waitSemaphores(waitInfo, std::numeric_limits<uint64_t>::max()) != vk::Result::eSuccess) {
+        throw std::runtime_error(std::format("Timed out waiting for upload {}!", value));
+    }
+}
+
+CUploadManager::CStagingBuffer CUploadManager::_CreateStagingBuffer(
+    const vk::DeviceSize size,
+    const vma::AllocationCreateFlags flags
+) const {
+    vk::BufferCreateInfo bufferInfo {};
+    bufferInfo.size = size;
+    bufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+    bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+    vma::AllocationCreateInfo allocInfo = {};
+    allocInfo.usage = vma::MemoryUsage::eAuto;
+    allocInfo.requiredFlags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    allocInfo.flags = flags;
+
+    const std::pair<vk::Buffer, vma::Allocation> buffer = m_allocator.createBuffer(bufferInfo, allocInfo);
+    return { buffer.first, buffer.second };
+}
+
+std::optional<vk::DeviceSize> CUploadManager::_AllocateRing(const vk::DeviceSize size) {
+    const vk::DeviceSize alignedSize = AlignUp(size, UPLOAD_ALIGNMENT);
+    if (alignedSize > m_ringSize) {
+        return std::nullopt;
+    }
+
+    for (;;) {
+        if (m_ringUsed == 0) {
+            m_ringHead = 0;
+        }
+
+        // Allocations never wrap, the tail end of the ring is skipped instead and freed with this batch
+        vk::DeviceSize offset = m_ringHead;
+        vk::DeviceSize skipped = 0;
+        if (offset + alignedSize > m_ringSize) {
+            skipped = m_ringSize - offset;
+            offset = 0;
+        }
+
+        if (m_ringUsed + skipped + alignedSize <= m_ringSize) {
+            _BeginRecording();
+            m_ringHead = offset + alignedSize;
+            m_ringUsed += skipped + alignedSize;
+            m_recording.ringBytes += skipped + alignedSize;
+            return offset;
+        }
+
+        // Full. The batch being recorded may hold most of the ring, it has to go out before it can be waited on.
+        if (m_inFlight.empty()) {
+            Flush();
+        }
+        Wait(m_inFlight.front().value);
+        _RetireBatches(m_inFlight.front().value);
+    }
+}
+
+void CUploadManager::_BeginRecording() {
+    if (m_isRecording) {
+        return;
+    }
+    m_isRecording = true;
+
+    vk::CommandBufferAllocateInfo allocInfo {};
+    allocInfo.level = vk::CommandBufferLevel::ePrimary;
+    allocInfo.commandBufferCount = 1;
+
+    vk::CommandBufferBeginInfo beginInfo {};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+
+    allocInfo.commandPool = m_transferPool;
+    m_recording.transferCommands = m_device.allocateCommandBuffers(allocInfo)[0];
+    m_recording.transferCommands.begin(beginInfo);
+
+    if (HasDedicatedTransferQueue()) {
+        allocInfo.commandPool = m_acquirePool;
+        m_recording.acquireCommands = m_device.allocateCommandBuffers(allocInfo)[0];
+        m_recording.acquireCommands.begin(beginInfo);
+    }
+}
+
+void CUploadManager::_RecordBufferCopy(
+    const vk::Buffer source,
+    const vk::DeviceSize sourceOffset,
+    const vk::Buffer destination,
+    const vk::DeviceSize offset,
+    const vk::DeviceSize size
+) {
+    _BeginRecording();
+
+    vk::BufferCopy copyRegion {};
+    copyRegion.srcOffset = sourceOffset;
+    copyRegion.dstOffset = offset;
+    copyRegion.size = size;
+    m_recording.transferCommands.copyBuffer(source, destination, copyRegion);
+
+    vk::BufferMemoryBarrier barrier {};
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite;
+    barrier.srcQueueFamilyIndex = vk::QueueFamilyIgnored;
+    barrier.dstQueueFamilyIndex = vk::QueueFamilyIgnored;
+    barrier.buffer = destination;
+    barrier.offset = offset;
+    barrier.size = size;
+
+    if (!HasDedicatedTransferQueue()) {
+        m_recording.transferCommands.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eAllCommands,
+            {}, nullptr, barrier, nullptr
+        );
+        return;
+    }
+
+    barrier.srcQueueFamilyIndex = m_transferFamily;
+    barrier.dstQueueFamilyIndex = m_graphicsFamily;
+    barrier.dstAccessMask = {};
+    m_recording.transferCommands.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eBottomOfPipe,
+        {}, nullptr, barrier, nullptr
+    );
+
+    barrier.srcAccessMask = {};
+    barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite;
+    m_recording.acquireCommands.pipelineBarrier(
+        vk::PipelineStageFlagBits::eAllCommands,
+        vk::PipelineStageFlagBits::eAllCommands,
+        {}, nullptr, barrier, nullptr
+    );
+}
+
+void CUploadManager::_RetireBatches(const uint64_t completedValue) {
+    while (!m_inFlight.empty() && m_inFlight.front().value <= completedValue) {
+        CBatch& batch = m_inFlight.front();
+
+        m_ringUsed -= batch.ringBytes;
+        for (const CStagingBuffer& staging : batch.stagingBuffers) {
+            m_allocator.destroyBuffer(staging.buffer, staging.allocation);
+        }
+        for (const std::function<void()>& release : batch.releases) {
+            release();
+        }
+
+        m_device.freeCommandBuffers(m_transferPool, batch.transferCommands);
+        if (batch.acquireCommands) {
+            m_device.freeCommandBuffers(m_acquirePool, batch.acquireCommands);
+        }
+        m_inFlight.pop_front();
+    }
+}
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "vulkan.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace Vulkan
+{
+constexpr vk::DeviceSize DEFAULT_UPLOAD_RING_SIZE = 64ull * 1024 * 1024;
+
+// Batches copies into device local resources. Data is staged in a persistently mapped ring, everything recorded
+// between two flushes goes to the GPU as one submission, and completion is tracked with a timeline semaphore
+// instead of idle waits. Copies run on a dedicated transfer queue when the device has one, ownership of the
+// destinations is then handed to the graphics queue. Main thread only.
+class CUploadManager
+{
+public:
+    CUploadManager() = default;
+    CUploadManager(const CUploadManager&) = delete;
+    CUploadManager(CUploadManager&&) = delete;
+    CUploadManager& operator=(const CUploadManager&) = delete;
+    CUploadManager& operator=(CUploadManager&&) = delete;
+    ~CUploadManager() = default;
+
+    // Without a transfer queue family of its own copies are recorded on `graphicsQueue`
+    void Create(
+        vk::Device device,
+        vma::Allocator allocator,
+        uint32_t graphicsFamily,
+        vk::Queue graphicsQueue,
+        std::optional<uint32_t> transferFamily,
+        vk::Queue transferQueue,
+        vk::DeviceSize ringSize = DEFAULT_UPLOAD_RING_SIZE
+    );
+    // Waits for all uploads and runs the pending releases
+    void Destroy();
+
+    // Copies `data` into the ring right away, the caller may free it on return. Data bigger than the ring gets
+    // a staging buffer of its own.
+    void UploadBuffer(vk::Buffer destination, vk::DeviceSize offset, std::span<const std::byte> data);
+    // `source` is caller owned staging, see ReleaseAfterUpload. Every subresource in `range` goes from undefined
+    // to shader read only, whatever it held before is discarded.
+    void CopyBufferToImage(
+        vk::Buffer source,
+        vk::Image image,
+        const vk::ImageSubresourceRange& range,
+        std::span<const vk::BufferImageCopy> regions
+    );
+    // Runs `release` once everything recorded so far has reached the GPU, e.g. to free a staging buffer
+    void ReleaseAfterUpload(std::function<void()> release);
+
+    // Submits everything recorded since the last flush. Returns the value the semaphore reaches once those uploads
+    // are visible to the graphics queue, submissions to it made after Flush() are ordered after them.
+    uint64_t Flush();
+    // Retires finished batches: frees their ring space and runs their releases. Call once per frame.
+    void Update();
+    // Blocks until the semaphore reaches `value`
+    void Wait(uint64_t value) const;
+
+    [[nodiscard]] vk::Semaphore GetSemaphore() const { return m_semaphore; }
+    [[nodiscard]] uint64_t GetCompletedValue() const { return m_device.getSemaphoreCounterValue(m_semaphore); }
+    // Value of the last flush, everything submitted so far is done once the semaphore reaches it
+    [[nodiscard]] uint64_t GetSubmittedValue() const { return m_submittedValue; }
+    [[nodiscard]] bool HasDedicatedTransferQueue() const { return m_transferFamily != m_graphicsFamily; }
+
+private:
+    struct CStagingBuffer
+    {
+        vk::Buffer buffer {};
+        vma::Allocation allocation {};
+    };
+
+    // Submitted work and what it keeps alive until the semaphore reaches `value`
+    struct CBatch
+    {
+        uint64_t value = 0;
+        vk::DeviceSize ringBytes = 0;
+        vk::CommandBuffer transferCommands {};
+        vk::CommandBuffer acquireCommands {};
+        std::vector<CStagingBuffer> stagingBuffers {};
+        std::vector<std::function<void()>> releases {};
+    };
+
+    CStagingBuffer _CreateStagingBuffer(vk::DeviceSize size, vma::AllocationCreateFlags flags) const;
+    // Offset of `size` free bytes in the ring, waits for older batches if it is full. Nothing if it never fits.
+    std::optional<vk::DeviceSize> _AllocateRing(vk::DeviceSize size);
+    // Command buffers of the batch being recorded, begun on first use
+    void _BeginRecording();
+    void _RecordBufferCopy(
+        vk::Buffer source,
+        vk::DeviceSize sourceOffset,
+        vk::Buffer destination,
+        vk::DeviceSize offset,
+        vk::DeviceSize size
+    );
+    void _RetireBatches(uint64_t completedValue);
+
+    vk::Device m_device {};
+    vma::Allocator m_allocator {};
+
+    uint32_t m_graphicsFamily = 0;
+    vk::Queue m_graphicsQueue {};
+    uint32_t m_transferFamily = 0;
+    vk::Queue m_transferQueue {};
+    vk::CommandPool m_transferPool {};
+    // Only with a dedicated transfer family, for the barriers that acquire ownership on the graphics queue
+    vk::CommandPool m_acquirePool {};
+
+    vk::Semaphore m_semaphore {};
+    uint64_t m_nextValue = 0;
+    uint64_t m_submittedValue = 0;
+
+    CStagingBuffer m_ring {};
+    std::byte* m_ringData = nullptr;
+    vk::DeviceSize m_ringSize = 0;
+    vk::DeviceSize m_ringHead = 0;
+    vk::DeviceSize m_ringUsed = 0;
+
+    CBatch m_recording {};
+    bool m_isRecording = false;
+    std::deque<CBatch> m_inFlight {};
+};
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "vulkan.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace Vulkan
+{
+// Storage types for packed vertex attributes. Shaders read them as floats, the fixed function
+// vertex fetch does the conversion.
+struct CHalf4
+{
+    uint16_t x, y, z, w;
+};
+
+struct CSnorm16x4
+{
+    int16_t x, y, z, w;
+};
+
+struct CUnorm16x2
+{
+    uint16_t x, y;
+};
+
+template <typename T>
+struct CVertexFormat;
+
+template <>
+struct CVertexFormat<glm::vec2>
+{
+    static constexpr vk::Format format = vk::Format::eR32G32Sfloat;
+};
+
+template <>
+struct CVertexFormat<glm::vec3>
+{
+    static constexpr vk::Format format = vk::Format::eR32G32B32Sfloat;
+};
+
+template <>
+struct CVertexFormat<glm::vec4>
+{
+    static constexpr vk::Format format = vk::Format::eR32G32B32A32Sfloat;
+};
+
+template <>
+struct CVertexFormat<CHalf4>
+{
+    static constexpr vk::Format format = vk::Format::eR16G16B16A16Sfloat;
+};
+
+template <>
+struct CVertexFormat<CSnorm16x4>
+{
+    static constexpr vk::Format format = vk::Format::eR16G16B16A16Snorm;
+};
+
+template <>
+struct CVertexFormat<CUnorm16x2>
+{
+    static constexpr vk::Format format = vk::Format::eR16G16Unorm;
+};
+
+template <typename Type, uint32_t Offset, uint32_t Location>
+struct CVertexAttribute
+{
+    static constexpr uint32_t offset = Offset;
+    static constexpr uint32_t location = Location;
+    static constexpr uint32_t size = sizeof(Type);
+    static constexpr vk::Format format = CVertexFormat<Type>::format;
+};
+
+// Declares attribute `member` of `vertex` bound to shader input `location`
+#define VERTEX_ATTRIBUTE(vertex, member, location) \
+    ::Vulkan::CVertexAttribute<decltype(vertex::member), offsetof(vertex, member), location>
+
+// Vertex input state of a single interleaved binding, generated from the attribute list:
+//     using CMyVertexLayout = Vulkan::CVertexLayout<
+//         CMyVertex,
+//         VERTEX_ATTRIBUTE(CMyVertex, position, 0),
+//         VERTEX_ATTRIBUTE(CMyVertex, texCoord, 1)>;
+template <typename Vertex, typename... Attributes>
+class CVertexLayout
+{
+    static constexpr bool HasUniqueLocations() {
+        constexpr std::array<uint32_t, sizeof...(Attributes)> locations = { Attributes::location... };
+        for (std::size_t i = 0; i < locations.size(); ++i) {
+            for (std::size_t j = i + 1; j < locations.size(); ++j) {
+                if (locations[i] == locations[j]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static_assert(sizeof...(Attributes) > 0, "Vertex layout has no attributes");
+    static_assert(HasUniqueLocations(), "Vertex attributes share a location");
+    static_assert(((Attributes::offset + Attributes::size <= sizeof(Vertex)) && ...), "Attribute is outside of the vertex");
+
+public:
+    static constexpr uint32_t stride = sizeof(Vertex);
+
+    static constexpr std::array<vk::VertexInputAttributeDescription, sizeof...(Attributes)> attributes = {
+        vk::VertexInputAttributeDescription { Attributes::location, 0, Attributes::format, Attributes::offset }...
+    };
+
+    static constexpr vk::VertexInputBindingDescription GetBindingDescription() {
+        return { 0, stride, vk::VertexInputRate::eVertex };
+    }
+
+    static constexpr std::span<const vk::VertexInputAttributeDescription> GetAttributeDescriptions() {
+        return attributes;
+    }
+};
+}
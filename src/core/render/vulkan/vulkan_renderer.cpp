@@ -1,48 +1,113 @@
 #include "vulkan_renderer.hpp"
 
-bool CVulkanRenderer::Initialize(IWindow* window) {
-    if (window == nullptr) {
-        throw std::runtime_error("Cannot initialize vulkan renderer. Window is null!\n");
-    }
-    m_window = dynamic_cast<IVulkanWindow*>(window);
-
-    m_instance.Create(m_window);
-    return true;
-}
-
-
-#if 0
 #include "console.hpp"
-#include "vulkan_renderer.hpp"
-#include "../SDL/SDL.hpp"
-#include "../SDL/SDL_vulkan.hpp"
-#include "unicode.hpp"
 #include "resourceloader.hpp"
+#include "asyncloader.hpp"
+#include "commandline.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <tiny_obj_loader.h>
 
 #define VMA_STATIC_VULKAN_FUNCTIONS 0
 #define VMA_DYNAMIC_VULKAN_FUNCTIONS 1
 #include <vk_mem_alloc.hpp>
 
-#include <stb/stb_image.h>
-#include "../camera.hpp"
+#include "../../camera.hpp"
+#include "../../mesh/mesh_lod.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <filesystem>
 #include <chrono>
 #include <cassert>
+#include <charconv>
+#include <cstring>
 #include <set>
 #include <random>
+#include <string_view>
 
-constexpr std::size_t MAX_FRAMES_IN_FLIGHT = 2;
+// Upper bound of -frames_in_flight, the per-frame resources are sized by the present policy
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
 
 const std::string MODEL_PATH = "viking_room.obj";
+const std::string COOKED_MODEL_PATH = "viking_room.mesh";
 const std::string TEXTURE_PATH = "viking_room.png";
+const std::string COOKED_TEXTURE_PATH = "viking_room.tex";
+// Next to the derived data cache, relative to the working directory
+const std::string PIPELINE_CACHE_PATH = "pipeline.cache";
+
+// Indexed by EPresentPolicy, -present_policy takes them with underscores instead of spaces
+constexpr std::array<std::string_view, 3> PRESENT_POLICY_NAMES = {
+    "low latency",
+    "throughput",
+    "power saving",
+};
+
+// Indexed by EShaderPipeline
+constexpr std::array<std::string_view, SHADER_PIPELINE_COUNT> SHADER_PIPELINE_NAMES = {
+    "graphics",
+    "particle",
+    "meshlet culling",
+};
+
+// Device memory for streamed and tail mips together, overridden with -texture_budget <MiB>
+constexpr uint64_t DEFAULT_TEXTURE_BUDGET_MB = 256;
+// Each streamed mip is bound with a queue wait, so only a few start per frame
+constexpr uint32_t MAX_TEXTURE_LOADS_PER_FRAME = 2;
+
+static vk::Format GetTextureFormat(const Texture::ETextureFormat format) {
+    switch (format) {
+        case Texture::ETextureFormat::Rgba8Unorm:
+            return vk::Format::eR8G8B8A8Unorm;
+        case Texture::ETextureFormat::Rgba8Srgb:
+            return vk::Format::eR8G8B8A8Srgb;
+        case Texture::ETextureFormat::Bc1RgbUnorm:
+            return vk::Format::eBc1RgbUnormBlock;
+        case Texture::ETextureFormat::Bc1RgbSrgb:
+            return vk::Format::eBc1RgbSrgbBlock;
+        case Texture::ETextureFormat::Bc3Unorm:
+            return vk::Format::eBc3UnormBlock;
+        case Texture::ETextureFormat::Bc3Srgb:
+            return vk::Format::eBc3SrgbBlock;
+        case Texture::ETextureFormat::Bc5Unorm:
+            return vk::Format::eBc5UnormBlock;
+        case Texture::ETextureFormat::Bc7Unorm:
+            return vk::Format::eBc7UnormBlock;
+        case Texture::ETextureFormat::Bc7Srgb:
+            return vk::Format::eBc7SrgbBlock;
+    }
+    throw std::runtime_error("Unknown texture format!");
+}
+
+// Whole sparse blocks covering one mip, its last row and column of blocks may stick out of the level
+static vk::DeviceSize GetSparseLevelSize(
+    const vk::Extent3D& extent,
+    const vk::Extent3D& blockExtent,
+    const vk::DeviceSize blockSize
+) {
+    const uint64_t blocksX = (extent.width + blockExtent.width - 1) / blockExtent.width;
+    const uint64_t blocksY = (extent.height + blockExtent.height - 1) / blockExtent.height;
+    return blocksX * blocksY * blockSize;
+}
+
+static vk::ImageSubresourceRange GetTextureRange(const uint32_t baseLevel, const uint32_t levelCount) {
+    vk::ImageSubresourceRange range {};
+    range.aspectMask = vk::ImageAspectFlagBits::eColor;
+    range.baseMipLevel = baseLevel;
+    range.levelCount = levelCount;
+    range.baseArrayLayer = 0;
+    range.layerCount = 1;
+    return range;
+}
+
+static void BindSparseAndWait(vk::Device device, vk::Queue queue, const vk::BindSparseInfo& bindInfo) {
+    vk::Fence fence = device.createFence(vk::FenceCreateInfo {});
+    queue.bindSparse(bindInfo, fence);
+    std::ignore = device.waitForFences(fence, vk::True, UINT64_MAX);
+    device.destroyFence(fence);
+}
 
 //============
 // CVulkanRenderer
@@ -54,13 +119,13 @@ bool CVulkanRenderer::Initialize(IWindow* window) {
     m_window = dynamic_cast<IVulkanWindow*>(window);
 
     try {
-        VULKAN_HPP_DEFAULT_DISPATCHER.init();
+        // Disk reads run while the instance and device are created, each result is waited for right before use
+        _StartLoads();
 
-        _InitializeInstanceExtensions();
-        _InitializeInstance();
+        m_instance.Create(m_window);
 
         _SetRequiredDeviceExtensions();
-        m_window->CreateSurface(m_instance);
+        m_window->CreateSurface(m_instance.GetHandle());
         _PickPhysicalDevice();
         m_queueFamiliesIndices = _FindQueueFamilies(m_physicalDevice);
 
@@ -68,10 +133,28 @@ bool CVulkanRenderer::Initialize(IWindow* window) {
         _initializeDevice();
 
         _CreateAllocator();
+        _StartTextureLoads(ELoadPriority::Startup);
 
         m_graphicsQueue = m_device.getQueue(*m_queueFamiliesIndices.m_graphicsAndCompute, 0);
         m_presentQueue = m_device.getQueue(*m_queueFamiliesIndices.m_present, 0);
-        m_computeQueue = m_device.getQueue(*m_queueFamiliesIndices.m_graphicsAndCompute, 0);
+        m_computeQueue = m_device.getQueue(
+            m_queueFamiliesIndices.m_compute.value_or(*m_queueFamiliesIndices.m_graphicsAndCompute),
+            0
+        );
+        if (m_queueFamiliesIndices.m_compute.has_value()) {
+            Msg("Particles are simulated on the async compute queue family {}", *m_queueFamiliesIndices.m_compute);
+        }
+        if (m_queueFamiliesIndices.m_transfer.has_value()) {
+            m_transferQueue = m_device.getQueue(*m_queueFamiliesIndices.m_transfer, 0);
+        }
+        m_uploads.Create(
+            m_device,
+            m_allocator,
+            *m_queueFamiliesIndices.m_graphicsAndCompute,
+            m_graphicsQueue,
+            m_queueFamiliesIndices.m_transfer,
+            m_transferQueue
+        );
 
         m_surfaceCapabilities = m_physicalDevice.getSurfaceCapabilitiesKHR(m_window->GetSurface());
         m_currentSwapchainExtent = _ChooseSwapChainExtent();
@@ -79,6 +162,24 @@ bool CVulkanRenderer::Initialize(IWindow* window) {
         std::vector<vk::SurfaceFormatKHR> surfaceFormats = m_physicalDevice.getSurfaceFormatsKHR(m_window->GetSurface());
         m_currentSurfaceFormat = _ChooseSurfaceFormat(surfaceFormats);
 
+        if (const int policyParam = CommandLine()->FindParam("-present_policy")) {
+            std::string policy(CommandLine()->GetParam(policyParam + 1));
+            std::ranges::replace(policy, '_', ' ');
+            const auto name = std::ranges::find(PRESENT_POLICY_NAMES, policy);
+            if (name != PRESENT_POLICY_NAMES.end()) {
+                m_presentPolicy = static_cast<EPresentPolicy>(name - PRESENT_POLICY_NAMES.begin());
+            } else {
+                Warning("Unknown present policy \"{}\", using {}", policy, PRESENT_POLICY_NAMES[static_cast<size_t>(m_presentPolicy)]);
+            }
+        }
+        if (const int framesParam = CommandLine()->FindParam("-frames_in_flight")) {
+            const std::string_view frames = CommandLine()->GetParam(framesParam + 1);
+            std::from_chars(frames.data(), frames.data() + frames.size(), m_throughputFramesInFlight);
+            m_throughputFramesInFlight = std::clamp(m_throughputFramesInFlight, 2u, MAX_FRAMES_IN_FLIGHT);
+        }
+        m_requestedPresentPolicy = m_presentPolicy;
+        m_framesInFlight = _GetFramesInFlight(m_presentPolicy);
+
         std::vector<vk::PresentModeKHR> presentModes = m_physicalDevice.getSurfacePresentModesKHR(m_window->GetSurface());
         m_currentPresentMode = _ChoosePresentMode(presentModes);
 
@@ -88,10 +189,22 @@ bool CVulkanRenderer::Initialize(IWindow* window) {
 
         _CreateRenderPass();
 
-        _CreateDescriptorSetLayout();
+        // Vertex input state of the pipeline depends on the cooked vertex format
+        LoadModel();
+        m_meshletCulling = m_meshletCulling && !m_model.GetMeshlets().empty();
+        if (!m_meshletCulling) {
+            m_cullShaderLoad.Cancel();
+        }
+
+        const auto pipelinesStart = std::chrono::steady_clock::now();
         _CreatePipeline();
-        _CreateComputeDescriptorSetLayout();
         _CreateComputePipeline();
+        if (m_meshletCulling) {
+            _CreateMeshletCullPipeline();
+        }
+        m_pipelineCache.ReportStartup(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - pipelinesStart)
+        );
 
         _CreateColorResources();
         _CreateDepthResources();
@@ -99,26 +212,24 @@ bool CVulkanRenderer::Initialize(IWindow* window) {
         _CreateFramebuffers();
 
         _CreateCommandPool();
-        _CreateCommandBuffers();
-
-        LoadModel();
 
         _CreateVertexBuffer();
         _CreateIndexBuffer();
-
-        _CreateShaderStorageBuffers();
-        _CreateUniformBuffers();
+        if (m_meshletCulling) {
+            _CreateMeshletBuffers();
+        }
 
         _CreateTextureImage();
-        _CreateTextureImageView(m_currentSurfaceFormat.format);
+        _CreateTextureImageView(m_textureFormat);
         _CreateTextureSampler();
 
-        _CreateDescriptorPool();
-        //_CreateDescriptorSets();
-        _CreateComputeDescriptorSets();
-        _CreateComputeCommandBuffers();
+        _CreateFrameResources();
+        _CreateFrameTimelines();
 
-        _CreateSyncObjects();
+        // Startup uploads were only recorded so far, they reach the GPU as a single submission
+        m_uploads.Flush();
+
+        _WatchAssets();
     } catch (const std::exception& e) {
         Error << e.what() << '\n';
         return false;
@@ -128,173 +239,62 @@ bool CVulkanRenderer::Initialize(IWindow* window) {
 }
 
 CVulkanRenderer::~CVulkanRenderer() {
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        m_device.destroySemaphore(m_imageAvailableSemaphores[i]);
-        m_device.destroySemaphore(m_renderFinishedSemaphores[i]);
-        m_device.destroyFence(m_inFlightFences[i]);
+    m_assetWatcher.Stop();
+    m_shaderWatcher.Stop();
+    // Rebuilds that already started still use the device
+    for (CLoadHandle<vk::Pipeline>& rebuild : m_pipelineRebuilds) {
+        if (!rebuild.IsValid() || rebuild.Cancel()) {
+            continue;
+        }
+        try {
+            m_device.destroyPipeline(rebuild.Get());
+        } catch (const std::exception&) {
+        }
     }
+    m_device.waitIdle();
+    _FlushDeferredDestruction(true);
+    m_uploads.Destroy();
 
-    m_device.destroyDescriptorPool(m_descriptorPool);
-    m_device.destroyDescriptorSetLayout(m_descriptorSetLayout);
+    _DestroyFrameResources();
+    m_device.destroySemaphore(m_graphicsTimeline);
+    m_device.destroySemaphore(m_computeTimeline);
 
     m_device.destroySampler(m_textureSampler);
     m_device.destroyImageView(m_textureImageView);
-    m_allocator.destroyImage(m_textureImage.image, m_textureImage.allocation);
+    if (m_textureStreaming) {
+        _DestroyStreamedTexture();
+    } else {
+        m_allocator.destroyImage(m_textureImage.image, m_textureImage.allocation);
+    }
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        m_allocator.unmapMemory(m_uniformBuffers[i].allocation);
-        m_allocator.destroyBuffer(m_uniformBuffers[i].buffer, m_uniformBuffers[i].allocation);
+    if (m_meshletCulling) {
+        m_allocator.destroyBuffer(m_meshletBuffer.buffer, m_meshletBuffer.allocation);
+
+        m_device.destroyPipeline(m_meshletCullPipeline);
     }
 
     m_allocator.destroyBuffer(m_indexBuffer.buffer, m_indexBuffer.allocation);
     m_allocator.destroyBuffer(m_vertexBuffer.buffer, m_vertexBuffer.allocation);
 
+    m_device.destroyCommandPool(m_computeCommandPool);
     m_device.destroyCommandPool(m_commandPool);
 
     _CleanupSwapchain();
 
     m_device.destroyPipeline(m_pipeline);
-    m_device.destroyPipelineLayout(m_pipelineLayout);
+    m_device.destroyPipeline(m_computePipeline);
+    m_layoutCache.Destroy();
+
+    // Rebuilt pipelines have been merged in by now
+    m_pipelineCache.Save();
+    m_pipelineCache.Destroy();
 
     m_device.destroyRenderPass(m_renderPass);
 
     m_allocator.destroy();
     m_device.destroy();
 
-    m_window->DestroySurface(m_instance);
-
-    if (m_enableValidationLayer) {
-        m_instance.destroyDebugUtilsMessengerEXT(m_debugMessenger);
-    }
-
-    m_instance.destroy();
-}
-
-//==========
-// Instance
-//==========
-
-VKAPI_ATTR vk::Bool32 VKAPI_CALL CVulkanRenderer::DebugCallback(
-    vk::DebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-    vk::DebugUtilsMessageTypeFlagBitsEXT /*messageType*/,
-    const vk::DebugUtilsMessengerCallbackDataEXT* pCallbackData,
-    void* /*pUserData*/
-) {
-    if (messageSeverity >= vk::DebugUtilsMessageSeverityFlagBitsEXT::eError) {
-        Error << std::format("\n\nERROR: {}\n\n", pCallbackData->pMessage) << std::endl;
-    } else if (messageSeverity >= vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning) {
-        Warning << std::format("\nWarning: {}\n", pCallbackData->pMessage) << std::endl;
-    } else {
-        Msg << std::format("Info: {}", pCallbackData->pMessage) << std::endl;
-    }
-    return VK_FALSE;
-}
-
-void CVulkanRenderer::_InitializeInstanceExtensions() {
-    // Setup all instance extensions
-    for (const auto& ext : m_window->GetRequiredInstanceExtensions()) {
-        m_instanceExtensions[ext] = true;
-    }
-    if (m_enableValidationLayer) {
-        m_instanceExtensions[VK_EXT_DEBUG_UTILS_EXTENSION_NAME] = false;
-    }
-
-    // Find extensions that device supports
-    std::vector<vk::ExtensionProperties> availableExtensions = vk::enumerateInstanceExtensionProperties();
-    for (const auto& ext : m_instanceExtensions) {
-        if (std::find_if(
-            availableExtensions.begin(),
-            availableExtensions.end(),
-            [&](vk::ExtensionProperties availableExt){ return ext.first == availableExt.extensionName; }
-        ) != availableExtensions.end()) {
-            m_enabledInstanceExtensions.insert(ext.first.data());
-        }
-    }
-
-    // Check for required extensions
-    bool reqExtNotFound = false;
-    for (const auto& ext : m_instanceExtensions) {
-        if (!m_enabledInstanceExtensions.contains(ext.first)) {
-            if (ext.second) {   // if required
-                std::cerr << std::format("Required extension not found: {}\n", ext.first);
-                reqExtNotFound = true;
-            } else {
-                std::cerr << std::format("Optional extension not found: {}\n", ext.first);
-            }
-        }
-    }
-
-    if (reqExtNotFound) {
-        throw std::runtime_error("Cannot find required instance extensions!");
-    }
-}
-
-static bool _IsValidationLayerFound() {
-    std::vector<vk::LayerProperties> availableLayers = vk::enumerateInstanceLayerProperties();
-
-    for (const auto& layer : availableLayers) {
-        if (strcmp("VK_LAYER_KHRONOS_validation", layer.layerName) == 0) {
-            return true;
-        }
-    }
-
-    return false;
-}
-
-void CVulkanRenderer::_InitializeInstance() {
-    std::vector<const char*> enabledExtensions {};
-    for (const auto& ext : m_enabledInstanceExtensions) {
-        enabledExtensions.push_back(ext.c_str());
-    }
-
-    if (m_enableValidationLayer &&
-        (!_IsValidationLayerFound() || !m_enabledInstanceExtensions.contains(VK_EXT_DEBUG_UTILS_EXTENSION_NAME))
-    ) {
-        std::cerr << "Validation layer disabled.\n";
-        m_enableValidationLayer = false;
-    }
-
-    std::vector<const char*> enabledLayers {};
-    if (m_enableValidationLayer) {
-        enabledLayers.push_back("VK_LAYER_KHRONOS_validation");
-    }
-
-    vk::InstanceCreateInfo instanceInfo {};
-
-    vk::ApplicationInfo appInfo {};
-    appInfo.pApplicationName = "Hotline Miami";
-    appInfo.applicationVersion = vk::makeApiVersion(0, 0, 0, 0);
-    appInfo.pEngineName = "Skylabs";
-    appInfo.engineVersion = vk::makeApiVersion(0, 0, 0, 0);
-    appInfo.apiVersion = vk::ApiVersion13;
-
-    instanceInfo.pApplicationInfo = &appInfo;
-    instanceInfo.enabledLayerCount = static_cast<uint32_t>(enabledLayers.size());
-    instanceInfo.ppEnabledLayerNames = enabledLayers.data();
-    instanceInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
-    instanceInfo.ppEnabledExtensionNames = enabledExtensions.data();
-
-    vk::DebugUtilsMessengerCreateInfoEXT debugMessengerCreateInfo {};
-    if (m_enableValidationLayer) {
-        debugMessengerCreateInfo.messageSeverity =
-            vk::DebugUtilsMessageSeverityFlagBitsEXT::eInfo |
-            vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning |
-            vk::DebugUtilsMessageSeverityFlagBitsEXT::eError;
-
-        debugMessengerCreateInfo.messageType =
-            vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral |
-            vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation;
-
-        debugMessengerCreateInfo.pfnUserCallback =
-            reinterpret_cast<PFN_vkDebugUtilsMessengerCallbackEXT>(DebugCallback);
-
-        instanceInfo.pNext = &debugMessengerCreateInfo;
-    }
-
-    m_instance = vk::createInstance(instanceInfo);
-    VULKAN_HPP_DEFAULT_DISPATCHER.init(m_instance);
-
-    m_debugMessenger = m_instance.createDebugUtilsMessengerEXT(debugMessengerCreateInfo);
+    m_window->DestroySurface(m_instance.GetHandle());
 }
 
 //==========
@@ -362,6 +362,24 @@ CVulkanRenderer::CQueueFamilyIndices CVulkanRenderer::_FindQueueFamilies(vk::Phy
         i++;
     }
 
+    for (uint32_t family = 0; family < queueFamilies.size(); family++) {
+        const vk::QueueFlags flags = queueFamilies[family].queueFlags;
+        if ((flags & vk::QueueFlagBits::eTransfer) &&
+            !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))
+        ) {
+            indices.m_transfer = family;
+            break;
+        }
+    }
+
+    for (uint32_t family = 0; family < queueFamilies.size(); family++) {
+        const vk::QueueFlags flags = queueFamilies[family].queueFlags;
+        if ((flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics)) {
+            indices.m_compute = family;
+            break;
+        }
+    }
+
     return indices;
 }
 
@@ -430,7 +448,7 @@ static vk::SampleCountFlagBits _GetMaxUsableSampleCount(vk::PhysicalDevice physi
 }
 
 void CVulkanRenderer::_PickPhysicalDevice() {
-    std::vector<vk::PhysicalDevice> physicalDevices = m_instance.enumeratePhysicalDevices();
+    std::vector<vk::PhysicalDevice> physicalDevices = m_instance.GetHandle().enumeratePhysicalDevices();
 
     std::cout << "Devices:\n";
 
@@ -484,6 +502,13 @@ void CVulkanRenderer::_initializeDevice() {
     };
 
     float queuePriority = 1.0f;
+    if (m_queueFamiliesIndices.m_transfer.has_value()) {
+        uniqueQueueFamilies.insert(*m_queueFamiliesIndices.m_transfer);
+    }
+    if (m_queueFamiliesIndices.m_compute.has_value()) {
+        uniqueQueueFamilies.insert(*m_queueFamiliesIndices.m_compute);
+    }
+
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         vk::DeviceQueueCreateInfo queueCreateInfo {};
         queueCreateInfo.queueFamilyIndex = queueFamily;
@@ -498,10 +523,38 @@ void CVulkanRenderer::_initializeDevice() {
         enabledExtensions.push_back(extension_name.c_str());
     }
 
+    vk::PhysicalDeviceVulkan12Features supportedFeatures12 {};
+    vk::PhysicalDeviceFeatures2 supportedFeatures {};
+    supportedFeatures.pNext = &supportedFeatures12;
+    m_physicalDevice.getFeatures2(&supportedFeatures);
+
+    // GPU meshlet culling needs the draw count read from a buffer, otherwise every submesh is drawn
+    m_meshletCulling = supportedFeatures12.drawIndirectCount && supportedFeatures.features.multiDrawIndirect;
+
+    // Universal on desktop GPUs, textures cooked as BCn can't be sampled without it
+    m_textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+
+    // Streamed mips are bound on the graphics queue, so its family has to do sparse binding too
+    const vk::QueueFlags graphicsQueueFlags =
+        m_physicalDevice.getQueueFamilyProperties()[*m_queueFamiliesIndices.m_graphicsAndCompute].queueFlags;
+    m_textureStreaming = supportedFeatures.features.sparseBinding &&
+        supportedFeatures.features.sparseResidencyImage2D &&
+        (graphicsQueueFlags & vk::QueueFlagBits::eSparseBinding);
+
     vk::PhysicalDeviceFeatures requestedDeviceFeatures {};
     requestedDeviceFeatures.samplerAnisotropy = true;
+    requestedDeviceFeatures.multiDrawIndirect = m_meshletCulling;
+    requestedDeviceFeatures.textureCompressionBC = m_textureCompressionBC;
+    requestedDeviceFeatures.sparseBinding = m_textureStreaming;
+    requestedDeviceFeatures.sparseResidencyImage2D = m_textureStreaming;
+
+    vk::PhysicalDeviceVulkan12Features requestedFeatures12 {};
+    requestedFeatures12.drawIndirectCount = m_meshletCulling;
+    // Core since 1.2, uploads complete on it
+    requestedFeatures12.timelineSemaphore = true;
 
     vk::DeviceCreateInfo deviceInfo {};
+    deviceInfo.pNext = &requestedFeatures12;
     deviceInfo.pQueueCreateInfos = queueCreateInfos.data();
     deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     deviceInfo.pEnabledFeatures = &requestedDeviceFeatures;
@@ -509,6 +562,9 @@ void CVulkanRenderer::_initializeDevice() {
     deviceInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     m_device = m_physicalDevice.createDevice(deviceInfo);
+
+    m_pipelineCache.Create(m_device, m_physicalDevice.getProperties(), PIPELINE_CACHE_PATH);
+    m_layoutCache.Create(m_device);
 }
 
 //==========
@@ -521,7 +577,7 @@ void CVulkanRenderer::_CreateAllocator() {
     allocatorInfo.vulkanApiVersion = vk::ApiVersion13;
     allocatorInfo.physicalDevice = m_physicalDevice;
     allocatorInfo.device = m_device;
-    allocatorInfo.instance = m_instance;
+    allocatorInfo.instance = m_instance.GetHandle();
 
     vma::VulkanFunctions vulkanFunctions = vma::functionsFromDispatcher();
     allocatorInfo.pVulkanFunctions = &vulkanFunctions;
@@ -547,14 +603,69 @@ vk::SurfaceFormatKHR CVulkanRenderer::_ChooseSurfaceFormat(const std::vector<vk:
 }
 
 vk::PresentModeKHR CVulkanRenderer::_ChoosePresentMode(const std::vector<vk::PresentModeKHR>& presentModes) {
-    for (const auto& availablePresentMode : presentModes) { // VSYNC
-        if (availablePresentMode == vk::PresentModeKHR::eImmediate) {
-            return availablePresentMode;
+    // Mailbox replaces queued images with newer ones and never tears, immediate doesn't wait for vertical blank
+    // at all. FIFO is vsync and lets the GPU idle once the queue is full.
+    std::span<const vk::PresentModeKHR> preferred {};
+    switch (m_presentPolicy) {
+        case EPresentPolicy::LowLatency: {
+            static constexpr std::array modes = { vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate };
+            preferred = modes;
+            break;
+        }
+        case EPresentPolicy::Throughput: {
+            static constexpr std::array modes = { vk::PresentModeKHR::eMailbox };
+            preferred = modes;
+            break;
         }
+        case EPresentPolicy::PowerSaving:
+            break;
+    }
+
+    for (const vk::PresentModeKHR mode : preferred) {
+        if (std::ranges::find(presentModes, mode) != presentModes.end()) {
+            return mode;
+        }
+    }
+    return vk::PresentModeKHR::eFifo;
+}
+
+uint32_t CVulkanRenderer::_GetFramesInFlight(const EPresentPolicy policy) const {
+    switch (policy) {
+        case EPresentPolicy::LowLatency:
+            return 1;
+        case EPresentPolicy::Throughput:
+            return m_throughputFramesInFlight;
+        case EPresentPolicy::PowerSaving:
+            return 2;
+    }
+    return 2;
+}
+
+void CVulkanRenderer::SetPresentPolicy(const EPresentPolicy policy) {
+    m_requestedPresentPolicy = policy;
+}
+
+void CVulkanRenderer::_ApplyPresentPolicy() {
+    m_presentPolicy = m_requestedPresentPolicy;
+
+    // Per-frame resources are only rebuilt once nothing uses them, copies into them included
+    m_uploads.Wait(m_uploads.Flush());
+    m_device.waitIdle();
+
+    const uint32_t framesInFlight = _GetFramesInFlight(m_presentPolicy);
+    if (framesInFlight != m_framesInFlight) {
+        _DestroyFrameResources();
+        m_framesInFlight = framesInFlight;
+        _CreateFrameResources();
     }
+    _RecreateSwapchain();
 
-    std::cerr << "Correct present mode was not selected!\n";
-    return presentModes[0];
+    Msg(
+        "Present policy: {}, {} with {} frame(s) in flight",
+        PRESENT_POLICY_NAMES[static_cast<size_t>(m_presentPolicy)],
+        vk::to_string(m_currentPresentMode),
+        m_framesInFlight
+    );
 }
 
 vk::Extent2D CVulkanRenderer::_ChooseSwapChainExtent() {
@@ -754,30 +865,12 @@ void CVulkanRenderer::_CreateRenderPass() {
     m_renderPass = m_device.createRenderPass(renderPassInfo);
 }
 
-void CVulkanRenderer::_CreateDescriptorSetLayout() {
-    vk::DescriptorSetLayoutBinding uboLayoutBinding {};
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = vk::DescriptorType::eUniformBuffer;
-    uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eVertex;
-    uboLayoutBinding.pImmutableSamplers = nullptr;
-
-    vk::DescriptorSetLayoutBinding samplerLayoutBinding {};
-    samplerLayoutBinding.binding = 1;
-    samplerLayoutBinding.descriptorCount = 1;
-    samplerLayoutBinding.descriptorType = vk::DescriptorType::eCombinedImageSampler;
-    samplerLayoutBinding.pImmutableSamplers = nullptr;
-    samplerLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eFragment;
-
-    std::array<vk::DescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
-    vk::DescriptorSetLayoutCreateInfo layoutInfo {};
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
-
-    m_descriptorSetLayout = m_device.createDescriptorSetLayout(layoutInfo);
-}
+vk::ShaderModule CVulkanRenderer::_CreateShaderModule(std::span<const std::byte> byteCode) {
+    // SPIR-V is a stream of 32-bit words, mapped files are page aligned so only the size can be off
+    if (byteCode.empty() || byteCode.size() % sizeof(uint32_t) != 0) {
+        throw std::runtime_error("Shader is missing or corrupted!");
+    }
 
-vk::ShaderModule CVulkanRenderer::_CreateShaderModule(const std::vector<char>& byteCode) {
     vk::ShaderModuleCreateInfo shaderModuleInfo {};
     shaderModuleInfo.codeSize = byteCode.size();
     shaderModuleInfo.pCode = reinterpret_cast<const uint32_t*>(byteCode.data());
@@ -786,14 +879,55 @@ vk::ShaderModule CVulkanRenderer::_CreateShaderModule(const std::vector<char>& b
     return shaderModule;
 }
 
+const Vulkan::CPipelineLayout& CVulkanRenderer::_ReflectPipelineLayout(
+    const std::initializer_list<std::span<const std::byte>> stages
+) {
+    std::vector<Vulkan::CShaderReflection> reflections;
+    for (const std::span<const std::byte> code : stages) {
+        reflections.push_back(Vulkan::ReflectShader(code));
+    }
+    return m_layoutCache.GetPipelineLayout(reflections);
+}
+
+void CVulkanRenderer::_ReserveDescriptorSets(const Vulkan::CPipelineLayout& layout) {
+    for (const vk::DescriptorPoolSize& size : layout.poolSizes) {
+        const auto poolSize = std::ranges::find(m_descriptorPoolSizes, size.type, &vk::DescriptorPoolSize::type);
+        if (poolSize != m_descriptorPoolSizes.end()) {
+            poolSize->descriptorCount += size.descriptorCount;
+        } else {
+            m_descriptorPoolSizes.push_back(size);
+        }
+    }
+    m_descriptorPoolMaxSets += static_cast<uint32_t>(layout.setLayouts.size());
+}
+
 void CVulkanRenderer::_CreatePipeline() {
-    vk::GraphicsPipelineCreateInfo pipelineInfo {};
+    CMappedFile vertShaderCode = m_vertexShaderLoad.Take();
+    CMappedFile fragShaderCode = m_fragmentShaderLoad.Take();
+
+    const Vulkan::CPipelineLayout& layout = _ReflectPipelineLayout({ vertShaderCode.GetView(), fragShaderCode.GetView() });
+    m_pipelineLayout = layout.handle;
+    m_descriptorSetLayout = layout.setLayouts.at(0);
+    _ReserveDescriptorSets(layout);
+
+    m_pipeline = _BuildPipeline(
+        vertShaderCode.GetView(),
+        fragShaderCode.GetView(),
+        m_model.GetVertexFormat(),
+        m_pipelineCache.GetHandle()
+    );
+}
 
-    auto vertShaderCode = resource_loader::ReadFile("shaders/vert.spv");
-    auto fragShaderCode = resource_loader::ReadFile("shaders/frag.spv");
+vk::Pipeline CVulkanRenderer::_BuildPipeline(
+    const std::span<const std::byte> vertexCode,
+    const std::span<const std::byte> fragmentCode,
+    const EVertexFormat vertexFormat,
+    const vk::PipelineCache cache
+) {
+    vk::GraphicsPipelineCreateInfo pipelineInfo {};
 
-    vk::ShaderModule vertexShader = _CreateShaderModule(vertShaderCode);
-    vk::ShaderModule fragmentShader = _CreateShaderModule(fragShaderCode);
+    vk::ShaderModule vertexShader = _CreateShaderModule(vertexCode);
+    vk::ShaderModule fragmentShader = _CreateShaderModule(fragmentCode);
 
     vk::PipelineShaderStageCreateInfo vertShaderStageInfo {};
     vertShaderStageInfo.stage = vk::ShaderStageFlagBits::eVertex;
@@ -810,14 +944,13 @@ void CVulkanRenderer::_CreatePipeline() {
     pipelineInfo.pStages = shaderStages;
 
     //==========
-    vk::VertexInputBindingDescription bindingDescription = CVertex::getBindingDescription();
-    std::array<vk::VertexInputAttributeDescription, 3> attributeDescriptions = CVertex::getAttributeDescriptions();
+    const CVertexInputState vertexInputState = GetVertexInputState(vertexFormat);
 
     vk::PipelineVertexInputStateCreateInfo vertexInputInfo {};
     vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    vertexInputInfo.pVertexBindingDescriptions = &vertexInputState.binding;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputState.attributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions = vertexInputState.attributes.data();
 
     pipelineInfo.pVertexInputState = &vertexInputInfo;
 
@@ -907,13 +1040,6 @@ void CVulkanRenderer::_CreatePipeline() {
 
     pipelineInfo.pColorBlendState = &colorBlending;
 
-    //==========
-    vk::PipelineLayoutCreateInfo pipelineLayoutInfo {};
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
-
-    m_pipelineLayout = m_device.createPipelineLayout(pipelineLayoutInfo);
-
     //==========
     pipelineInfo.layout = m_pipelineLayout;
     pipelineInfo.renderPass = m_renderPass;
@@ -921,10 +1047,11 @@ void CVulkanRenderer::_CreatePipeline() {
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    m_pipeline = m_device.createGraphicsPipeline(VK_NULL_HANDLE, pipelineInfo).value;
+    vk::Pipeline pipeline = m_device.createGraphicsPipeline(cache, pipelineInfo).value;
 
     m_device.destroyShaderModule(fragmentShader);
     m_device.destroyShaderModule(vertexShader);
+    return pipeline;
 }
 
 void CVulkanRenderer::_CreateColorResources() {
@@ -1009,10 +1136,14 @@ void CVulkanRenderer::_CreateCommandPool() {
     commandPoolInfo.queueFamilyIndex = m_queueFamiliesIndices.m_graphicsAndCompute.value();
 
     m_commandPool = m_device.createCommandPool(commandPoolInfo);
+
+    commandPoolInfo.queueFamilyIndex =
+        m_queueFamiliesIndices.m_compute.value_or(*m_queueFamiliesIndices.m_graphicsAndCompute);
+    m_computeCommandPool = m_device.createCommandPool(commandPoolInfo);
 }
 
 void CVulkanRenderer::_CreateCommandBuffers() {
-    m_commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    m_commandBuffers.resize(m_framesInFlight);
 
     vk::CommandBufferAllocateInfo cmdBufferAllocInfo {};
     cmdBufferAllocInfo.commandPool = m_commandPool;
@@ -1047,126 +1178,414 @@ CVulkanRenderer::CBuffer CVulkanRenderer::_CreateBuffer(
     return result;
 }
 
-vk::CommandBuffer CVulkanRenderer::_BeginSingleTimeCommands() {
-    vk::CommandBufferAllocateInfo allocInfo {};
-    allocInfo.level = vk::CommandBufferLevel::ePrimary;
-    allocInfo.commandPool = m_commandPool;
-    allocInfo.commandBufferCount = 1;
+void CVulkanRenderer::_StartLoads() {
+    IAsyncLoader* loader = AsyncLoader();
+
+    // Pipelines are created first, so shaders go ahead of everything else
+    m_vertexShaderLoad = loader->LoadFile("shaders/shader.vert.spv", ELoadPriority::Critical);
+    m_fragmentShaderLoad = loader->LoadFile("shaders/shader.frag.spv", ELoadPriority::Critical);
+    m_computeShaderLoad = loader->LoadFile("shaders/shader.comp.spv", ELoadPriority::Critical);
+    m_cullShaderLoad = loader->LoadFile("shaders/cull.comp.spv", ELoadPriority::Critical);
+
+    m_modelLoad = loader->Submit(ELoadPriority::Startup, [] {
+        // OBJ is only a cooking source, runtime always consumes the cooked and GPU-optimized file.
+        // It is cooked once per content and settings, later runs load it from the derived data cache.
+        Mesh::CCookedMesh model;
+        if (Mesh::LoadCachedMesh(model, MODEL_PATH)) {
+            return model;
+        }
 
-    vk::CommandBuffer commandBuffer = m_device.allocateCommandBuffers(allocInfo)[0];
+        // Shipped builds may only have the cooked file
+        if (!model.Load(COOKED_MODEL_PATH)) {
+            throw std::runtime_error("Failed to load model!");
+        }
+        return model;
+    });
+
+    m_textureCookLoad = loader->Submit(ELoadPriority::Startup, [] {
+        // PNG is only a cooking source, mips are prebuilt so startup neither decodes nor blits
+        const std::filesystem::path cooked = Texture::CookCachedTexture(TEXTURE_PATH);
+        return Texture::CStagedTexture { cooked.empty() ? COOKED_TEXTURE_PATH : cooked.generic_string(), 0, 0 };
+    });
+}
 
-    vk::CommandBufferBeginInfo beginInfo {};
-    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
-    commandBuffer.begin(beginInfo);
+void CVulkanRenderer::_StartTextureLoads(const ELoadPriority priority) {
+    m_stagedTextures = { m_textureCookLoad.Take() };
+    const uint64_t stagingSize = Texture::LayoutStagedTextures(m_stagedTextures);
+
+    // Stays mapped while the I/O threads read every texture file into its own region
+    m_textureStagingBuffer = _CreateBuffer(
+        stagingSize,
+        vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+        vma::AllocationCreateFlagBits::eHostAccessSequentialWrite
+    );
+    void* staging = m_allocator.mapMemory(m_textureStagingBuffer.allocation);
+
+    m_textureLoads = Texture::LoadStagedTextures(
+        m_stagedTextures,
+        { static_cast<std::byte*>(staging), stagingSize },
+        priority
+    );
+}
 
-    return commandBuffer;
+void CVulkanRenderer::_DestroyTextureStaging() {
+    m_textureLoads.clear();
+    m_stagedTextures.clear();
+    // Copies out of it are only recorded so far
+    m_uploads.ReleaseAfterUpload([this, staging = m_textureStagingBuffer] {
+        m_allocator.unmapMemory(staging.allocation);
+        m_allocator.destroyBuffer(staging.buffer, staging.allocation);
+    });
+    m_textureStagingBuffer = {};
 }
 
-void CVulkanRenderer::_EndSingleTimeCommands(vk::CommandBuffer commandBuffer) {
-    commandBuffer.end();
+void CVulkanRenderer::_WatchAssets() {
 
-    vk::SubmitInfo submitInfo {};
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
+    // Sources are cooked from what resource_loader maps, loose files live in the root directory
+    const bool watching = m_assetWatcher.Start(resource_loader::GetRootDir(), [this](const std::filesystem::path& path) {
+        std::lock_guard lock(m_changedAssetsMutex);
+        m_changedAssets.push_back(path);
+    });
+    if (!watching) {
+        Warning("Cannot watch the asset directory, hot reload is disabled");
+    }
 
-    m_graphicsQueue.submit(submitInfo);
-    m_graphicsQueue.waitIdle();
+    // Shipped builds have no shader sources and keep the SPIR-V compiled with the project
+    const bool watchingShaders = m_shaderWatcher.Start(SHADER_SOURCE_DIRECTORY, [this](const std::filesystem::path& path) {
+        std::lock_guard lock(m_changedAssetsMutex);
+        m_changedShaders.push_back(path);
+    });
+    if (!watchingShaders) {
+        Msg("Shader sources are not available, shader hot reload is disabled");
+    }
+}
 
-    m_device.freeCommandBuffers(m_commandPool, commandBuffer);
+void CVulkanRenderer::_StartPipelineRebuild(const EShaderPipeline pipeline) {
+    const auto index = static_cast<std::size_t>(pipeline);
+    if (m_pipelineRebuilds[index].IsValid()) {
+        m_pipelinesStale[index] = true;
+        return;
+    }
+    m_pipelinesStale[index] = false;
+    m_pipelineRebuildStarts[index] = std::chrono::steady_clock::now();
+
+    // Only handles that stay valid until the rebuild is swapped in or waited for in the destructor are captured.
+    // Unchanged stages of the pipeline are cache hits.
+    const std::filesystem::path directory = SHADER_SOURCE_DIRECTORY;
+    switch (pipeline) {
+        case EShaderPipeline::Graphics:
+            m_pipelineRebuilds[index] = AsyncLoader()->Submit(
+                ELoadPriority::Background,
+                [this, directory, vertexFormat = m_model.GetVertexFormat(), layout = m_pipelineLayout] {
+                    const CMappedFile vertexCode = Vulkan::CompileShader(directory / "shader.vert");
+                    const CMappedFile fragmentCode = Vulkan::CompileShader(directory / "shader.frag");
+                    _CheckPipelineLayout({ vertexCode.GetView(), fragmentCode.GetView() }, layout);
+                    return _BuildInWorkerCache([&](const vk::PipelineCache cache) {
+                        return _BuildPipeline(vertexCode.GetView(), fragmentCode.GetView(), vertexFormat, cache);
+                    });
+                }
+            );
+            break;
+        case EShaderPipeline::Particles:
+            m_pipelineRebuilds[index] = AsyncLoader()->Submit(
+                ELoadPriority::Background,
+                [this, directory, layout = m_computePipelineLayout] {
+                    const CMappedFile code = Vulkan::CompileShader(directory / "shader.comp");
+                    _CheckPipelineLayout({ code.GetView() }, layout);
+                    return _BuildInWorkerCache([&](const vk::PipelineCache cache) {
+                        return _BuildComputePipeline(code.GetView(), layout, cache);
+                    });
+                }
+            );
+            break;
+        case EShaderPipeline::MeshletCull:
+            m_pipelineRebuilds[index] = AsyncLoader()->Submit(
+                ELoadPriority::Background,
+                [this, directory, layout = m_meshletCullPipelineLayout] {
+                    const CMappedFile code = Vulkan::CompileShader(directory / "cull.comp");
+                    _CheckPipelineLayout({ code.GetView() }, layout);
+                    return _BuildInWorkerCache([&](const vk::PipelineCache cache) {
+                        return _BuildComputePipeline(code.GetView(), layout, cache);
+                    });
+                }
+            );
+            break;
+    }
 }
 
-void CVulkanRenderer::_CopyBuffer(
-    vk::Buffer srcBuffer,
-    vk::Buffer dstBuffer,
-    vk::DeviceSize size
+void CVulkanRenderer::_CheckPipelineLayout(
+    const std::initializer_list<std::span<const std::byte>> stages,
+    const vk::PipelineLayout layout
 ) {
-    vk::CommandBuffer commandBuffer = _BeginSingleTimeCommands();
-
-    vk::BufferCopy copyRegion {};
-    copyRegion.size = size;
-    commandBuffer.copyBuffer(srcBuffer, dstBuffer, copyRegion);
+    // Descriptor sets and push constants are written for the layout the renderer started with
+    if (_ReflectPipelineLayout(stages).handle != layout) {
+        throw std::runtime_error("resources of the shader changed, restart to see it");
+    }
+}
 
-    _EndSingleTimeCommands(commandBuffer);
+vk::Pipeline CVulkanRenderer::_BuildInWorkerCache(const std::function<vk::Pipeline(vk::PipelineCache)>& build) {
+    const vk::PipelineCache cache = m_pipelineCache.CreateWorkerCache();
+    vk::Pipeline pipeline {};
+    try {
+        pipeline = build(cache);
+    } catch (...) {
+        m_device.destroyPipelineCache(cache);
+        throw;
+    }
+    m_pipelineCache.Merge(cache);
+    return pipeline;
 }
 
-void CVulkanRenderer::LoadModel() {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+void CVulkanRenderer::_ApplyShaderReloads() {
+    std::vector<std::filesystem::path> changedShaders;
+    {
+        std::lock_guard lock(m_changedAssetsMutex);
+        changedShaders.swap(m_changedShaders);
+    }
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str())) {
-        throw std::runtime_error(warn + err);
+    for (const std::filesystem::path& path : changedShaders) {
+        if (path == "shader.vert" || path == "shader.frag") {
+            _StartPipelineRebuild(EShaderPipeline::Graphics);
+        } else if (path == "shader.comp") {
+            _StartPipelineRebuild(EShaderPipeline::Particles);
+        } else if (path == "cull.comp" && m_meshletCulling) {
+            _StartPipelineRebuild(EShaderPipeline::MeshletCull);
+        }
     }
 
-    std::unordered_map<CVertex, uint32_t> uniqueVertices {};
+    const std::array<vk::Pipeline*, SHADER_PIPELINE_COUNT> pipelines = {
+        &m_pipeline,
+        &m_computePipeline,
+        &m_meshletCullPipeline,
+    };
+    for (std::size_t i = 0; i < SHADER_PIPELINE_COUNT; i++) {
+        CLoadHandle<vk::Pipeline>& rebuild = m_pipelineRebuilds[i];
+        if (!rebuild.IsValid() || !rebuild.IsReady()) {
+            continue;
+        }
+
+        try {
+            const vk::Pipeline pipeline = rebuild.Get();
+            // Command buffers of the frames in flight still reference the old one
+            _DeferDestruction([this, oldPipeline = *pipelines[i]] { m_device.destroyPipeline(oldPipeline); });
+            *pipelines[i] = pipeline;
+
+            const auto elapsed = std::chrono::steady_clock::now() - m_pipelineRebuildStarts[i];
+            Msg(
+                "Rebuilt {} pipeline in {:.1f} ms",
+                SHADER_PIPELINE_NAMES[i],
+                std::chrono::duration<double, std::milli>(elapsed).count()
+            );
+        } catch (const std::exception& e) {
+            Warning("Failed to rebuild {} pipeline: {}", SHADER_PIPELINE_NAMES[i], e.what());
+        }
+        rebuild = {};
 
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            CVertex vertex {};
+        if (m_pipelinesStale[i]) {
+            _StartPipelineRebuild(static_cast<EShaderPipeline>(i));
+        }
+    }
+}
 
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
+void CVulkanRenderer::_ApplyHotReloads() {
+    std::vector<std::filesystem::path> changedAssets;
+    {
+        std::lock_guard lock(m_changedAssetsMutex);
+        changedAssets.swap(m_changedAssets);
+    }
 
-            vertex.texCoord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
+    // Re-imports go through the derived data cache, which notices the new content. A reload that is still
+    // running when the file changes again is replaced, its result is dropped.
+    for (const std::filesystem::path& path : changedAssets) {
+        if (path == MODEL_PATH) {
+            m_modelReloadStart = std::chrono::steady_clock::now();
+            m_modelReload = AsyncLoader()->Submit(ELoadPriority::Background, [] {
+                Mesh::CCookedMesh model;
+                if (!Mesh::LoadCachedMesh(model, MODEL_PATH)) {
+                    throw std::runtime_error("source is gone");
+                }
+                return model;
+            });
+        } else if (path == TEXTURE_PATH) {
+            m_textureReloadStart = std::chrono::steady_clock::now();
+            m_textureReload = AsyncLoader()->Submit(ELoadPriority::Background, [] {
+                const std::filesystem::path cooked = Texture::CookCachedTexture(TEXTURE_PATH);
+                if (cooked.empty()) {
+                    throw std::runtime_error("source is gone");
+                }
+                return Texture::CStagedTexture { cooked.generic_string(), 0, 0 };
+            });
+        }
+    }
 
-            vertex.color = {1.0f, 1.0f, 1.0f};
+    const auto elapsedMilliseconds = [](const std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
 
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(m_vertices.size());
-                m_vertices.push_back(vertex);
+    if (m_modelReload.IsValid() && m_modelReload.IsReady()) {
+        try {
+            if (_SwapModel(m_modelReload.Take())) {
+                Msg("Reloaded \"{}\" in {:.1f} ms", MODEL_PATH, elapsedMilliseconds(m_modelReloadStart));
             }
-
-            m_indices.push_back(uniqueVertices[vertex]);
+        } catch (const std::exception& e) {
+            Warning("Failed to reload \"{}\": {}", MODEL_PATH, e.what());
         }
+        m_modelReload = {};
     }
-}
 
-void CVulkanRenderer::_CreateVertexBuffer() {
-    vk::DeviceSize bufferSize = sizeof(m_vertices[0]) * m_vertices.size();
+    // Cooked texture is read into staging on the I/O threads like at startup, one reload at a time
+    if (m_textureReload.IsValid() && m_textureReload.IsReady() && m_textureLoads.empty()) {
+        m_textureCookLoad = m_textureReload;
+        m_textureReload = {};
+        try {
+            _StartTextureLoads(ELoadPriority::Background);
+        } catch (const std::exception& e) {
+            Warning("Failed to reload \"{}\": {}", TEXTURE_PATH, e.what());
+        }
+    }
 
-    CBuffer stagingBuffer = _CreateBuffer(
-        bufferSize,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-        vma::AllocationCreateFlagBits::eHostAccessRandom
-    );
+    if (!m_textureLoads.empty() && m_textureLoads[0].IsReady()) {
+        try {
+            m_textureLoads[0].Get();
+        } catch (const std::exception& e) {
+            Warning("Failed to reload \"{}\": {}", TEXTURE_PATH, e.what());
+            _DestroyTextureStaging();
+            return;
+        }
 
-    void* data = m_allocator.mapMemory(stagingBuffer.allocation);
-        memcpy(data, m_vertices.data(), (std::size_t)bufferSize);
-    m_allocator.unmapMemory(stagingBuffer.allocation);
+        _RetireTexture();
+        _CreateTextureImage();
+        _CreateTextureImageView(m_textureFormat);
+        std::fill(m_descriptorSetsDirty.begin(), m_descriptorSetsDirty.end(), true);
+        Msg("Reloaded \"{}\" in {:.1f} ms", TEXTURE_PATH, elapsedMilliseconds(m_textureReloadStart));
+    }
+}
 
-    m_vertexBuffer = _CreateBuffer(
-        bufferSize,
-        vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-        vk::MemoryPropertyFlagBits::eDeviceLocal,
-        {}
-    );
+bool CVulkanRenderer::_SwapModel(Mesh::CCookedMesh&& model) {
+    // Vertex input of the pipeline is built for the cooked vertex format
+    if (model.GetVertexFormat() != m_model.GetVertexFormat()) {
+        Warning("Reloaded \"{}\" has another vertex format, restart to see it", MODEL_PATH);
+        return false;
+    }
+    if (m_meshletCulling && model.GetMeshlets().empty()) {
+        Warning("Reloaded \"{}\" has no meshlets, restart to see it", MODEL_PATH);
+        return false;
+    }
 
-    _CopyBuffer(stagingBuffer.buffer, m_vertexBuffer.buffer, bufferSize);
+    _DeferDestruction([this, vertexBuffer = m_vertexBuffer, indexBuffer = m_indexBuffer] {
+        m_allocator.destroyBuffer(vertexBuffer.buffer, vertexBuffer.allocation);
+        m_allocator.destroyBuffer(indexBuffer.buffer, indexBuffer.allocation);
+    });
+    if (m_meshletCulling) {
+        _DeferDestruction([
+            this,
+            meshletBuffer = m_meshletBuffer,
+            drawCommandBuffers = std::move(m_drawCommandBuffers),
+            drawCountBuffers = std::move(m_drawCountBuffers)
+        ] {
+            m_allocator.destroyBuffer(meshletBuffer.buffer, meshletBuffer.allocation);
+            for (std::size_t i = 0; i < drawCommandBuffers.size(); i++) {
+                m_allocator.destroyBuffer(drawCommandBuffers[i].buffer, drawCommandBuffers[i].allocation);
+                m_allocator.destroyBuffer(drawCountBuffers[i].buffer, drawCountBuffers[i].allocation);
+            }
+        });
+        m_drawCommandBuffers.clear();
+        m_drawCountBuffers.clear();
+    }
 
-    m_allocator.destroyBuffer(stagingBuffer.buffer, stagingBuffer.allocation);
+    m_model = std::move(model);
+    _CreateVertexBuffer();
+    _CreateIndexBuffer();
+    if (m_meshletCulling) {
+        _CreateMeshletBuffers();
+        _CreateDrawBuffers();
+    }
+    std::fill(m_descriptorSetsDirty.begin(), m_descriptorSetsDirty.end(), true);
+    return true;
 }
 
-void CVulkanRenderer::_CreateIndexBuffer() {
-    vk::DeviceSize bufferSize = sizeof(m_indices[0]) * m_indices.size();
-
-    CBuffer stagingBuffer = _CreateBuffer(
+void CVulkanRenderer::_RetireTexture() {
+    if (m_textureStreaming) {
+        _CancelTextureUploads();
+        _DeferDestruction([
+            this,
+            image = m_textureImage.image,
+            imageView = m_textureImageView,
+            tailMemory = m_textureTailMemory,
+            levelMemory = std::move(m_textureLevelMemory)
+        ] {
+            m_device.destroyImageView(imageView);
+            m_device.destroyImage(image);
+            for (vma::Allocation allocation : levelMemory) {
+                if (allocation) {
+                    m_allocator.freeMemory(allocation);
+                }
+            }
+            if (tailMemory) {
+                m_allocator.freeMemory(tailMemory);
+            }
+        });
+        m_textureTailMemory = {};
+        m_textureLevelMemory.clear();
+        m_textureStreamer.reset();
+    } else {
+        _DeferDestruction([this, image = m_textureImage, imageView = m_textureImageView] {
+            m_device.destroyImageView(imageView);
+            m_allocator.destroyImage(image.image, image.allocation);
+        });
+    }
+    m_textureImage = {};
+    m_textureImageView = {};
+}
+
+void CVulkanRenderer::_DeferDestruction(std::function<void()> destroy) {
+    // The frame being recorded may already use them
+    m_deferredDestruction.emplace_back(m_submittedFrame + 1, std::move(destroy));
+}
+
+void CVulkanRenderer::_FlushDeferredDestruction(const bool all) {
+    const uint64_t completedFrame = all ? UINT64_MAX : GetCompletedFrame();
+    while (!m_deferredDestruction.empty() && m_deferredDestruction.front().first <= completedFrame) {
+        m_deferredDestruction.front().second();
+        m_deferredDestruction.pop_front();
+    }
+}
+
+void CVulkanRenderer::_RefreshDescriptorSets() {
+    if (!m_descriptorSetsDirty[m_currentFrame]) {
+        return;
+    }
+    if (!m_descriptorSets.empty()) {
+        _WriteDescriptorSet(m_currentFrame);
+    }
+    if (m_meshletCulling) {
+        _WriteMeshletCullDescriptorSet(m_currentFrame);
+    }
+    m_descriptorSetsDirty[m_currentFrame] = false;
+}
+
+void CVulkanRenderer::LoadModel() {
+    m_model = m_modelLoad.Take();
+}
+
+void CVulkanRenderer::_CreateVertexBuffer() {
+    std::span<const std::byte> vertexData = m_model.GetVertexData();
+    vk::DeviceSize bufferSize = vertexData.size();
+
+    m_vertexBuffer = _CreateBuffer(
         bufferSize,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-        vma::AllocationCreateFlagBits::eHostAccessRandom
+        vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal,
+        {}
     );
 
-    void* data = m_allocator.mapMemory(stagingBuffer.allocation);
-        memcpy(data, m_indices.data(), (std::size_t)bufferSize);
-    m_allocator.unmapMemory(stagingBuffer.allocation);
+    m_uploads.UploadBuffer(m_vertexBuffer.buffer, 0, vertexData);
+}
+
+void CVulkanRenderer::_CreateIndexBuffer() {
+    std::span<const std::byte> indexData = m_model.GetIndexData();
+    vk::DeviceSize bufferSize = indexData.size();
 
     m_indexBuffer = _CreateBuffer(
         bufferSize,
@@ -1175,17 +1594,15 @@ void CVulkanRenderer::_CreateIndexBuffer() {
         {}
     );
 
-    _CopyBuffer(stagingBuffer.buffer, m_indexBuffer.buffer, bufferSize);
-
-    m_allocator.destroyBuffer(stagingBuffer.buffer, stagingBuffer.allocation);
+    m_uploads.UploadBuffer(m_indexBuffer.buffer, 0, indexData);
 }
 
 void CVulkanRenderer::_CreateUniformBuffers() {
     vk::DeviceSize bufferSize = sizeof(CUniformBufferObject);
 
-    m_uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    m_uniformBuffersData.resize(MAX_FRAMES_IN_FLIGHT);
-    for (std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    m_uniformBuffers.resize(m_framesInFlight);
+    m_uniformBuffersData.resize(m_framesInFlight);
+    for (std::size_t i = 0; i < m_framesInFlight; i++) {
         m_uniformBuffers[i] = _CreateBuffer(
             bufferSize,
             vk::BufferUsageFlagBits::eUniformBuffer,
@@ -1197,7 +1614,7 @@ void CVulkanRenderer::_CreateUniformBuffers() {
 }
 
 void CVulkanRenderer::_CreateShaderStorageBuffers() {
-    m_shaderStorageBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    m_shaderStorageBuffers.resize(m_framesInFlight);
 
     // Initialize particles
     std::default_random_engine rndEngine((unsigned)time(nullptr));
@@ -1217,69 +1634,31 @@ void CVulkanRenderer::_CreateShaderStorageBuffers() {
 
     vk::DeviceSize bufferSize = sizeof(Particle) * /*PARTICLE_COUNT*/ 800;
 
-    CBuffer stagingBuffer = _CreateBuffer(
-        bufferSize,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-        vma::AllocationCreateFlagBits::eHostAccessRandom
-    );
-
-    void* data = m_allocator.mapMemory(stagingBuffer.allocation);
-        memcpy(data, particles.data(), static_cast<size_t>(bufferSize));
-    m_allocator.unmapMemory(stagingBuffer.allocation);
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < m_framesInFlight; i++) {
         m_shaderStorageBuffers[i] = _CreateBuffer(
             bufferSize,
             vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
             vk::MemoryPropertyFlagBits::eDeviceLocal,
             {}
         );
-        // Copy data from the staging buffer (host) to the shader storage buffer (GPU)
-        _CopyBuffer(stagingBuffer.buffer, m_shaderStorageBuffers[i].buffer, bufferSize);
+        // Staged in the upload ring, the copy to the shader storage buffer (GPU) goes out with the next flush
+        m_uploads.UploadBuffer(m_shaderStorageBuffers[i].buffer, 0, std::as_bytes(std::span(particles)));
     }
-
-    m_allocator.destroyBuffer(stagingBuffer.buffer, stagingBuffer.allocation);
-}
-
-void CVulkanRenderer::_CreateComputeDescriptorSetLayout() {
-    std::array<vk::DescriptorSetLayoutBinding, 3> layoutBindings {};
-    layoutBindings[0].binding = 0;
-    layoutBindings[0].descriptorCount = 1;
-    layoutBindings[0].descriptorType = vk::DescriptorType::eUniformBuffer;
-    layoutBindings[0].pImmutableSamplers = nullptr;
-    layoutBindings[0].stageFlags = vk::ShaderStageFlagBits::eCompute;
-
-    layoutBindings[1].binding = 1;
-    layoutBindings[1].descriptorCount = 1;
-    layoutBindings[1].descriptorType = vk::DescriptorType::eStorageBuffer;
-    layoutBindings[1].pImmutableSamplers = nullptr;
-    layoutBindings[1].stageFlags = vk::ShaderStageFlagBits::eCompute;
-
-    layoutBindings[2].binding = 2;
-    layoutBindings[2].descriptorCount = 1;
-    layoutBindings[2].descriptorType = vk::DescriptorType::eStorageBuffer;
-    layoutBindings[2].pImmutableSamplers = nullptr;
-    layoutBindings[2].stageFlags = vk::ShaderStageFlagBits::eCompute;
-
-    vk::DescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.bindingCount = 3;
-    layoutInfo.pBindings = layoutBindings.data();
-
-    m_computeDescriptorSetLayout = m_device.createDescriptorSetLayout(layoutInfo, nullptr);
+    // The upload hands them to the graphics family, the compute family takes them over before its first dispatch
+    m_particleHandoffPending = m_queueFamiliesIndices.m_compute.has_value();
 }
 
 void CVulkanRenderer::_CreateComputeDescriptorSets() {
-    std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, m_computeDescriptorSetLayout);
+    std::vector<vk::DescriptorSetLayout> layouts(m_framesInFlight, m_computeDescriptorSetLayout);
     vk::DescriptorSetAllocateInfo allocInfo {};
     allocInfo.descriptorPool = m_descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    allocInfo.descriptorSetCount = m_framesInFlight;
     allocInfo.pSetLayouts = layouts.data();
 
-    m_computeDescriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+    m_computeDescriptorSets.resize(m_framesInFlight);
     m_computeDescriptorSets = m_device.allocateDescriptorSets(allocInfo);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < m_framesInFlight; i++) {
         vk::DescriptorBufferInfo uniformBufferInfo {};
         uniformBufferInfo.buffer = m_uniformBuffers[i].buffer;
         uniformBufferInfo.offset = 0;
@@ -1294,9 +1673,9 @@ void CVulkanRenderer::_CreateComputeDescriptorSets() {
         descriptorWrites[0].pBufferInfo = &uniformBufferInfo;
 
         vk::DescriptorBufferInfo storageBufferInfoLastFrame {};
-        storageBufferInfoLastFrame.buffer = m_shaderStorageBuffers[(i - 1) % MAX_FRAMES_IN_FLIGHT].buffer;
+        storageBufferInfoLastFrame.buffer = m_shaderStorageBuffers[(i + m_framesInFlight - 1) % m_framesInFlight].buffer;
         storageBufferInfoLastFrame.offset = 0;
-        storageBufferInfoLastFrame.range = sizeof(Particle) * 800 /*PARTICLE_COUNT*/;
+        storageBufferInfoLastFrame.range = vk::WholeSize;
 
         descriptorWrites[1].dstSet = m_computeDescriptorSets[i];
         descriptorWrites[1].dstBinding = 1;
@@ -1308,7 +1687,7 @@ void CVulkanRenderer::_CreateComputeDescriptorSets() {
         vk::DescriptorBufferInfo storageBufferInfoCurrentFrame {};
         storageBufferInfoCurrentFrame.buffer = m_shaderStorageBuffers[i].buffer;
         storageBufferInfoCurrentFrame.offset = 0;
-        storageBufferInfoCurrentFrame.range = sizeof(Particle) * 800 /*PARTICLE_COUNT*/;
+        storageBufferInfoCurrentFrame.range = vk::WholeSize;
 
         descriptorWrites[2].dstSet = m_computeDescriptorSets[i];
         descriptorWrites[2].dstBinding = 2;
@@ -1321,36 +1700,77 @@ void CVulkanRenderer::_CreateComputeDescriptorSets() {
     }
 }
 
-void CVulkanRenderer::_CreateComputePipeline() {
-    auto computeShaderCode = resource_loader::ReadFile("shaders/comp.spv");
+vk::Pipeline CVulkanRenderer::_BuildComputePipeline(
+    const std::span<const std::byte> code,
+    const vk::PipelineLayout layout,
+    const vk::PipelineCache cache
+) {
+    vk::ShaderModule shaderModule = _CreateShaderModule(code);
 
-    vk::ShaderModule computeShaderModule = _CreateShaderModule(computeShaderCode);
+    vk::PipelineShaderStageCreateInfo shaderStageInfo {};
+    shaderStageInfo.stage = vk::ShaderStageFlagBits::eCompute;
+    shaderStageInfo.module = shaderModule;
+    shaderStageInfo.pName = "main";
 
-    vk::PipelineShaderStageCreateInfo computeShaderStageInfo {};
-    computeShaderStageInfo.stage = vk::ShaderStageFlagBits::eCompute;
-    computeShaderStageInfo.module = computeShaderModule;
-    computeShaderStageInfo.pName = "main";
+    vk::ComputePipelineCreateInfo pipelineInfo {};
+    pipelineInfo.layout = layout;
+    pipelineInfo.stage = shaderStageInfo;
 
-    vk::PipelineLayoutCreateInfo pipelineLayoutInfo {};
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &m_computeDescriptorSetLayout;
+    vk::Pipeline pipeline = m_device.createComputePipeline(cache, pipelineInfo).value;
 
-    m_computePipelineLayout = m_device.createPipelineLayout(pipelineLayoutInfo);
+    m_device.destroyShaderModule(shaderModule);
+    return pipeline;
+}
 
-    vk::ComputePipelineCreateInfo pipelineInfo {};
-    pipelineInfo.layout = m_computePipelineLayout;
-    pipelineInfo.stage = computeShaderStageInfo;
+void CVulkanRenderer::_CreateComputePipeline() {
+    CMappedFile computeShaderCode = m_computeShaderLoad.Take();
 
-    m_computePipeline = m_device.createComputePipeline(VK_NULL_HANDLE, pipelineInfo).value;
+    const Vulkan::CPipelineLayout& layout = _ReflectPipelineLayout({ computeShaderCode.GetView() });
+    m_computePipelineLayout = layout.handle;
+    m_computeDescriptorSetLayout = layout.setLayouts.at(0);
+    _ReserveDescriptorSets(layout);
 
-    m_device.destroyShaderModule(computeShaderModule);
+    m_computePipeline = _BuildComputePipeline(
+        computeShaderCode.GetView(),
+        m_computePipelineLayout,
+        m_pipelineCache.GetHandle()
+    );
 }
 
-void CVulkanRenderer::_RecordComputeCommandBuffer(vk::CommandBuffer commandBuffer) {
+void CVulkanRenderer::_RecordComputeCommandBuffer(vk::CommandBuffer commandBuffer, const bool acquireParticles) {
     vk::CommandBufferBeginInfo beginInfo {};
 
     commandBuffer.begin(beginInfo);
 
+    if (acquireParticles) {
+        std::vector<vk::BufferMemoryBarrier> acquireBarriers = _GetParticleHandoffBarriers();
+        for (vk::BufferMemoryBarrier& barrier : acquireBarriers) {
+            barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+        }
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eComputeShader,
+            {},
+            nullptr,
+            acquireBarriers,
+            nullptr
+        );
+    }
+
+    // Reads the particles the previous frame's dispatch wrote and overwrites the ones an older frame read. Both
+    // ran earlier on this queue, whether or not it is a dedicated one.
+    vk::MemoryBarrier previousFrameBarrier {};
+    previousFrameBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    previousFrameBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eComputeShader,
+        {},
+        previousFrameBarrier,
+        nullptr,
+        nullptr
+    );
+
     commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_computePipeline);
 
     commandBuffer.bindDescriptorSets(
@@ -1369,43 +1789,246 @@ void CVulkanRenderer::_RecordComputeCommandBuffer(vk::CommandBuffer commandBuffe
 }
 
 void CVulkanRenderer::_CreateComputeCommandBuffers() {
-    m_computeCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    m_computeCommandBuffers.resize(m_framesInFlight);
 
     vk::CommandBufferAllocateInfo allocInfo {};
-    allocInfo.commandPool = m_commandPool;
+    allocInfo.commandPool = m_computeCommandPool;
     allocInfo.level = vk::CommandBufferLevel::ePrimary;
     allocInfo.commandBufferCount = (uint32_t)m_computeCommandBuffers.size();
 
     m_computeCommandBuffers = m_device.allocateCommandBuffers(allocInfo);
 }
 
+std::vector<vk::BufferMemoryBarrier> CVulkanRenderer::_GetParticleHandoffBarriers() const {
+    std::vector<vk::BufferMemoryBarrier> barriers(m_shaderStorageBuffers.size());
+    for (std::size_t i = 0; i < barriers.size(); i++) {
+        barriers[i].srcQueueFamilyIndex = *m_queueFamiliesIndices.m_graphicsAndCompute;
+        barriers[i].dstQueueFamilyIndex = *m_queueFamiliesIndices.m_compute;
+        barriers[i].buffer = m_shaderStorageBuffers[i].buffer;
+        barriers[i].offset = 0;
+        barriers[i].size = vk::WholeSize;
+    }
+    return barriers;
+}
+
+vk::Semaphore CVulkanRenderer::_ReleaseParticleBuffers() {
+    vk::CommandBufferAllocateInfo allocInfo {};
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.level = vk::CommandBufferLevel::ePrimary;
+    allocInfo.commandBufferCount = 1;
+    vk::CommandBuffer commandBuffer = m_device.allocateCommandBuffers(allocInfo)[0];
+
+    vk::CommandBufferBeginInfo beginInfo {};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    commandBuffer.begin(beginInfo);
+
+    // Submitted after the upload flush, so the release is ordered after the copies or their acquire
+    std::vector<vk::BufferMemoryBarrier> releaseBarriers = _GetParticleHandoffBarriers();
+    for (vk::BufferMemoryBarrier& barrier : releaseBarriers) {
+        barrier.srcAccessMask = vk::AccessFlagBits::eMemoryWrite;
+    }
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eAllCommands,
+        vk::PipelineStageFlagBits::eBottomOfPipe,
+        {},
+        nullptr,
+        releaseBarriers,
+        nullptr
+    );
+    commandBuffer.end();
+
+    vk::Semaphore released = m_device.createSemaphore(vk::SemaphoreCreateInfo {});
+
+    vk::SubmitInfo submitInfo {};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &released;
+    m_graphicsQueue.submit(submitInfo);
+
+    // The frame being recorded waits for the compute submission that consumes the semaphore
+    _DeferDestruction([this, commandBuffer, released] {
+        m_device.freeCommandBuffers(m_commandPool, commandBuffer);
+        m_device.destroySemaphore(released);
+    });
+    return released;
+}
+
+void CVulkanRenderer::_CreateMeshletCullPipeline() {
+    CMappedFile cullShaderCode = m_cullShaderLoad.Take();
+
+    // _RecordMeshletCulling pushes the whole struct
+    if (Vulkan::ReflectShader(cullShaderCode.GetView()).pushConstantSize != sizeof(Vulkan::CMeshletCullConstants)) {
+        throw std::runtime_error("Push constants of cull.comp don't match CMeshletCullConstants!");
+    }
+
+    const Vulkan::CPipelineLayout& layout = _ReflectPipelineLayout({ cullShaderCode.GetView() });
+    m_meshletCullPipelineLayout = layout.handle;
+    m_meshletCullDescriptorSetLayout = layout.setLayouts.at(0);
+    _ReserveDescriptorSets(layout);
+
+    m_meshletCullPipeline = _BuildComputePipeline(
+        cullShaderCode.GetView(),
+        m_meshletCullPipelineLayout,
+        m_pipelineCache.GetHandle()
+    );
+}
+
+void CVulkanRenderer::_CreateMeshletBuffers() {
+    std::span<const Mesh::CMeshlet> meshlets = m_model.GetMeshlets();
+    vk::DeviceSize bufferSize = meshlets.size_bytes();
+
+    m_meshletBuffer = _CreateBuffer(
+        bufferSize,
+        vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal,
+        {}
+    );
+
+    m_uploads.UploadBuffer(m_meshletBuffer.buffer, 0, std::as_bytes(meshlets));
+}
+
+void CVulkanRenderer::_CreateDrawBuffers() {
+    m_drawCommandBuffers.resize(m_framesInFlight);
+    m_drawCountBuffers.resize(m_framesInFlight);
+    for (size_t i = 0; i < m_framesInFlight; i++) {
+        m_drawCommandBuffers[i] = _CreateBuffer(
+            sizeof(Vulkan::CDrawIndexedIndirectCommand) * m_model.GetMeshlets().size(),
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+            vk::MemoryPropertyFlagBits::eDeviceLocal,
+            {}
+        );
+        m_drawCountBuffers[i] = _CreateBuffer(
+            sizeof(uint32_t),
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer |
+                vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eDeviceLocal,
+            {}
+        );
+    }
+}
+
+void CVulkanRenderer::_CreateMeshletCullDescriptorSets() {
+    std::vector<vk::DescriptorSetLayout> layouts(m_framesInFlight, m_meshletCullDescriptorSetLayout);
+    vk::DescriptorSetAllocateInfo allocInfo {};
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = m_framesInFlight;
+    allocInfo.pSetLayouts = layouts.data();
+
+    m_meshletCullDescriptorSets = m_device.allocateDescriptorSets(allocInfo);
+
+    for (size_t i = 0; i < m_framesInFlight; i++) {
+        _WriteMeshletCullDescriptorSet(i);
+    }
+}
+
+void CVulkanRenderer::_WriteMeshletCullDescriptorSet(const std::size_t frame) {
+    std::array<vk::DescriptorBufferInfo, 3> bufferInfos {};
+    bufferInfos[0].buffer = m_meshletBuffer.buffer;
+    bufferInfos[0].range = vk::WholeSize;
+    bufferInfos[1].buffer = m_drawCommandBuffers[frame].buffer;
+    bufferInfos[1].range = vk::WholeSize;
+    bufferInfos[2].buffer = m_drawCountBuffers[frame].buffer;
+    bufferInfos[2].range = vk::WholeSize;
+
+    std::array<vk::WriteDescriptorSet, 3> descriptorWrites {};
+    for (uint32_t binding = 0; binding < descriptorWrites.size(); binding++) {
+        descriptorWrites[binding].dstSet = m_meshletCullDescriptorSets[frame];
+        descriptorWrites[binding].dstBinding = binding;
+        descriptorWrites[binding].dstArrayElement = 0;
+        descriptorWrites[binding].descriptorType = vk::DescriptorType::eStorageBuffer;
+        descriptorWrites[binding].descriptorCount = 1;
+        descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+    }
+
+    m_device.updateDescriptorSets(static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+// Recorded before the render pass: resets the draw count, culls meshlets and makes the draws visible to indirect reads
+void CVulkanRenderer::_RecordMeshletCulling(vk::CommandBuffer commandBuffer) {
+    commandBuffer.fillBuffer(m_drawCountBuffers[m_currentFrame].buffer, 0, sizeof(uint32_t), 0);
+
+    vk::MemoryBarrier resetBarrier {};
+    resetBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    resetBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eComputeShader,
+        {},
+        resetBarrier,
+        nullptr,
+        nullptr
+    );
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_meshletCullPipeline);
+    commandBuffer.bindDescriptorSets(
+        vk::PipelineBindPoint::eCompute,
+        m_meshletCullPipelineLayout,
+        0,
+        1,
+        &m_meshletCullDescriptorSets[m_currentFrame],
+        0,
+        nullptr
+    );
+    commandBuffer.pushConstants(
+        m_meshletCullPipelineLayout,
+        vk::ShaderStageFlagBits::eCompute,
+        0,
+        sizeof(m_meshletCullConstants),
+        &m_meshletCullConstants
+    );
+    commandBuffer.dispatch(
+        (m_meshletCullConstants.meshletCount + Vulkan::MESHLET_CULL_GROUP_SIZE - 1) / Vulkan::MESHLET_CULL_GROUP_SIZE,
+        1,
+        1
+    );
+
+    vk::MemoryBarrier cullBarrier {};
+    cullBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    cullBarrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead;
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eDrawIndirect,
+        {},
+        cullBarrier,
+        nullptr,
+        nullptr
+    );
+}
+
 void CVulkanRenderer::_CreateDescriptorPool() {
-    std::array<vk::DescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = vk::DescriptorType::eUniformBuffer;
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    poolSizes[1].type = vk::DescriptorType::eStorageBuffer;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * 2;
+    // Sized from the reflected layouts of every pipeline created so far, see _ReserveDescriptorSets
+    std::vector<vk::DescriptorPoolSize> poolSizes = m_descriptorPoolSizes;
+    for (vk::DescriptorPoolSize& size : poolSizes) {
+        size.descriptorCount *= m_framesInFlight;
+    }
 
     vk::DescriptorPoolCreateInfo poolInfo {};
-    poolInfo.poolSizeCount = 2;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    poolInfo.maxSets = m_descriptorPoolMaxSets * m_framesInFlight;
 
     m_descriptorPool = m_device.createDescriptorPool(poolInfo);
 }
 
 void CVulkanRenderer::_CreateDescriptorSets() {
-    std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, m_descriptorSetLayout);
+    std::vector<vk::DescriptorSetLayout> layouts(m_framesInFlight, m_descriptorSetLayout);
 
     vk::DescriptorSetAllocateInfo allocInfo {};
     allocInfo.descriptorPool = m_descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    allocInfo.descriptorSetCount = m_framesInFlight;
     allocInfo.pSetLayouts = layouts.data();
 
-    m_descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+    m_descriptorSets.resize(m_framesInFlight);
     m_descriptorSets = m_device.allocateDescriptorSets(allocInfo);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < m_framesInFlight; i++) {
+        _WriteDescriptorSet(i);
+    }
+}
+
+void CVulkanRenderer::_WriteDescriptorSet(const std::size_t i) {
+    {
         vk::DescriptorBufferInfo bufferInfo{};
         bufferInfo.buffer = m_uniformBuffers[i].buffer;
         bufferInfo.offset = 0;
@@ -1473,241 +2096,329 @@ CVulkanRenderer::CImage CVulkanRenderer::_CreateImage(
     return result;
 }
 
-void CVulkanRenderer::_TransitionImageLayout(
-    vk::Image image,
-    vk::Format format,
-    vk::ImageLayout oldLayout,
-    vk::ImageLayout newLayout,
-    uint32_t mipLevels
-) {
-    (void)format;
-    vk::CommandBuffer commandBuffer = _BeginSingleTimeCommands();
-
-    vk::ImageMemoryBarrier barrier {};
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = vk::QueueFamilyIgnored;
-    barrier.dstQueueFamilyIndex = vk::QueueFamilyIgnored;
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = mipLevels;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-
-    vk::PipelineStageFlags sourceStage {};
-    vk::PipelineStageFlags destinationStage {};
-
-    if (
-        oldLayout == vk::ImageLayout::eUndefined &&
-        newLayout == vk::ImageLayout::eTransferDstOptimal
-    ) {
-        barrier.srcAccessMask = {};
-        barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-
-        sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
-        destinationStage = vk::PipelineStageFlagBits::eTransfer;
-    } else if (
-        oldLayout == vk::ImageLayout::eTransferDstOptimal &&
-        newLayout == vk::ImageLayout::eShaderReadOnlyOptimal
-    ) {
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+void CVulkanRenderer::_CreateTextureImage() {
+    // File was read straight into the staging buffer, the copy regions point into it
+    const Texture::CCookedTexture texture = m_textureLoads[0].Take();
+    const uint64_t dataOffset = m_stagedTextures[0].offset + texture.GetDataOffset();
+
+    m_mipLevels = static_cast<uint32_t>(texture.GetLevels().size());
+    m_textureFormat = GetTextureFormat(texture.GetFormat());
+
+    const vk::FormatFeatureFlags requiredFeatures = vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eTransferDst;
+    if ((Texture::IsBlockCompressedFormat(texture.GetFormat()) && !m_textureCompressionBC) ||
+        (m_physicalDevice.getFormatProperties(m_textureFormat).optimalTilingFeatures & requiredFeatures) != requiredFeatures) {
+        throw std::runtime_error(std::format(
+            "Texture format {} is not supported by the GPU, cook it with -format rgba8!",
+            Texture::GetTextureFormatName(texture.GetFormat())
+        ));
+    }
 
-        sourceStage = vk::PipelineStageFlagBits::eTransfer;
-        destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
+    m_textureWidth = texture.GetWidth();
+    m_textureHeight = texture.GetHeight();
+    if (m_textureStreaming) {
+        _CreateStreamedTextureImage(texture, dataOffset);
     } else {
-        throw std::invalid_argument("unsupported layout transition!");
+        _UploadTextureImage(texture, dataOffset);
     }
 
-    commandBuffer.pipelineBarrier(
-        sourceStage, destinationStage,
-        {},
-        0, nullptr,
-        0, nullptr,
-        1, &barrier
-    );
-
-    _EndSingleTimeCommands(commandBuffer);
+    _DestroyTextureStaging();
 }
 
-void CVulkanRenderer::_CopyBufferToImage(
-    vk::Buffer buffer,
-    vk::Image image,
-    uint32_t width,
-    uint32_t height
-) {
-    vk::CommandBuffer commandBuffer = _BeginSingleTimeCommands();
+void CVulkanRenderer::_UploadTextureImage(const Texture::CCookedTexture& texture, const uint64_t dataOffset) {
+    std::vector<vk::BufferImageCopy> regions;
+    regions.reserve(m_mipLevels);
+    for (const Texture::CCookedTextureLevel& level : texture.GetLevels()) {
+        vk::BufferImageCopy region {};
+        region.bufferOffset = dataOffset + level.offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+
+        region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+        region.imageSubresource.mipLevel = static_cast<uint32_t>(regions.size());
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+
+        region.imageOffset = vk::Offset3D { 0, 0, 0 };
+        region.imageExtent = vk::Extent3D { level.width, level.height, 1 };
+        regions.push_back(region);
+    }
 
-    vk::BufferImageCopy region {};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
+    m_textureImage = _CreateImage(
+        texture.GetWidth(),
+        texture.GetHeight(),
+        m_mipLevels,
+        vk::SampleCountFlagBits::e1,
+        m_textureFormat,
+        vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
 
-    region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
+    m_uploads.CopyBufferToImage(m_textureStagingBuffer.buffer, m_textureImage.image, GetTextureRange(0, m_mipLevels), regions);
+}
 
-    region.imageOffset = vk::Offset3D {0, 0, 0};
-    region.imageExtent = vk::Extent3D {
-        width,
-        height,
-        1
-    };
+void CVulkanRenderer::_CreateStreamedTextureImage(const Texture::CCookedTexture& texture, const uint64_t dataOffset) {
+    vk::ImageCreateInfo imageInfo {};
+    imageInfo.flags = vk::ImageCreateFlagBits::eSparseBinding | vk::ImageCreateFlagBits::eSparseResidency;
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.extent = vk::Extent3D { m_textureWidth, m_textureHeight, 1 };
+    imageInfo.mipLevels = m_mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = m_textureFormat;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+    imageInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    imageInfo.sharingMode = vk::SharingMode::eExclusive;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    m_textureImage.image = m_device.createImage(imageInfo);
+
+    const vk::MemoryRequirements memoryRequirements = m_device.getImageMemoryRequirements(m_textureImage.image);
+    const std::vector<vk::SparseImageMemoryRequirements> sparseRequirements =
+        m_device.getImageSparseMemoryRequirements(m_textureImage.image);
+    const auto colorRequirements = std::find_if(
+        sparseRequirements.begin(),
+        sparseRequirements.end(),
+        [](const vk::SparseImageMemoryRequirements& requirements) {
+            return static_cast<bool>(requirements.formatProperties.aspectMask & vk::ImageAspectFlagBits::eColor);
+        }
+    );
+    if (colorRequirements == sparseRequirements.end()) {
+        throw std::runtime_error("Streamed texture has no sparse color aspect!");
+    }
 
-    commandBuffer.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, 1, &region);
+    m_textureBlockSize = memoryRequirements.alignment;
+    m_textureBlockExtent = colorRequirements->formatProperties.imageGranularity;
+    m_textureMemoryTypeBits = memoryRequirements.memoryTypeBits;
+    m_textureLevelMemory.resize(m_mipLevels);
 
-    _EndSingleTimeCommands(commandBuffer);
-}
+    // Levels smaller than a sparse block are packed into the mip tail, which can only be bound as a whole.
+    // It and anything coarser that still has its own blocks stay resident, so there is always a level to sample.
+    const uint32_t mipTailFirstLod = std::min(colorRequirements->imageMipTailFirstLod, m_mipLevels);
+    const uint32_t tailLevel = std::min(mipTailFirstLod, m_mipLevels - 1);
 
-void CVulkanRenderer::_GenerateMipMaps(vk::Image image, vk::Format format, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
-    vk::FormatProperties formatProperties = m_physicalDevice.getFormatProperties(format);
+    std::vector<uint64_t> levelSizes(m_mipLevels);
+    for (uint32_t level = 0; level < mipTailFirstLod; ++level) {
+        const Texture::CCookedTextureLevel& source = texture.GetLevels()[level];
+        levelSizes[level] = GetSparseLevelSize({ source.width, source.height, 1 }, m_textureBlockExtent, m_textureBlockSize);
+    }
+    for (uint32_t level = tailLevel; level < mipTailFirstLod; ++level) {
+        _BindTextureLevel(level, true);
+    }
 
-    if (!(formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear)) {
-        throw std::runtime_error("texture image format does not support linear blitting!");
+    if (mipTailFirstLod < m_mipLevels) {
+        levelSizes[mipTailFirstLod] = colorRequirements->imageMipTailSize;
+
+        vma::AllocationCreateInfo allocInfo {};
+        allocInfo.requiredFlags = vk::MemoryPropertyFlagBits::eDeviceLocal;
+        vk::MemoryRequirements tailRequirements {};
+        tailRequirements.size = colorRequirements->imageMipTailSize;
+        tailRequirements.alignment = m_textureBlockSize;
+        tailRequirements.memoryTypeBits = m_textureMemoryTypeBits;
+        m_textureTailMemory = m_allocator.allocateMemory(tailRequirements, allocInfo);
+        const vma::AllocationInfo tailInfo = m_allocator.getAllocationInfo(m_textureTailMemory);
+
+        vk::SparseMemoryBind tailBind {};
+        tailBind.resourceOffset = colorRequirements->imageMipTailOffset;
+        tailBind.size = colorRequirements->imageMipTailSize;
+        tailBind.memory = tailInfo.deviceMemory;
+        tailBind.memoryOffset = tailInfo.offset;
+
+        vk::SparseImageOpaqueMemoryBindInfo tailBindInfo {};
+        tailBindInfo.image = m_textureImage.image;
+        tailBindInfo.bindCount = 1;
+        tailBindInfo.pBinds = &tailBind;
+
+        vk::BindSparseInfo bindInfo {};
+        bindInfo.imageOpaqueBindCount = 1;
+        bindInfo.pImageOpaqueBinds = &tailBindInfo;
+        BindSparseAndWait(m_device, m_graphicsQueue, bindInfo);
     }
 
-    vk::CommandBuffer commandBuffer = _BeginSingleTimeCommands();
+    // Only the resident levels come from the staging buffer, the rest is read from the mapped file when needed
+    std::vector<vk::BufferImageCopy> regions;
+    for (uint32_t level = tailLevel; level < m_mipLevels; ++level) {
+        const Texture::CCookedTextureLevel& source = texture.GetLevels()[level];
+
+        vk::BufferImageCopy region {};
+        region.bufferOffset = dataOffset + source.offset;
+        region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = vk::Offset3D { 0, 0, 0 };
+        region.imageExtent = vk::Extent3D { source.width, source.height, 1 };
+        regions.push_back(region);
+    }
 
-    vk::ImageMemoryBarrier barrier {};
-    barrier.image = image;
-    barrier.srcQueueFamilyIndex = vk::QueueFamilyIgnored;
-    barrier.dstQueueFamilyIndex = vk::QueueFamilyIgnored;
-    barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.subresourceRange.levelCount = 1;
+    // Unbound levels are transitioned as well, every level is then in the layout the sampler expects
+    m_uploads.CopyBufferToImage(m_textureStagingBuffer.buffer, m_textureImage.image, GetTextureRange(0, m_mipLevels), regions);
 
-    int32_t mipWidth = texWidth;
-    int32_t mipHeight = texHeight;
+    uint64_t budgetMegabytes = DEFAULT_TEXTURE_BUDGET_MB;
+    if (const int budgetParam = CommandLine()->FindParam("-texture_budget")) {
+        const std::string_view budget = CommandLine()->GetParam(budgetParam + 1);
+        std::from_chars(budget.data(), budget.data() + budget.size(), budgetMegabytes);
+    }
 
-    for (uint32_t i = 1; i < mipLevels; i++) {
-        barrier.subresourceRange.baseMipLevel = i - 1;
-        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-        barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-        barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+    // Evicted mips may still be sampled by the frames in flight, as many as any present policy allows
+    m_textureStreamer.emplace(budgetMegabytes * 1024 * 1024, MAX_FRAMES_IN_FLIGHT);
+    m_streamedTexture = m_textureStreamer->Register(levelSizes, tailLevel);
 
-        commandBuffer.pipelineBarrier(
-            vk::PipelineStageFlagBits::eTransfer,
-            vk::PipelineStageFlagBits::eTransfer,
-            vk::DependencyFlags {},
-            0, nullptr,
-            0, nullptr,
-            1, &barrier
-        );
+    const std::string& filename = m_stagedTextures[0].filename;
+    if (!m_streamedTextureFile.Load(filename)) {
+        throw std::runtime_error(std::format("Failed to map \"{}\" for streaming!", filename));
+    }
+}
 
-        vk::ImageBlit blit {};
-        blit.srcOffsets[0] = vk::Offset3D { 0, 0, 0 };
-        blit.srcOffsets[1] = vk::Offset3D { mipWidth, mipHeight, 1 };
-        blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        blit.srcSubresource.mipLevel = i - 1;
-        blit.srcSubresource.baseArrayLayer = 0;
-        blit.srcSubresource.layerCount = 1;
-        blit.dstOffsets[0] = vk::Offset3D { 0, 0, 0 };
-        blit.dstOffsets[1] = vk::Offset3D { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
-        blit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-        blit.dstSubresource.mipLevel = i;
-        blit.dstSubresource.baseArrayLayer = 0;
-        blit.dstSubresource.layerCount = 1;
-
-        commandBuffer.blitImage(
-            image, vk::ImageLayout::eTransferSrcOptimal,
-            image, vk::ImageLayout::eTransferDstOptimal,
-            1, &blit,
-            vk::Filter::eLinear
-        );
+void CVulkanRenderer::_BindTextureLevel(const uint32_t level, const bool bind) {
+    vk::SparseImageMemoryBind imageBind {};
+    imageBind.subresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    imageBind.subresource.mipLevel = level;
+    imageBind.subresource.arrayLayer = 0;
+    imageBind.offset = vk::Offset3D { 0, 0, 0 };
+    // Extent may end at the edge of the level instead of a block boundary
+    imageBind.extent = vk::Extent3D { std::max(m_textureWidth >> level, 1u), std::max(m_textureHeight >> level, 1u), 1 };
+
+    if (bind) {
+        vma::AllocationCreateInfo allocInfo {};
+        allocInfo.requiredFlags = vk::MemoryPropertyFlagBits::eDeviceLocal;
+        vk::MemoryRequirements requirements {};
+        requirements.size = GetSparseLevelSize(imageBind.extent, m_textureBlockExtent, m_textureBlockSize);
+        requirements.alignment = m_textureBlockSize;
+        requirements.memoryTypeBits = m_textureMemoryTypeBits;
+        m_textureLevelMemory[level] = m_allocator.allocateMemory(requirements, allocInfo);
+
+        const vma::AllocationInfo info = m_allocator.getAllocationInfo(m_textureLevelMemory[level]);
+        imageBind.memory = info.deviceMemory;
+        imageBind.memoryOffset = info.offset;
+    }
 
-        barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
-        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
-        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    vk::SparseImageMemoryBindInfo imageBindInfo {};
+    imageBindInfo.image = m_textureImage.image;
+    imageBindInfo.bindCount = 1;
+    imageBindInfo.pBinds = &imageBind;
 
-        commandBuffer.pipelineBarrier(
-            vk::PipelineStageFlagBits::eTransfer,
-            vk::PipelineStageFlagBits::eFragmentShader,
-            vk::DependencyFlags {}, 0, nullptr,
-            0, nullptr, 1,
-            &barrier
-        );
+    vk::BindSparseInfo bindInfo {};
+    bindInfo.imageBindCount = 1;
+    bindInfo.pImageBinds = &imageBindInfo;
+    BindSparseAndWait(m_device, m_graphicsQueue, bindInfo);
 
-        if (mipWidth > 1)
-            mipWidth /= 2;
-        if (mipHeight > 1)
-            mipHeight /= 2;
+    if (!bind) {
+        m_allocator.freeMemory(m_textureLevelMemory[level]);
+        m_textureLevelMemory[level] = {};
     }
+}
 
-    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+void CVulkanRenderer::_UploadTextureLevel(const CTextureLevelUpload& upload) {
+    const uint32_t level = upload.level.level;
+    _BindTextureLevel(level, true);
 
-    commandBuffer.pipelineBarrier(
-        vk::PipelineStageFlagBits::eTransfer,
-        vk::PipelineStageFlagBits::eFragmentShader,
-        vk::DependencyFlags {}, 0, nullptr,
-        0, nullptr, 1,
-        &barrier
-    );
+    vk::BufferImageCopy region {};
+    region.bufferOffset = 0;
+    region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    region.imageSubresource.mipLevel = level;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = vk::Offset3D { 0, 0, 0 };
+    region.imageExtent = vk::Extent3D { std::max(m_textureWidth >> level, 1u), std::max(m_textureHeight >> level, 1u), 1 };
 
-    _EndSingleTimeCommands(commandBuffer);
+    // Contents of a freshly bound level are undefined, nothing to preserve
+    m_uploads.CopyBufferToImage(upload.staging.buffer, m_textureImage.image, GetTextureRange(level, 1), { &region, 1 });
 }
 
-void CVulkanRenderer::_CreateTextureImage() {
-    int texWidth = 0, texHeight = 0, texChannels = 0;
-    stbi_uc* pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    if (!pixels) {
-        throw std::runtime_error("failed to load texture image!");
+void CVulkanRenderer::_UpdateTextureStreaming() {
+    if (!m_textureStreaming) {
+        return;
     }
 
-    m_mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-
-    vk::DeviceSize imageSize = texWidth * texHeight * 4;
-
-    CBuffer stagingBuffer = _CreateBuffer(
-        imageSize,
-        vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-        vma::AllocationCreateFlagBits::eHostAccessRandom
+    // Stands in for sampler feedback: the model's bounding sphere projected with the current camera
+    const uint32_t wantedLevel = Texture::SelectTextureLevel(
+        m_textureWidth,
+        m_textureHeight,
+        m_mipLevels,
+        m_model.GetBoundingSphere(),
+        g_camera.m_position,
+        g_camera.m_fov,
+        m_currentSwapchainExtent.height
     );
+    m_textureStreamer->RequestLevel(m_streamedTexture, wantedLevel, m_submittedFrame + 1);
 
-    void* data = m_allocator.mapMemory(stagingBuffer.allocation);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-    m_allocator.unmapMemory(stagingBuffer.allocation);
+    // Uploads are flushed ahead of this frame's graphics submission, so a level is sampleable as soon as
+    // OnLevelLoaded lowers minLod
+    std::erase_if(m_textureUploads, [&](CTextureLevelUpload& upload) {
+        if (!upload.load.IsReady()) {
+            return false;
+        }
+        upload.load.Get();
+        _UploadTextureLevel(upload);
+        m_textureStreamer->OnLevelLoaded(upload.level.texture, upload.level.level);
+
+        m_uploads.ReleaseAfterUpload([this, staging = upload.staging] {
+            m_allocator.unmapMemory(staging.allocation);
+            m_allocator.destroyBuffer(staging.buffer, staging.allocation);
+        });
+        return true;
+    });
+
+    std::vector<Texture::CStreamingRequest> loads;
+    std::vector<Texture::CStreamingRequest> releases;
+    m_textureStreamer->Update(m_submittedFrame + 1, MAX_TEXTURE_LOADS_PER_FRAME, loads, releases);
+
+    // Sparse binding isn't ordered with the copies, a level loaded a moment ago may still be written to.
+    // Only stalls if it was, uploads from the frames the eviction delay covers are long done.
+    if (!releases.empty()) {
+        m_uploads.Wait(m_uploads.Flush());
+    }
+    for (const Texture::CStreamingRequest& release : releases) {
+        _BindTextureLevel(release.level, false);
+    }
 
-    stbi_image_free(pixels);
+    for (const Texture::CStreamingRequest& load : loads) {
+        const std::span<const std::byte> data =
+            m_streamedTextureFile.GetLevelData(m_streamedTextureFile.GetLevels()[load.level]);
 
-    m_textureImage = _CreateImage(
-        texWidth,
-        texHeight,
-        m_mipLevels,
-        vk::SampleCountFlagBits::e1,
-        vk::Format::eR8G8B8A8Srgb,
-        vk::ImageTiling::eOptimal,
-        vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-        vk::MemoryPropertyFlagBits::eDeviceLocal
-    );
+        CTextureLevelUpload upload {};
+        upload.level = load;
+        upload.staging = _CreateBuffer(
+            data.size(),
+            vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            vma::AllocationCreateFlagBits::eHostAccessSequentialWrite
+        );
+        void* staging = m_allocator.mapMemory(upload.staging.allocation);
 
-    _TransitionImageLayout(
-        m_textureImage.image,
-        vk::Format::eR8G8B8A8Srgb,
-        vk::ImageLayout::eUndefined,
-        vk::ImageLayout::eTransferDstOptimal,
-        m_mipLevels
-    );
+        // Pages of the mapped file fault in on the I/O thread, the frame never waits on the disk
+        upload.load = AsyncLoader()->Submit(ELoadPriority::Background, [data, staging] {
+            std::memcpy(staging, data.data(), data.size());
+            return true;
+        });
+        m_textureUploads.push_back(std::move(upload));
+    }
+}
 
-    _CopyBufferToImage(
-        stagingBuffer.buffer,
-        m_textureImage.image,
-        static_cast<uint32_t>(texWidth),
-        static_cast<uint32_t>(texHeight)
-    );
+void CVulkanRenderer::_CancelTextureUploads() {
+    for (CTextureLevelUpload& upload : m_textureUploads) {
+        // A read that has already started still writes into the staging buffer
+        if (!upload.load.Cancel()) {
+            upload.load.Get();
+        }
+        m_allocator.unmapMemory(upload.staging.allocation);
+        m_allocator.destroyBuffer(upload.staging.buffer, upload.staging.allocation);
+    }
+    m_textureUploads.clear();
+}
 
-    _GenerateMipMaps(m_textureImage.image, vk::Format::eR8G8B8A8Srgb, texWidth, texHeight, m_mipLevels);
+void CVulkanRenderer::_DestroyStreamedTexture() {
+    _CancelTextureUploads();
 
-    m_allocator.destroyBuffer(stagingBuffer.buffer, stagingBuffer.allocation);
+    m_device.destroyImage(m_textureImage.image);
+    for (vma::Allocation allocation : m_textureLevelMemory) {
+        if (allocation) {
+            m_allocator.freeMemory(allocation);
+        }
+    }
+    if (m_textureTailMemory) {
+        m_allocator.freeMemory(m_textureTailMemory);
+    }
 }
 
 void CVulkanRenderer::_CreateTextureImageView(vk::Format format) {
@@ -1730,48 +2441,122 @@ void CVulkanRenderer::_CreateTextureSampler() {
     samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
     samplerInfo.mipLodBias = 0.0f;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = static_cast<float>(m_mipLevels);
+    // A reloaded texture may have more mips
+    samplerInfo.maxLod = vk::LodClampNone;
 
     m_textureSampler = m_device.createSampler(samplerInfo);
 }
 
 void CVulkanRenderer::_CreateSyncObjects() {
-    m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    m_computeInFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    m_computeFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+    m_imageAvailableSemaphores.resize(m_framesInFlight);
+    m_renderFinishedSemaphores.resize(m_framesInFlight);
 
-    for (std::size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+    // The swapchain only takes binary semaphores
+    for (std::size_t i = 0; i < m_framesInFlight; ++i) {
         m_imageAvailableSemaphores[i] = m_device.createSemaphore(vk::SemaphoreCreateInfo {});
         m_renderFinishedSemaphores[i] = m_device.createSemaphore(vk::SemaphoreCreateInfo {});
-        m_inFlightFences[i] = m_device.createFence(vk::FenceCreateInfo { vk::FenceCreateFlagBits::eSignaled });
-        m_computeFinishedSemaphores[i] = m_device.createSemaphore(vk::SemaphoreCreateInfo {});
-        m_computeInFlightFences[i] = m_device.createFence(vk::FenceCreateInfo { vk::FenceCreateFlagBits::eSignaled });
     }
 }
 
-void CVulkanRenderer::Draw() {
-    vk::SubmitInfo submitInfo{};
+void CVulkanRenderer::_CreateFrameTimelines() {
+    vk::SemaphoreTypeCreateInfo timelineType {};
+    timelineType.semaphoreType = vk::SemaphoreType::eTimeline;
+    timelineType.initialValue = 0;
 
-    // Compute submission
-    std::ignore = m_device.waitForFences(m_computeInFlightFences[m_currentFrame], vk::True, UINT64_MAX);
+    vk::SemaphoreCreateInfo timelineInfo {};
+    timelineInfo.pNext = &timelineType;
+    m_graphicsTimeline = m_device.createSemaphore(timelineInfo);
+    m_computeTimeline = m_device.createSemaphore(timelineInfo);
+}
 
-    UpdateUniformBuffer(m_currentFrame, m_currentSwapchainExtent);
+void CVulkanRenderer::_CreateFrameResources() {
+    _CreateCommandBuffers();
+    _CreateComputeCommandBuffers();
 
-    m_device.resetFences(m_computeInFlightFences[m_currentFrame]);
+    _CreateShaderStorageBuffers();
+    _CreateUniformBuffers();
+    if (m_meshletCulling) {
+        _CreateDrawBuffers();
+    }
 
-    m_computeCommandBuffers[m_currentFrame].reset();
-    _RecordComputeCommandBuffer(m_computeCommandBuffers[m_currentFrame]);
+    _CreateDescriptorPool();
+    _CreateDescriptorSets();
+    _CreateComputeDescriptorSets();
+    if (m_meshletCulling) {
+        _CreateMeshletCullDescriptorSets();
+    }
 
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_computeCommandBuffers[m_currentFrame];
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &m_computeFinishedSemaphores[m_currentFrame];
+    _CreateSyncObjects();
+    m_descriptorSetsDirty.assign(m_framesInFlight, false);
+}
+
+void CVulkanRenderer::_DestroyFrameResources() {
+    m_device.freeCommandBuffers(m_commandPool, m_commandBuffers);
+    m_device.freeCommandBuffers(m_computeCommandPool, m_computeCommandBuffers);
+
+    for (std::size_t i = 0; i < m_framesInFlight; i++) {
+        m_allocator.destroyBuffer(m_shaderStorageBuffers[i].buffer, m_shaderStorageBuffers[i].allocation);
+        m_allocator.unmapMemory(m_uniformBuffers[i].allocation);
+        m_allocator.destroyBuffer(m_uniformBuffers[i].buffer, m_uniformBuffers[i].allocation);
+        if (m_meshletCulling) {
+            m_allocator.destroyBuffer(m_drawCommandBuffers[i].buffer, m_drawCommandBuffers[i].allocation);
+            m_allocator.destroyBuffer(m_drawCountBuffers[i].buffer, m_drawCountBuffers[i].allocation);
+        }
+        m_device.destroySemaphore(m_imageAvailableSemaphores[i]);
+        m_device.destroySemaphore(m_renderFinishedSemaphores[i]);
+    }
+
+    // Frees every set allocated from it
+    m_device.destroyDescriptorPool(m_descriptorPool);
+    m_descriptorPool = nullptr;
+
+    m_commandBuffers.clear();
+    m_computeCommandBuffers.clear();
+    m_shaderStorageBuffers.clear();
+    m_uniformBuffers.clear();
+    m_uniformBuffersData.clear();
+    m_drawCommandBuffers.clear();
+    m_drawCountBuffers.clear();
+    m_descriptorSets.clear();
+    m_computeDescriptorSets.clear();
+    m_meshletCullDescriptorSets.clear();
+    m_imageAvailableSemaphores.clear();
+    m_renderFinishedSemaphores.clear();
+}
+
+uint64_t CVulkanRenderer::GetCompletedFrame() const {
+    // A frame's graphics work waits for its compute work, so the graphics timeline covers both queues
+    return m_device.getSemaphoreCounterValue(m_graphicsTimeline);
+}
+
+void CVulkanRenderer::_WaitForFrame(const uint64_t frame) const {
+    vk::SemaphoreWaitInfo waitInfo {};
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_graphicsTimeline;
+    waitInfo.pValues = &frame;
+    std::ignore = m_device.waitSemaphores(waitInfo, UINT64_MAX);
+}
+
+void CVulkanRenderer::Draw() {
+    if (m_requestedPresentPolicy != m_presentPolicy) {
+        _ApplyPresentPolicy();
+    }
 
-    m_computeQueue.submit(submitInfo, m_computeInFlightFences[m_currentFrame]);
+    // Reuses the command buffers, uniforms and descriptor sets of the frame m_framesInFlight back, that frame is
+    // the only one the CPU waits for
+    const uint64_t frame = m_submittedFrame + 1;
+    if (frame > m_framesInFlight) {
+        _WaitForFrame(frame - m_framesInFlight);
+    }
+    m_currentFrame = static_cast<uint32_t>(frame % m_framesInFlight);
 
-    std::ignore = m_device.waitForFences(m_inFlightFences[m_currentFrame], vk::True, std::numeric_limits<unsigned int>::max());
+    _FlushDeferredDestruction(false);
+    m_uploads.Update();
+    _ApplyHotReloads();
+    _ApplyShaderReloads();
+
+    _UpdateTextureStreaming();
+    UpdateUniformBuffer(m_currentFrame, m_currentSwapchainExtent);
 
     uint32_t imageIndex;
     vk::Result res = m_device.acquireNextImageKHR(
@@ -1782,12 +2567,50 @@ void CVulkanRenderer::Draw() {
         &imageIndex
     );
 
+    // Nothing was submitted, the next call records the same frame again
     if (res == vk::Result::eErrorOutOfDateKHR) {
         _RecreateSwapchain();
         return;
     }
 
-    m_device.resetFences(m_inFlightFences[m_currentFrame]);
+    // Everything uploaded this frame goes out in one batch, ahead of the submissions that read it
+    m_uploads.Flush();
+
+    // With a dedicated compute family the simulation only waits for the particle handoff, it overlaps the
+    // rendering of the previous frame. The graphics submission below waits for it before vertex input.
+    vk::Semaphore particleHandoff {};
+    if (m_particleHandoffPending) {
+        particleHandoff = _ReleaseParticleBuffers();
+        m_particleHandoffPending = false;
+    }
+
+    m_computeCommandBuffers[m_currentFrame].reset();
+    _RecordComputeCommandBuffer(m_computeCommandBuffers[m_currentFrame], particleHandoff != nullptr);
+
+    const uint64_t particleHandoffValue = 0;
+    const vk::PipelineStageFlags particleHandoffStage = vk::PipelineStageFlagBits::eComputeShader;
+
+    vk::TimelineSemaphoreSubmitInfo computeTimelineInfo {};
+    computeTimelineInfo.signalSemaphoreValueCount = 1;
+    computeTimelineInfo.pSignalSemaphoreValues = &frame;
+
+    vk::SubmitInfo submitInfo {};
+    submitInfo.pNext = &computeTimelineInfo;
+    if (particleHandoff) {
+        computeTimelineInfo.waitSemaphoreValueCount = 1;
+        computeTimelineInfo.pWaitSemaphoreValues = &particleHandoffValue;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &particleHandoff;
+        submitInfo.pWaitDstStageMask = &particleHandoffStage;
+    }
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_computeCommandBuffers[m_currentFrame];
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_computeTimeline;
+
+    m_computeQueue.submit(submitInfo);
+
+    _RefreshDescriptorSets();
 
     m_commandBuffers[m_currentFrame].reset();
 
@@ -1795,6 +2618,10 @@ void CVulkanRenderer::Draw() {
     beginInfo.pInheritanceInfo = nullptr;
     m_commandBuffers[m_currentFrame].begin(beginInfo);
 
+    if (m_meshletCulling) {
+        _RecordMeshletCulling(m_commandBuffers[m_currentFrame]);
+    }
+
     vk::RenderPassBeginInfo renderPassInfo {};
     renderPassInfo.renderPass = m_renderPass;
     renderPassInfo.framebuffer = m_frameBuffers[imageIndex];
@@ -1814,7 +2641,11 @@ void CVulkanRenderer::Draw() {
     vk::Buffer vertexBuffers[] = { m_vertexBuffer.buffer };
     VkDeviceSize offsets[] = { 0 };
     m_commandBuffers[m_currentFrame].bindVertexBuffers(0, 1, vertexBuffers, offsets);
-    m_commandBuffers[m_currentFrame].bindIndexBuffer(m_indexBuffer.buffer, 0, vk::IndexType::eUint32);
+    m_commandBuffers[m_currentFrame].bindIndexBuffer(
+        m_indexBuffer.buffer,
+        0,
+        m_model.GetIndexFormat() == Mesh::EIndexFormat::Uint16 ? vk::IndexType::eUint16 : vk::IndexType::eUint32
+    );
 
     vk::Viewport viewport {};
     viewport.x = 0.0f;
@@ -1830,44 +2661,76 @@ void CVulkanRenderer::Draw() {
     scissor.extent = m_currentSwapchainExtent;
     m_commandBuffers[m_currentFrame].setScissor(0, scissor);
 
-    /*m_commandBuffers[m_currentFrame].bindDescriptorSets(
-        vk::PipelineBindPoint::eCompute,
+    m_commandBuffers[m_currentFrame].bindDescriptorSets(
+        vk::PipelineBindPoint::eGraphics,
         m_pipelineLayout,
         0,
         1,
-        &m_computeDescriptorSets[m_currentFrame],
+        &m_descriptorSets[m_currentFrame],
         0,
         nullptr
-    );*/
-    m_commandBuffers[m_currentFrame].drawIndexed(
-        static_cast<uint32_t>(m_indices.size()),
-        1, 0, 0, 0
     );
+    const Mesh::CMeshLod& lod = m_model.GetLods()[m_modelLod];
+    if (m_meshletCulling) {
+        // One draw per visible meshlet, written by the culling pass
+        m_commandBuffers[m_currentFrame].drawIndexedIndirectCount(
+            m_drawCommandBuffers[m_currentFrame].buffer,
+            0,
+            m_drawCountBuffers[m_currentFrame].buffer,
+            0,
+            m_meshletCullConstants.meshletCount,
+            sizeof(Vulkan::CDrawIndexedIndirectCommand)
+        );
+    } else {
+        // Meshes too big for 16-bit indices are split, every submesh addresses its own vertex range
+        for (const Mesh::CSubmesh& submesh : m_model.GetLodSubmeshes(lod)) {
+            m_commandBuffers[m_currentFrame].drawIndexed(
+                submesh.indexCount,
+                1,
+                submesh.firstIndex,
+                submesh.vertexOffset,
+                0
+            );
+        }
+    }
 
     m_commandBuffers[m_currentFrame].endRenderPass();
     m_commandBuffers[m_currentFrame].end();
 
-    m_device.resetFences(m_inFlightFences[m_currentFrame]);
-
-    submitInfo = 0;
-
-    vk::Semaphore waitSemaphores[] = {
-        m_computeFinishedSemaphores[m_currentFrame],
+    // Binary semaphores ignore their values, they only fill the slots
+    const std::array<vk::Semaphore, 2> waitSemaphores = {
+        m_computeTimeline,
         m_imageAvailableSemaphores[m_currentFrame]
     };
-    vk::PipelineStageFlags waitStages[] = {
-        vk::PipelineStageFlagBits::eVertexInput,
-        vk::PipelineStageFlagBits::eColorAttachmentOutput
+    const std::array<uint64_t, 2> waitValues = { frame, 0 };
+    const std::array<vk::PipelineStageFlags, 2> waitStages = {
+        vk::PipelineStageFlags(vk::PipelineStageFlagBits::eVertexInput),
+        vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+    };
+    const std::array<vk::Semaphore, 2> signalSemaphores = {
+        m_graphicsTimeline,
+        m_renderFinishedSemaphores[m_currentFrame]
     };
-    submitInfo.waitSemaphoreCount = 2;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    const std::array<uint64_t, 2> signalValues = { frame, 0 };
+
+    vk::TimelineSemaphoreSubmitInfo timelineInfo {};
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+    submitInfo = vk::SubmitInfo {};
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &m_commandBuffers[m_currentFrame];
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &m_renderFinishedSemaphores[m_currentFrame];
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
 
-    m_graphicsQueue.submit(submitInfo, m_inFlightFences[m_currentFrame]);
+    m_graphicsQueue.submit(submitInfo);
+    m_submittedFrame = frame;
 
     vk::PresentInfoKHR presentInfo {};
     presentInfo.waitSemaphoreCount = 1;
@@ -1883,15 +2746,33 @@ void CVulkanRenderer::Draw() {
         m_frameBufferResized = false;
         _RecreateSwapchain();
     }
-    m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
 void CVulkanRenderer::UpdateUniformBuffer(uint32_t currentImage, vk::Extent2D swapChainExtent) {
     CUniformBufferObject ubo {};
-    ubo.model = glm::mat4(1.0f);
+    // Quantized positions are expanded to mesh space by the model matrix
+    ubo.model = Mesh::GetDequantizationMatrix(m_model.GetQuantization());
+    ubo.texCoordTransform = Mesh::GetTexCoordTransform(m_model.GetQuantization());
+    ubo.textureMinLod = m_textureStreaming ? static_cast<float>(m_textureStreamer->GetMinLod(m_streamedTexture)) : 0.0f;
     ubo.view = g_camera.GetViewMatrix();
     ubo.proj = glm::perspective(glm::radians(g_camera.m_fov), swapChainExtent.width / (float)swapChainExtent.height, 0.01f, 50.0f);
     ubo.proj[1][1] *= -1;
     memcpy(m_uniformBuffersData[currentImage], &ubo, sizeof(ubo));
+
+    // Bounds and LOD errors are in mesh space, which is the world space as long as the model has no transform of its own
+    m_modelLod = Mesh::SelectLod(
+        m_model.GetLods(),
+        m_model.GetBoundingSphere(),
+        g_camera.m_position,
+        g_camera.m_fov,
+        swapChainExtent.height
+    );
+
+    const Mesh::CMeshLod& lod = m_model.GetLods()[m_modelLod];
+    m_meshletCullConstants = Vulkan::MakeMeshletCullConstants(
+        ubo.proj * ubo.view,
+        g_camera.m_position,
+        lod.firstMeshlet,
+        lod.meshletCount
+    );
 }
-#endif
@@ -3,85 +3,43 @@
 #include "../renderer.hpp"
 
 #include "instance.hpp"
+#include "vulkan.hpp"
 #include "vulkan_window.hpp"
+#include "meshlet_culling.hpp"
+#include "pipeline_cache.hpp"
+#include "shader_reflection.hpp"
+#include "shader_compiler.hpp"
+#include "upload_manager.hpp"
+#include "../../mesh/cooked_mesh.hpp"
+#include "../../texture/texture_staging.hpp"
+#include "../../texture/texture_streaming.hpp"
+#include "asyncloader.hpp"
+#include "filewatcher.hpp"
 
-class CVulkanRenderer final : public IRenderer
-{
-public:
-    bool Initialize(IWindow* window) override;
-    void Draw() override {}
-
-private:
-    IVulkanWindow* m_window = nullptr;
-
-    Vulkan::CInstance m_instance;
-};
-
-
-#if 0
-#include "renderer.hpp"
-
-#include "../vulkan.hpp"
-#include "../vulkan_window.hpp"
-
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
 #include <glm/glm.hpp>
 #include <vk_mem_alloc.hpp>
 
+#include <array>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <optional>
+#include <span>
 
-struct CVertex {
-    glm::vec3 pos;
-    glm::vec3 color;
-    glm::vec2 texCoord;
-
-    static vk::VertexInputBindingDescription getBindingDescription() {
-        vk::VertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(CVertex);
-        bindingDescription.inputRate = vk::VertexInputRate::eVertex;
-
-        return bindingDescription;
-    }
-
-    static std::array<vk::VertexInputAttributeDescription, 3> getAttributeDescriptions() {
-        std::array<vk::VertexInputAttributeDescription, 3> attributeDescriptions{};
-
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = vk::Format::eR32G32B32Sfloat;
-        attributeDescriptions[0].offset = offsetof(CVertex, pos);
-
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = vk::Format::eR32G32B32Sfloat;
-        attributeDescriptions[1].offset = offsetof(CVertex, color);
-
-        attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = vk::Format::eR32G32Sfloat;
-        attributeDescriptions[2].offset = offsetof(CVertex, texCoord);
-
-        return attributeDescriptions;
-    }
-
-    bool operator==(const CVertex& other) const {
-        return pos == other.pos && color == other.color && texCoord == other.texCoord;
-    }
+// Pipelines built from the shader sources, rebuilt when one of their shaders changes
+enum class EShaderPipeline
+{
+    Graphics,
+    Particles,
+    MeshletCull,
 };
 
-namespace std {
-    template<> struct hash<CVertex> {
-        size_t operator()(CVertex const& vertex) const {
-            return ((hash<glm::vec3>()(vertex.pos) ^
-                   (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                   (hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
-}
+constexpr std::size_t SHADER_PIPELINE_COUNT = 3;
 
 struct Particle {
     glm::vec2 position;
@@ -118,13 +76,17 @@ class CVulkanRenderer final : public IRenderer {
 public:
     CVulkanRenderer() = default;
     CVulkanRenderer(const CVulkanRenderer&) = delete;
-    CVulkanRenderer(CVulkanRenderer&&) = default;
+    CVulkanRenderer(CVulkanRenderer&&) = delete;
     CVulkanRenderer& operator=(const CVulkanRenderer&) = delete;
-    CVulkanRenderer& operator=(CVulkanRenderer&&) = default;
+    CVulkanRenderer& operator=(CVulkanRenderer&&) = delete;
     ~CVulkanRenderer();
 
     bool Initialize(IWindow* window) override;
     void Draw() override;
+    void SetPresentPolicy(EPresentPolicy policy) override;
+
+    // Frames up to this one are done on the GPU, so whatever only they used can be reused or destroyed
+    [[nodiscard]] uint64_t GetCompletedFrame() const;
 
     bool m_frameBufferResized = false;
 
@@ -136,6 +98,12 @@ private:
     {
         std::optional<uint32_t> m_graphicsAndCompute;
         std::optional<uint32_t> m_present;
+        // Family that only does transfers, usually backed by the DMA engines. Uploads fall back to the graphics
+        // queue without one.
+        std::optional<uint32_t> m_transfer;
+        // Family that computes but can't draw, the particle simulation runs there asynchronously to rendering.
+        // Compute falls back to the graphics queue without one.
+        std::optional<uint32_t> m_compute;
 
         bool isComplete() const {
             return m_graphicsAndCompute.has_value() && m_present.has_value();
@@ -158,17 +126,42 @@ private:
         alignas(16) glm::mat4 model;
         alignas(16) glm::mat4 view;
         alignas(16) glm::mat4 proj;
+        alignas(16) glm::vec4 texCoordTransform;
+        // Finest resident mip of the texture, sampling is clamped to it while finer mips stream in
+        alignas(4) float textureMinLod;
     };
 
-    static VKAPI_ATTR vk::Bool32 VKAPI_CALL DebugCallback(
-        vk::DebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-        vk::DebugUtilsMessageTypeFlagBitsEXT messageType,
-        const vk::DebugUtilsMessengerCallbackDataEXT* pCallbackData,
-        void* pUserData
-    );
+    // Finer mip of the streamed texture being read from disk into its own staging buffer
+    struct CTextureLevelUpload
+    {
+        Texture::CStreamingRequest level {};
+        CBuffer staging {};
+        CLoadHandle<bool> load {};
+    };
 
-    void _InitializeInstanceExtensions();
-    void _InitializeInstance();
+    void _StartLoads();
+    // Needs the allocator, textures are read straight into staging memory
+    void _StartTextureLoads(ELoadPriority priority);
+    void _DestroyTextureStaging();
+
+    // Reports changed assets to _ApplyHotReloads
+    void _WatchAssets();
+    // Runs at a frame boundary: starts re-imports of changed assets and swaps in the finished ones
+    void _ApplyHotReloads();
+    // Returns false if the new model can't be drawn by the current pipelines
+    bool _SwapModel(Mesh::CCookedMesh&& model);
+    // Hands the current texture over to deferred destruction
+    void _RetireTexture();
+    // `destroy` runs once no frame in flight can use the resources it destroys
+    void _DeferDestruction(std::function<void()> destroy);
+    // Recompiles the shaders of `pipeline` and builds it again on a loader thread
+    void _StartPipelineRebuild(EShaderPipeline pipeline);
+    // Swaps rebuilt pipelines in at the frame boundary, a shader that fails to compile keeps the old pipeline
+    void _ApplyShaderReloads();
+    void _FlushDeferredDestruction(bool all);
+    void _WaitForFrame(uint64_t frame) const;
+    // Rewrites the sets of the current frame if a reload replaced something they point to
+    void _RefreshDescriptorSets();
 
     void _SetRequiredDeviceExtensions();
     CQueueFamilyIndices _FindQueueFamilies(vk::PhysicalDevice physicalDevice);
@@ -181,7 +174,11 @@ private:
     void _CreateAllocator();
 
     vk::SurfaceFormatKHR _ChooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& formats);
+    // Best mode of the present policy the surface supports, FIFO is always there to fall back to
     vk::PresentModeKHR _ChoosePresentMode(const std::vector<vk::PresentModeKHR>& presentModes);
+    uint32_t _GetFramesInFlight(EPresentPolicy policy) const;
+    // Waits for the GPU, rebuilds the per-frame resources if the frame count changes and recreates the swapchain
+    void _ApplyPresentPolicy();
     vk::Extent2D _ChooseSwapChainExtent();
 
     void _CreateSwapchain();
@@ -192,9 +189,24 @@ private:
 
     void _CreateRenderPass();
 
-    void _CreateDescriptorSetLayout();
-    vk::ShaderModule _CreateShaderModule(const std::vector<char>& byteCode);
+    vk::ShaderModule _CreateShaderModule(std::span<const std::byte> byteCode);
+    // Layout shared by every pipeline with the same resources as the SPIR-V of `stages`
+    const Vulkan::CPipelineLayout& _ReflectPipelineLayout(std::initializer_list<std::span<const std::byte>> stages);
+    // Adds the sets of `layout` to what each frame in flight needs from the descriptor pool
+    void _ReserveDescriptorSets(const Vulkan::CPipelineLayout& layout);
+    // Throws if rebuilt shaders need another layout than the pipeline they replace
+    void _CheckPipelineLayout(std::initializer_list<std::span<const std::byte>> stages, vk::PipelineLayout layout);
     void _CreatePipeline();
+    // Safe to call from any thread once the render pass and pipeline layouts exist
+    vk::Pipeline _BuildPipeline(
+        std::span<const std::byte> vertexCode,
+        std::span<const std::byte> fragmentCode,
+        EVertexFormat vertexFormat,
+        vk::PipelineCache cache
+    );
+    vk::Pipeline _BuildComputePipeline(std::span<const std::byte> code, vk::PipelineLayout layout, vk::PipelineCache cache);
+    // Builds into a cache of its own and merges it into m_pipelineCache, for pipelines built off the main thread
+    vk::Pipeline _BuildInWorkerCache(const std::function<vk::Pipeline(vk::PipelineCache)>& build);
     void _CreateComputePipeline();
 
     void _CreateColorResources();
@@ -215,21 +227,15 @@ private:
         vma::AllocationCreateFlags flags
     );
 
-    vk::CommandBuffer _BeginSingleTimeCommands();
-    void _EndSingleTimeCommands(vk::CommandBuffer commandBuffer);
-
-    void _CopyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size);
-
     void _CreateVertexBuffer();
     void _CreateIndexBuffer();
 
     void _CreateUniformBuffers();
     void _CreateShaderStorageBuffers();
 
-    void _CreateComputeDescriptorSetLayout();
-
     void _CreateDescriptorPool();
     void _CreateDescriptorSets();
+    void _WriteDescriptorSet(std::size_t frame);
 
     void _CreateComputeDescriptorSets();
 
@@ -243,45 +249,73 @@ private:
         vk::ImageUsageFlags usage,
         vk::MemoryPropertyFlags properties
     );
-    void _TransitionImageLayout(
-        vk::Image image,
-        vk::Format format,
-        vk::ImageLayout oldLayout,
-        vk::ImageLayout newLayout,
-        uint32_t mipLevels
-    );
-    void _CopyBufferToImage(
-        vk::Buffer buffer,
-        vk::Image image,
-        uint32_t width,
-        uint32_t height
-    );
-    void _GenerateMipMaps(vk::Image image, vk::Format format, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
     void _CreateTextureImage();
+    void _UploadTextureImage(const Texture::CCookedTexture& texture, uint64_t dataOffset);
+    // Binds the mip tail and uploads only the levels in it, finer levels are streamed by _UpdateTextureStreaming
+    void _CreateStreamedTextureImage(const Texture::CCookedTexture& texture, uint64_t dataOffset);
+    // Binds device memory to a mip of the sparse texture or unbinds and frees it
+    void _BindTextureLevel(uint32_t level, bool bind);
+    void _UploadTextureLevel(const CTextureLevelUpload& upload);
+    // Waits for reads still in flight and frees their staging buffers
+    void _CancelTextureUploads();
+    // Requests mips from the projected size of the model, finishes uploads and starts new ones within the budget
+    void _UpdateTextureStreaming();
+    void _DestroyStreamedTexture();
     void _CreateTextureImageView(vk::Format format);
 
     void _CreateTextureSampler();
 
     void _CreateSyncObjects();
-
-    void _RecordComputeCommandBuffer(vk::CommandBuffer commandBuffer);
+    void _CreateFrameTimelines();
+    // Everything that exists once per frame in flight: command buffers, uniforms, particle and draw buffers,
+    // descriptor sets and swapchain semaphores
+    void _CreateFrameResources();
+    void _DestroyFrameResources();
+
+    // `acquireParticles` records the compute side of the particle buffer handoff, see _ReleaseParticleBuffers
+    void _RecordComputeCommandBuffer(vk::CommandBuffer commandBuffer, bool acquireParticles);
     void _CreateComputeCommandBuffers();
-
-#ifndef NDEBUG
-    bool m_enableValidationLayer = true;
-#else
-    bool m_enableValidationLayer = false;
-#endif
+    // Barriers moving every particle buffer from the graphics family to the compute family, access masks are
+    // left to the caller
+    std::vector<vk::BufferMemoryBarrier> _GetParticleHandoffBarriers() const;
+    // Freshly uploaded particle buffers belong to the graphics family. With a dedicated compute family this
+    // releases them on the graphics queue and returns the semaphore the compute submission has to wait on.
+    vk::Semaphore _ReleaseParticleBuffers();
+
+    void _CreateMeshletCullPipeline();
+    void _CreateMeshletBuffers();
+    // Culling writes the draws every frame, so each frame in flight has its own
+    void _CreateDrawBuffers();
+    void _CreateMeshletCullDescriptorSets();
+    void _WriteMeshletCullDescriptorSet(std::size_t frame);
+    void _RecordMeshletCulling(vk::CommandBuffer commandBuffer);
 
     IVulkanWindow* m_window = nullptr;
 
-    vma::Allocator m_allocator {};
-
-    std::unordered_map<std::string, bool> m_instanceExtensions {}; // bool is a value that means whether extension is required or not
-    std::unordered_set<std::string> m_enabledInstanceExtensions {};
-    vk::Instance m_instance {};
+    // Started by _StartLoads and taken by the code that consumes them
+    CLoadHandle<CMappedFile> m_vertexShaderLoad {};
+    CLoadHandle<CMappedFile> m_fragmentShaderLoad {};
+    CLoadHandle<CMappedFile> m_computeShaderLoad {};
+    CLoadHandle<CMappedFile> m_cullShaderLoad {};
+    CLoadHandle<Mesh::CCookedMesh> m_modelLoad {};
+    CLoadHandle<Texture::CStagedTexture> m_textureCookLoad {};
+    // Started by _StartTextureLoads, one per staged texture
+    std::vector<Texture::CStagedTexture> m_stagedTextures {};
+    std::vector<CLoadHandle<Texture::CCookedTexture>> m_textureLoads {};
+    CBuffer m_textureStagingBuffer {};
 
-    vk::DebugUtilsMessengerEXT m_debugMessenger {};
+    vma::Allocator m_allocator {};
+    // Every copy into a device local resource goes through it, see CUploadManager
+    Vulkan::CUploadManager m_uploads {};
+    Vulkan::CPipelineCache m_pipelineCache {};
+    // Owns every descriptor set and pipeline layout, the handles below are borrowed from it
+    Vulkan::CLayoutCache m_layoutCache {};
+    // For a single frame, the pool holds m_framesInFlight times as much
+    std::vector<vk::DescriptorPoolSize> m_descriptorPoolSizes {};
+    uint32_t m_descriptorPoolMaxSets = 0;
+
+    // Destroys the instance once the destructor body has released everything created from it
+    Vulkan::CInstance m_instance {};
 
     vk::PhysicalDevice m_physicalDevice {};
     CQueueFamilyIndices m_queueFamiliesIndices {};
@@ -293,6 +327,7 @@ private:
     vk::Queue m_graphicsQueue {};
     vk::Queue m_presentQueue {};
     vk::Queue m_computeQueue {};
+    vk::Queue m_transferQueue {};
 
     vk::SurfaceCapabilitiesKHR m_surfaceCapabilities {};
     vk::SurfaceFormatKHR m_currentSurfaceFormat {};
@@ -319,10 +354,13 @@ private:
 
     vk::CommandPool m_commandPool {};
     std::vector<vk::CommandBuffer> m_commandBuffers {};
+    // On the compute family, the same family as m_commandPool without a dedicated one
+    vk::CommandPool m_computeCommandPool {};
     std::vector<vk::CommandBuffer> m_computeCommandBuffers {};
 
-    std::vector<CVertex> m_vertices;
-    std::vector<uint32_t> m_indices;
+    Mesh::CCookedMesh m_model {};
+    // Level of detail drawn this frame, picked from the projected error
+    uint32_t m_modelLod = 0;
     CBuffer m_vertexBuffer {};
     CBuffer m_indexBuffer {};
 
@@ -339,19 +377,82 @@ private:
     std::vector<vk::DescriptorSet> m_descriptorSets {};
     std::vector<vk::DescriptorSet> m_computeDescriptorSets {};
 
+    // Meshlets are culled by a compute pass that writes the draws, requires drawIndirectCount
+    bool m_meshletCulling = false;
+    CBuffer m_meshletBuffer {};
+    std::vector<CBuffer> m_drawCommandBuffers {};
+    std::vector<CBuffer> m_drawCountBuffers {};
+    vk::DescriptorSetLayout m_meshletCullDescriptorSetLayout {};
+    vk::PipelineLayout m_meshletCullPipelineLayout {};
+    vk::Pipeline m_meshletCullPipeline {};
+    std::vector<vk::DescriptorSet> m_meshletCullDescriptorSets {};
+    Vulkan::CMeshletCullConstants m_meshletCullConstants {};
+
+    // Device samples BC1-BC7 textures
+    bool m_textureCompressionBC = false;
     uint32_t m_mipLevels = 0;
+    vk::Format m_textureFormat = vk::Format::eUndefined;
     CImage m_textureImage {};
     vk::ImageView m_textureImageView {};
     vk::Sampler m_textureSampler {};
 
+    // Finer mips are bound and uploaded on demand, needs sparse residency on the graphics queue.
+    // Otherwise the whole chain is uploaded at load.
+    bool m_textureStreaming = false;
+    std::optional<Texture::CTextureStreamer> m_textureStreamer {};
+    uint32_t m_streamedTexture = 0;
+    // Streamed levels are copied out of the mapped cooked file
+    Texture::CCookedTexture m_streamedTextureFile {};
+    uint32_t m_textureWidth = 0;
+    uint32_t m_textureHeight = 0;
+    // Sparse block size and its texel footprint, each streamed level is bound in whole blocks
+    vk::DeviceSize m_textureBlockSize = 0;
+    vk::Extent3D m_textureBlockExtent {};
+    uint32_t m_textureMemoryTypeBits = 0;
+    vma::Allocation m_textureTailMemory {};
+    // One per level, null while it isn't bound
+    std::vector<vma::Allocation> m_textureLevelMemory {};
+    std::vector<CTextureLevelUpload> m_textureUploads {};
+
+    // Watches the asset directory, changes are picked up by _ApplyHotReloads at the next frame boundary
+    CFileWatcher m_assetWatcher {};
+    std::mutex m_changedAssetsMutex {};
+    std::vector<std::filesystem::path> m_changedAssets {};
+    CLoadHandle<Mesh::CCookedMesh> m_modelReload {};
+    CLoadHandle<Texture::CStagedTexture> m_textureReload {};
+    std::chrono::steady_clock::time_point m_modelReloadStart {};
+    std::chrono::steady_clock::time_point m_textureReloadStart {};
+    // Watches SHADER_SOURCE_DIRECTORY, changes are queued under m_changedAssetsMutex
+    CFileWatcher m_shaderWatcher {};
+    std::vector<std::filesystem::path> m_changedShaders {};
+    std::array<CLoadHandle<vk::Pipeline>, SHADER_PIPELINE_COUNT> m_pipelineRebuilds {};
+    std::array<std::chrono::steady_clock::time_point, SHADER_PIPELINE_COUNT> m_pipelineRebuildStarts {};
+    // Shaders changed again while their pipeline was being rebuilt
+    std::array<bool, SHADER_PIPELINE_COUNT> m_pipelinesStale {};
+    // Sets of a frame in flight can't be rewritten until that frame is done, see _RefreshDescriptorSets
+    std::vector<bool> m_descriptorSetsDirty {};
+    // Replaced resources with the last frame that may use them
+    std::deque<std::pair<uint64_t, std::function<void()>>> m_deferredDestruction {};
+
     vk::SampleCountFlagBits m_msaaSamples = vk::SampleCountFlagBits::e1;
 
     std::vector<vk::Semaphore> m_imageAvailableSemaphores {};
     std::vector<vk::Semaphore> m_renderFinishedSemaphores {};
-    std::vector<vk::Fence> m_inFlightFences {};
-    std::vector<vk::Fence> m_computeInFlightFences;
-    std::vector<vk::Semaphore> m_computeFinishedSemaphores;
+    // Each queue signals the number of the frame whose work it finished. Frames are numbered from 1.
+    vk::Semaphore m_graphicsTimeline {};
+    vk::Semaphore m_computeTimeline {};
+    // Last frame handed to the GPU, the one being recorded is the next
+    uint64_t m_submittedFrame = 0;
+    // Particle buffers still owned by the graphics family, set whenever they are recreated on a device with a
+    // dedicated compute family
+    bool m_particleHandoffPending = false;
 
     uint32_t m_currentFrame = 0;
+
+    EPresentPolicy m_presentPolicy = EPresentPolicy::Throughput;
+    // Set by SetPresentPolicy, applied at the start of the next frame
+    EPresentPolicy m_requestedPresentPolicy = EPresentPolicy::Throughput;
+    // Frames in flight of the throughput policy, 2 unless -frames_in_flight asks for more
+    uint32_t m_throughputFramesInFlight = 2;
+    uint32_t m_framesInFlight = 2;
 };
-#endif
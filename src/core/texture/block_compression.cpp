@@ -0,0 +1,604 @@
+#include "block_compression.hpp"
+
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// Baseline on x86-64, everything else takes the scalar path
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace Texture
+{
+namespace
+{
+constexpr std::size_t BLOCK_TEXELS = 16;
+
+using CColor = std::array<float, 4>;
+
+// 4x4 texels in the 0-255 range, one array per channel so four texels fill an SSE register
+struct CBlock
+{
+    alignas(16) float channels[4][BLOCK_TEXELS];
+};
+
+// Position of every BC7 4-bit index between the endpoints, out of 64
+constexpr std::array<int, 16> BC7_WEIGHTS = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+int GetRefinementCount(const ETextureQuality quality) {
+    switch (quality) {
+        case ETextureQuality::Fast:
+            return 0;
+        case ETextureQuality::Normal:
+            return 2;
+        case ETextureQuality::High:
+            return 6;
+    }
+    return 0;
+}
+
+// Texels past the edge of the level repeat the last row and column
+void LoadBlock(const CMipLevel& level, const uint32_t blockX, const uint32_t blockY, CBlock& block) {
+    for (uint32_t y = 0; y < 4; ++y) {
+        const uint32_t sourceY = std::min(blockY * 4 + y, level.height - 1);
+        for (uint32_t x = 0; x < 4; ++x) {
+            const uint32_t sourceX = std::min(blockX * 4 + x, level.width - 1);
+            const std::byte* texel = level.pixels.data() + (std::size_t { sourceY } * level.width + sourceX) * 4;
+            for (std::size_t c = 0; c < 4; ++c) {
+                block.channels[c][y * 4 + x] = static_cast<float>(texel[c]);
+            }
+        }
+    }
+}
+
+// Picks the nearest palette entry for every texel, distances are weighted per channel.
+// Ties go to the lower index. Returns the summed weighted squared error.
+float FindClosestIndices(
+    const CBlock& block,
+    const std::span<const CColor> palette,
+    const CColor& weights,
+    uint8_t* indices
+) {
+#if TEXTURE_SSE2
+    const __m128 weight[4] = {
+        _mm_set1_ps(weights[0]),
+        _mm_set1_ps(weights[1]),
+        _mm_set1_ps(weights[2]),
+        _mm_set1_ps(weights[3])
+    };
+
+    __m128 total = _mm_setzero_ps();
+    for (std::size_t t = 0; t < BLOCK_TEXELS; t += 4) {
+        const __m128 texels[4] = {
+            _mm_load_ps(&block.channels[0][t]),
+            _mm_load_ps(&block.channels[1][t]),
+            _mm_load_ps(&block.channels[2][t]),
+            _mm_load_ps(&block.channels[3][t])
+        };
+
+        __m128 bestError = _mm_set1_ps(FLT_MAX);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (std::size_t p = 0; p < palette.size(); ++p) {
+            __m128 error = _mm_setzero_ps();
+            for (std::size_t c = 0; c < 4; ++c) {
+                const __m128 difference = _mm_sub_ps(texels[c], _mm_set1_ps(palette[p][c]));
+                error = _mm_add_ps(error, _mm_mul_ps(_mm_mul_ps(difference, difference), weight[c]));
+            }
+
+            const __m128i better = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+            bestError = _mm_min_ps(error, bestError);
+            bestIndex = _mm_or_si128(
+                _mm_and_si128(better, _mm_set1_epi32(static_cast<int>(p))),
+                _mm_andnot_si128(better, bestIndex)
+            );
+        }
+        total = _mm_add_ps(total, bestError);
+
+        alignas(16) int32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+        for (std::size_t i = 0; i < 4; ++i) {
+            indices[t + i] = static_cast<uint8_t>(lanes[i]);
+        }
+    }
+
+    alignas(16) float sums[4];
+    _mm_store_ps(sums, total);
+    return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+    float total = 0.0f;
+    for (std::size_t t = 0; t < BLOCK_TEXELS; ++t) {
+        float bestError = FLT_MAX;
+        uint8_t bestIndex = 0;
+        for (std::size_t p = 0; p < palette.size(); ++p) {
+            float error = 0.0f;
+            for (std::size_t c = 0; c < 4; ++c) {
+                const float difference = block.channels[c][t] - palette[p][c];
+                error += difference * difference * weights[c];
+            }
+            if (error < bestError) {
+                bestError = error;
+                bestIndex = static_cast<uint8_t>(p);
+            }
+        }
+        indices[t] = bestIndex;
+        total += bestError;
+    }
+    return total;
+#endif
+}
+
+// Endpoints at the extremes of the block along the principal axis of the weighted channels
+void ComputePrincipalEndpoints(const CBlock& block, const CColor& weights, CColor& start, CColor& end) {
+    CColor mean {};
+    for (std::size_t c = 0; c < 4; ++c) {
+        if (weights[c] != 0.0f) {
+            for (std::size_t t = 0; t < BLOCK_TEXELS; ++t) {
+                mean[c] += block.channels[c][t];
+            }
+            mean[c] /= static_cast<float>(BLOCK_TEXELS);
+        }
+    }
+
+    std::array<CColor, 4> covariance {};
+    for (std::size_t t = 0; t < BLOCK_TEXELS; ++t) {
+        CColor offset {};
+        for (std::size_t c = 0; c < 4; ++c) {
+            offset[c] = weights[c] != 0.0f ? block.channels[c][t] - mean[c] : 0.0f;
+        }
+        for (std::size_t i = 0; i < 4; ++i) {
+            for (std::size_t j = 0; j < 4; ++j) {
+                covariance[i][j] += offset[i] * offset[j];
+            }
+        }
+    }
+
+    // Power iteration from the row of the most varying channel converges in a few steps for 4x4 data
+    std::size_t widest = 0;
+    for (std::size_t c = 1; c < 4; ++c) {
+        if (covariance[c][c] > covariance[widest][widest]) {
+            widest = c;
+        }
+    }
+    start = mean;
+    end = mean;
+    if (covariance[widest][widest] < 1e-3f) {
+        return;
+    }
+
+    CColor axis = covariance[widest];
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        CColor next {};
+        float largest = 0.0f;
+        for (std::size_t i = 0; i < 4; ++i) {
+            for (std::size_t j = 0; j < 4; ++j) {
+                next[i] += covariance[i][j] * axis[j];
+            }
+            largest = std::max(largest, std::abs(next[i]));
+        }
+        if (largest == 0.0f) {
+            break;
+        }
+        for (std::size_t i = 0; i < 4; ++i) {
+            axis[i] = next[i] / largest;
+        }
+    }
+
+    float axisLengthSquared = 0.0f;
+    for (std::size_t c = 0; c < 4; ++c) {
+        axisLengthSquared += axis[c] * axis[c];
+    }
+
+    float low = FLT_MAX;
+    float high = -FLT_MAX;
+    for (std::size_t t = 0; t < BLOCK_TEXELS; ++t) {
+        float projection = 0.0f;
+        for (std::size_t c = 0; c < 4; ++c) {
+            if (weights[c] != 0.0f) {
+                projection += (block.channels[c][t] - mean[c]) * axis[c];
+            }
+        }
+        low = std::min(low, projection);
+        high = std::max(high, projection);
+    }
+
+    for (std::size_t c = 0; c < 4; ++c) {
+        start[c] = std::clamp(mean[c] + axis[c] * low / axisLengthSquared, 0.0f, 255.0f);
+        end[c] = std::clamp(mean[c] + axis[c] * high / axisLengthSquared, 0.0f, 255.0f);
+    }
+}
+
+// Least squares endpoints for fixed indices, `positions[i]` is where index i sits between start (0) and end (1).
+// Returns false if every texel uses the same position, there is nothing to refine then.
+bool FitEndpoints(
+    const CBlock& block,
+    const uint8_t* indices,
+    const std::span<const float> positions,
+    CColor& start,
+    CColor& end
+) {
+    float startWeight = 0.0f;
+    float crossWeight = 0.0f;
+    float endWeight = 0.0f;
+    CColor startSum {};
+    CColor endSum {};
+    for (std::size_t t = 0; t < BLOCK_TEXELS; ++t) {
+        const float position = positions[indices[t]];
+        const float inverse = 1.0f - position;
+        startWeight += inverse * inverse;
+        crossWeight += inverse * position;
+        endWeight += position * position;
+        for (std::size_t c = 0; c < 4; ++c) {
+            startSum[c] += inverse * block.channels[c][t];
+            endSum[c] += position * block.channels[c][t];
+        }
+    }
+
+    const float determinant = startWeight * endWeight - crossWeight * crossWeight;
+    if (std::abs(determinant) < 1e-6f) {
+        return false;
+    }
+    for (std::size_t c = 0; c < 4; ++c) {
+        start[c] = std::clamp((endWeight * startSum[c] - crossWeight * endSum[c]) / determinant, 0.0f, 255.0f);
+        end[c] = std::clamp((startWeight * endSum[c] - crossWeight * startSum[c]) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+CColor Lerp(const CColor& start, const CColor& end, const float position) {
+    CColor result {};
+    for (std::size_t c = 0; c < 4; ++c) {
+        result[c] = start[c] + (end[c] - start[c]) * position;
+    }
+    return result;
+}
+
+uint16_t PackRgb565(const CColor& color) {
+    const auto red = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+    const auto green = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+    const auto blue = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+    return static_cast<uint16_t>((red << 11) | (green << 5) | blue);
+}
+
+CColor UnpackRgb565(const uint16_t value) {
+    const uint32_t red = value >> 11;
+    const uint32_t green = (value >> 5) & 63;
+    const uint32_t blue = value & 31;
+    return {
+        static_cast<float>((red << 3) | (red >> 2)),
+        static_cast<float>((green << 2) | (green >> 4)),
+        static_cast<float>((blue << 3) | (blue >> 2)),
+        0.0f
+    };
+}
+
+// BC1 color block in the four color mode, which BC3 requires and opaque BC1 prefers
+float EncodeColorBlock(const CBlock& block, const int refinements, std::byte* out) {
+    constexpr CColor weights = { 1.0f, 1.0f, 1.0f, 0.0f };
+    constexpr std::array<float, 4> positions = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    CColor start {};
+    CColor end {};
+    ComputePrincipalEndpoints(block, weights, start, end);
+
+    float bestError = FLT_MAX;
+    for (int pass = 0; pass <= refinements; ++pass) {
+        uint16_t color0 = PackRgb565(start);
+        uint16_t color1 = PackRgb565(end);
+        // Equal endpoints select the three color mode, harmless since every texel then uses index 0
+        if (color0 < color1) {
+            std::swap(color0, color1);
+        }
+
+        const CColor endpoint0 = UnpackRgb565(color0);
+        const CColor endpoint1 = UnpackRgb565(color1);
+        const std::array<CColor, 4> palette = {
+            endpoint0,
+            endpoint1,
+            Lerp(endpoint0, endpoint1, positions[2]),
+            Lerp(endpoint0, endpoint1, positions[3])
+        };
+
+        uint8_t indices[BLOCK_TEXELS];
+        const float error = FindClosestIndices(block, palette, weights, indices);
+        if (error < bestError) {
+            bestError = error;
+
+            uint32_t indexBits = 0;
+            for (std::size_t t = 0; t < BLOCK_TEXELS; ++t) {
+                indexBits |= uint32_t { indices[t] } << (t * 2);
+            }
+            std::memcpy(out, &color0, sizeof(color0));
+            std::memcpy(out + 2, &color1, sizeof(color1));
+            std::memcpy(out + 4, &indexBits, sizeof(indexBits));
+        }
+
+        if (pass == refinements || !FitEndpoints(block, indices, positions, start, end)) {
+            break;
+        }
+    }
+    return bestError;
+}
+
+// BC4 block of one channel, the alpha half of BC3 and both halves of BC5. Always in the eight value mode.
+float EncodeChannelBlock(const CBlock& block, const std::size_t channel, const int refinements, std::byte* out) {
+    CColor weights {};
+    weights[channel] = 1.0f;
+    constexpr std::array<float, 8> positions = {
+        0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f
+    };
+
+    const float* values = block.channels[channel];
+    CColor start {};
+    CColor end {};
+    start[channel] = *std::max_element(values, values + BLOCK_TEXELS);
+    end[channel] = *std::min_element(values, values + BLOCK_TEXELS);
+
+    float bestError = FLT_MAX;
+    for (int pass = 0; pass <= refinements; ++pass) {
+        auto value0 = static_cast<uint8_t>(std::lround(start[channel]));
+        auto value1 = static_cast<uint8_t>(std::lround(end[channel]));
+        // Equal endpoints select the six value mode, harmless since every texel then uses index 0
+        if (value0 < value1) {
+            std::swap(value0, value1);
+        }
+
+        std::array<CColor, 8> palette {};
+        for (std::size_t i = 0; i < palette.size(); ++i) {
+            palette[i][channel] = static_cast<float>(value0) + (static_cast<float>(value1) - static_cast<float>(value0)) * positions[i];
+        }
+
+        uint8_t indices[BLOCK_TEXELS];
+        const float error = FindClosestIndices(block, palette, weights, indices);
+        if (error < bestError) {
+            bestError = error;
+
+            uint64_t indexBits = 0;
+            for (std::size_t t = 0; t < BLOCK_TEXELS; ++t) {
+                indexBits |= uint64_t { indices[t] } << (t * 3);
+            }
+            out[0] = static_cast<std::byte>(value0);
+            out[1] = static_cast<std::byte>(value1);
+            std::memcpy(out + 2, &indexBits, 6);
+        }
+
+        if (pass == refinements || !FitEndpoints(block, indices, positions, start, end)) {
+            break;
+        }
+    }
+    return bestError;
+}
+
+// Mode 6 endpoint, 7 bits per channel and a shared lowest bit
+struct CBc7Endpoint
+{
+    std::array<uint32_t, 4> values;
+    uint32_t pBit;
+};
+
+CBc7Endpoint QuantizeBc7Endpoint(const CColor& color, const uint32_t pBit) {
+    CBc7Endpoint endpoint { {}, pBit };
+    for (std::size_t c = 0; c < 4; ++c) {
+        const long value = std::lround((color[c] - static_cast<float>(pBit)) / 2.0f);
+        endpoint.values[c] = static_cast<uint32_t>(std::clamp(value, 0L, 127L));
+    }
+    return endpoint;
+}
+
+uint32_t ExpandBc7Endpoint(const CBc7Endpoint& endpoint, const std::size_t channel) {
+    return (endpoint.values[channel] << 1) | endpoint.pBit;
+}
+
+float GetBc7EndpointError(const CBc7Endpoint& endpoint, const CColor& color) {
+    float error = 0.0f;
+    for (std::size_t c = 0; c < 4; ++c) {
+        const float difference = static_cast<float>(ExpandBc7Endpoint(endpoint, c)) - color[c];
+        error += difference * difference;
+    }
+    return error;
+}
+
+// Little endian bit stream of one 128-bit block
+class CBitWriter
+{
+public:
+    void Write(const uint64_t value, const uint32_t count) {
+        const uint32_t word = m_position / 64;
+        const uint32_t shift = m_position % 64;
+        m_words[word] |= value << shift;
+        if (shift != 0 && shift + count > 64) {
+            m_words[word + 1] |= value >> (64 - shift);
+        }
+        m_position += count;
+    }
+
+    void CopyTo(std::byte* out) const { std::memcpy(out, m_words, sizeof(m_words)); }
+
+private:
+    uint64_t m_words[2] = {};
+    uint32_t m_position = 0;
+};
+
+void WriteBc7Mode6Block(CBc7Endpoint endpoint0, CBc7Endpoint endpoint1, const uint8_t* sourceIndices, std::byte* out) {
+    // The first index is stored without its top bit, so it must point into the lower half
+    uint8_t indices[BLOCK_TEXELS];
+    const bool flip = sourceIndices[0] >= 8;
+    if (flip) {
+        std::swap(endpoint0, endpoint1);
+    }
+    for (std::size_t t = 0; t < BLOCK_TEXELS; ++t) {
+        indices[t] = flip ? static_cast<uint8_t>(15 - sourceIndices[t]) : sourceIndices[t];
+    }
+
+    CBitWriter writer;
+    writer.Write(1 << 6, 7);
+    for (std::size_t c = 0; c < 4; ++c) {
+        writer.Write(endpoint0.values[c], 7);
+        writer.Write(endpoint1.values[c], 7);
+    }
+    writer.Write(endpoint0.pBit, 1);
+    writer.Write(endpoint1.pBit, 1);
+    writer.Write(indices[0], 3);
+    for (std::size_t t = 1; t < BLOCK_TEXELS; ++t) {
+        writer.Write(indices[t], 4);
+    }
+    writer.CopyTo(out);
+}
+
+float EncodeBc7Block(const CBlock& block, const int refinements, const bool searchPBits, std::byte* out) {
+    constexpr CColor weights = { 1.0f, 1.0f, 1.0f, 1.0f };
+    std::array<float, 16> positions {};
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        positions[i] = static_cast<float>(BC7_WEIGHTS[i]) / 64.0f;
+    }
+
+    CColor start {};
+    CColor end {};
+    ComputePrincipalEndpoints(block, weights, start, end);
+
+    float bestError = FLT_MAX;
+    for (int pass = 0; pass <= refinements; ++pass) {
+        // Either every p-bit pair, or the pair closest to the unquantized endpoints
+        std::array<std::array<uint32_t, 2>, 4> pBitPairs = { { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 1 } } };
+        std::size_t pairCount = pBitPairs.size();
+        if (!searchPBits) {
+            const auto pickPBit = [](const CColor& color) {
+                return GetBc7EndpointError(QuantizeBc7Endpoint(color, 1), color) <
+                    GetBc7EndpointError(QuantizeBc7Endpoint(color, 0), color) ? 1u : 0u;
+            };
+            pBitPairs[0] = { pickPBit(start), pickPBit(end) };
+            pairCount = 1;
+        }
+
+        float passError = FLT_MAX;
+        uint8_t passIndices[BLOCK_TEXELS] {};
+        for (std::size_t pair = 0; pair < pairCount; ++pair) {
+            const CBc7Endpoint endpoint0 = QuantizeBc7Endpoint(start, pBitPairs[pair][0]);
+            const CBc7Endpoint endpoint1 = QuantizeBc7Endpoint(end, pBitPairs[pair][1]);
+
+            std::array<CColor, 16> palette {};
+            for (std::size_t i = 0; i < palette.size(); ++i) {
+                const auto weight = static_cast<uint32_t>(BC7_WEIGHTS[i]);
+                for (std::size_t c = 0; c < 4; ++c) {
+                    palette[i][c] = static_cast<float>(
+                        ((64 - weight) * ExpandBc7Endpoint(endpoint0, c) + weight * ExpandBc7Endpoint(endpoint1, c) + 32) >> 6
+                    );
+                }
+            }
+
+            uint8_t indices[BLOCK_TEXELS];
+            const float error = FindClosestIndices(block, palette, weights, indices);
+            if (error < passError) {
+                passError = error;
+                std::memcpy(passIndices, indices, sizeof(indices));
+            }
+            if (error < bestError) {
+                bestError = error;
+                WriteBc7Mode6Block(endpoint0, endpoint1, indices, out);
+            }
+        }
+
+        if (pass == refinements || !FitEndpoints(block, passIndices, positions, start, end)) {
+            break;
+        }
+    }
+    return bestError;
+}
+
+float EncodeBlock(const CBlock& block, const ETextureFormat format, const ETextureQuality quality, std::byte* out) {
+    const int refinements = GetRefinementCount(quality);
+    switch (format) {
+        case ETextureFormat::Bc1RgbUnorm:
+        case ETextureFormat::Bc1RgbSrgb:
+            return EncodeColorBlock(block, refinements, out);
+        case ETextureFormat::Bc3Unorm:
+        case ETextureFormat::Bc3Srgb:
+            return EncodeChannelBlock(block, 3, refinements, out) + EncodeColorBlock(block, refinements, out + 8);
+        case ETextureFormat::Bc5Unorm:
+            return EncodeChannelBlock(block, 0, refinements, out) + EncodeChannelBlock(block, 1, refinements, out + 8);
+        case ETextureFormat::Bc7Unorm:
+        case ETextureFormat::Bc7Srgb:
+            return EncodeBc7Block(block, refinements, quality == ETextureQuality::High, out);
+        default:
+            throw std::runtime_error("Format is not block compressed!");
+    }
+}
+
+uint32_t GetEncodedChannelCount(const ETextureFormat format) {
+    switch (format) {
+        case ETextureFormat::Bc1RgbUnorm:
+        case ETextureFormat::Bc1RgbSrgb:
+            return 3;
+        case ETextureFormat::Bc5Unorm:
+            return 2;
+        default:
+            return 4;
+    }
+}
+}
+
+ETextureFormat GetCompressedFormat(const ETextureFormat format, const ETextureCompression compression) {
+    const bool srgb = IsSrgbFormat(format);
+    switch (compression) {
+        case ETextureCompression::None:
+            return format;
+        case ETextureCompression::Bc1:
+            return srgb ? ETextureFormat::Bc1RgbSrgb : ETextureFormat::Bc1RgbUnorm;
+        case ETextureCompression::Bc3:
+            return srgb ? ETextureFormat::Bc3Srgb : ETextureFormat::Bc3Unorm;
+        case ETextureCompression::Bc5:
+            // Two channel data is never color
+            return ETextureFormat::Bc5Unorm;
+        case ETextureCompression::Bc7:
+            return srgb ? ETextureFormat::Bc7Srgb : ETextureFormat::Bc7Unorm;
+    }
+    return format;
+}
+
+double CompressTexture(CTextureData& texture, const ETextureCompression compression, const ETextureQuality quality) {
+    if (IsBlockCompressedFormat(texture.format)) {
+        throw std::runtime_error("Texture is already block compressed!");
+    }
+    const ETextureFormat format = GetCompressedFormat(texture.format, compression);
+    if (format == texture.format) {
+        return 0.0;
+    }
+
+    const uint32_t blockSize = GetTextureFormatBlockSize(format);
+    double squaredError = 0.0;
+    uint64_t channelCount = 0;
+    for (CMipLevel& level : texture.levels) {
+        const uint32_t blocksX = (level.width + 3) / 4;
+        const uint32_t blocksY = (level.height + 3) / 4;
+        std::vector<std::byte> blocks(std::size_t { blocksX } * blocksY * blockSize);
+        std::vector<double> rowErrors(blocksY);
+
+        ThreadPool()->ParallelFor(blocksY, [&](const std::size_t y) {
+            CBlock block;
+            double error = 0.0;
+            for (uint32_t x = 0; x < blocksX; ++x) {
+                LoadBlock(level, x, static_cast<uint32_t>(y), block);
+                error += EncodeBlock(block, format, quality, blocks.data() + (y * blocksX + x) * blockSize);
+            }
+            rowErrors[y] = error;
+        });
+
+        for (const double error : rowErrors) {
+            squaredError += error;
+        }
+        channelCount += uint64_t { blocksX } * blocksY * BLOCK_TEXELS * GetEncodedChannelCount(format);
+        level.pixels = std::move(blocks);
+    }
+
+    texture.format = format;
+    return squaredError / static_cast<double>(channelCount);
+}
+}
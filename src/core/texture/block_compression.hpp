@@ -0,0 +1,38 @@
+#pragma once
+
+#include "texture.hpp"
+
+#include <cstdint>
+
+namespace Texture
+{
+enum class ETextureCompression : uint32_t
+{
+    None = 0,
+    // 4 bits per texel, opaque color
+    Bc1 = 1,
+    // 8 bits per texel, color with smooth alpha
+    Bc3 = 2,
+    // 8 bits per texel, red and green only, for normal maps and other two channel data
+    Bc5 = 3,
+    // 8 bits per texel, highest quality color. Alpha shares endpoints with color, so noisy alpha
+    // unrelated to color can come out better as BC3.
+    Bc7 = 4,
+};
+
+// Trades encoding time for quality, endpoints are refined more on higher presets
+enum class ETextureQuality : uint32_t
+{
+    Fast = 0,
+    Normal = 1,
+    High = 2,
+};
+
+// Format CompressTexture produces for a texture currently in `format`. sRGB is kept where the block format has it.
+ETextureFormat GetCompressedFormat(ETextureFormat format, ETextureCompression compression);
+
+// Encodes every level of an RGBA8 texture in place, spreading rows of blocks over ThreadPool().
+// BC7 blocks are all written in mode 6, a single RGBA endpoint pair with 4-bit indices.
+// Returns the mean squared error per encoded channel in 8-bit units.
+double CompressTexture(CTextureData& texture, ETextureCompression compression, ETextureQuality quality);
+}
@@ -0,0 +1,259 @@
+#include "cooked_texture.hpp"
+
+#include "image_importer.hpp"
+#include "mip_generation.hpp"
+
+#include "atomicfile.hpp"
+#include "console.hpp"
+#include "resourceloader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace Texture
+{
+namespace
+{
+uint64_t AlignUp(const uint64_t value, const uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+ETextureFormat GetImportFormat(const CTextureCookOptions& options) {
+    return options.srgb ? ETextureFormat::Rgba8Srgb : ETextureFormat::Rgba8Unorm;
+}
+
+void CookImportedTexture(
+    CTextureData texture,
+    const std::string_view name,
+    const std::filesystem::path& destination,
+    const CTextureCookOptions& options
+) {
+    if (options.generateMips) {
+        GenerateMipChain(texture);
+    }
+
+    std::size_t sourceBytes = 0;
+    for (const CMipLevel& level : texture.levels) {
+        sourceBytes += level.pixels.size();
+    }
+
+    double meanSquaredError = 0.0;
+    if (options.compression != ETextureCompression::None) {
+        meanSquaredError = CompressTexture(texture, options.compression, options.quality);
+    }
+    WriteCookedTexture(destination, texture);
+
+    std::size_t cookedBytes = 0;
+    for (const CMipLevel& level : texture.levels) {
+        cookedBytes += level.pixels.size();
+    }
+
+    Msg(
+        "Cooked \"{}\" -> \"{}\": {}x{}, {} mip levels, {}, {} -> {} bytes, RMSE {:.2f}",
+        name,
+        destination.string(),
+        texture.levels[0].width,
+        texture.levels[0].height,
+        texture.levels.size(),
+        GetTextureFormatName(texture.format),
+        sourceBytes,
+        cookedBytes,
+        std::sqrt(meanSquaredError)
+    );
+}
+}
+
+bool CCookedTexture::Load(const std::filesystem::path& path) {
+    m_view = {};
+    m_levels = {};
+
+    if (!m_file.Open(path)) {
+        return false;
+    }
+    m_view = m_file.GetView();
+    return _Parse(path.string());
+}
+
+bool CCookedTexture::Open(const std::span<const std::byte> data, const std::string_view name) {
+    m_file.Close();
+    m_view = {};
+    m_levels = {};
+
+    if (reinterpret_cast<std::uintptr_t>(data.data()) % alignof(CCookedTextureLevel) != 0) {
+        Warning("Cooked texture \"{}\" is ignored: data is misaligned", name);
+        return false;
+    }
+    m_view = data;
+    return _Parse(name);
+}
+
+bool CCookedTexture::_Parse(const std::string_view name) {
+    const auto fail = [&](const std::string_view reason) {
+        Warning("Cooked texture \"{}\" is ignored: {}", name, reason);
+        m_file.Close();
+        m_view = {};
+        m_levels = {};
+        return false;
+    };
+
+    const std::span<const std::byte> view = m_view;
+    if (view.size() < sizeof(CCookedTextureHeader)) {
+        return fail("file is truncated");
+    }
+
+    std::memcpy(&m_header, view.data(), sizeof(m_header));
+    if (m_header.magic != COOKED_TEXTURE_MAGIC) {
+        return fail("not a cooked texture");
+    }
+    if (m_header.version != COOKED_TEXTURE_VERSION) {
+        return fail("cooked by another version");
+    }
+    if (m_header.format > ETextureFormat::Bc7Srgb) {
+        return fail("unknown format");
+    }
+    if (m_header.width == 0 || m_header.height == 0 || m_header.levelCount == 0 ||
+        m_header.levelCount > GetMipLevelCount(m_header.width, m_header.height)) {
+        return fail("invalid dimensions");
+    }
+
+    const uint64_t tableEnd = sizeof(CCookedTextureHeader) + sizeof(CCookedTextureLevel) * uint64_t { m_header.levelCount };
+    if (view.size() < tableEnd) {
+        return fail("level table is truncated");
+    }
+    if (m_header.dataOffset % COOKED_TEXTURE_ALIGNMENT != 0 || m_header.dataOffset < tableEnd ||
+        m_header.dataOffset > view.size() || m_header.dataSize > view.size() - m_header.dataOffset) {
+        return fail("data is out of bounds");
+    }
+
+    // File mappings are page aligned and staging memory is at least COOKED_TEXTURE_ALIGNMENT aligned,
+    // so the table can be used in place
+    m_levels = {
+        reinterpret_cast<const CCookedTextureLevel*>(view.data() + sizeof(CCookedTextureHeader)),
+        m_header.levelCount
+    };
+
+    uint32_t width = m_header.width;
+    uint32_t height = m_header.height;
+    for (const CCookedTextureLevel& level : m_levels) {
+        if (level.width != width || level.height != height ||
+            level.size != GetTextureLevelSize(m_header.format, width, height)) {
+            return fail("level doesn't match the mip chain");
+        }
+        if (level.offset % COOKED_TEXTURE_ALIGNMENT != 0 || level.offset > m_header.dataSize ||
+            level.size > m_header.dataSize - level.offset) {
+            return fail("level is out of bounds");
+        }
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    return true;
+}
+
+void WriteCookedTexture(const std::filesystem::path& path, const CTextureData& texture) {
+    if (texture.levels.empty()) {
+        throw std::runtime_error(std::format("Cannot write texture \"{}\" without levels!", path.string()));
+    }
+
+    std::vector<CCookedTextureLevel> levels;
+    uint64_t dataSize = 0;
+    for (const CMipLevel& level : texture.levels) {
+        dataSize = AlignUp(dataSize, COOKED_TEXTURE_ALIGNMENT);
+        levels.push_back({ dataSize, level.pixels.size(), level.width, level.height });
+        dataSize += level.pixels.size();
+    }
+
+    CCookedTextureHeader header {};
+    header.magic = COOKED_TEXTURE_MAGIC;
+    header.version = COOKED_TEXTURE_VERSION;
+    header.format = texture.format;
+    header.width = texture.levels[0].width;
+    header.height = texture.levels[0].height;
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    header.dataOffset = AlignUp(sizeof(header) + sizeof(CCookedTextureLevel) * levels.size(), COOKED_TEXTURE_ALIGNMENT);
+    header.dataSize = dataSize;
+
+    const bool written = WriteFileAtomically(path, [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(levels.data()), sizeof(CCookedTextureLevel) * levels.size());
+
+        constexpr char padding[COOKED_TEXTURE_ALIGNMENT] = {};
+        const uint64_t tableEnd = sizeof(header) + sizeof(CCookedTextureLevel) * levels.size();
+        file.write(padding, static_cast<std::streamsize>(header.dataOffset - tableEnd));
+
+        uint64_t position = 0;
+        for (std::size_t i = 0; i < levels.size(); ++i) {
+            file.write(padding, static_cast<std::streamsize>(levels[i].offset - position));
+            file.write(
+                reinterpret_cast<const char*>(texture.levels[i].pixels.data()),
+                static_cast<std::streamsize>(levels[i].size)
+            );
+            position = levels[i].offset + levels[i].size;
+        }
+    });
+    if (!written) {
+        throw std::runtime_error(std::format("Failed to write cooked texture \"{}\"!", path.string()));
+    }
+}
+
+void CookTexture(
+    const std::filesystem::path& source,
+    const std::filesystem::path& destination,
+    const CTextureCookOptions& options
+) {
+    CookImportedTexture(ImportImage(source, GetImportFormat(options)), source.string(), destination, options);
+}
+
+void CookTexture(
+    const std::span<const std::byte> source,
+    const std::string_view name,
+    const std::filesystem::path& destination,
+    const CTextureCookOptions& options
+) {
+    CookImportedTexture(ImportImage(source, name, GetImportFormat(options)), name, destination, options);
+}
+
+CDerivedDataKey GetTextureCookKey(const std::span<const std::byte> source, const CTextureCookOptions& options) {
+    CDerivedDataKey key("tex", TEXTURE_COOKER_VERSION);
+    key.Add(COOKED_TEXTURE_VERSION)
+        .Add(source)
+        .Add(options.srgb)
+        .Add(options.generateMips)
+        .Add(options.compression)
+        .Add(options.quality);
+    return key;
+}
+
+std::filesystem::path CookCachedTexture(const std::string_view source, const CTextureCookOptions& options) {
+    const CMappedFile file = resource_loader::MapFile(source);
+    if (!file.IsOpen()) {
+        return {};
+    }
+    const CDerivedDataKey key = GetTextureCookKey(file.GetView(), options);
+
+    // Cooked from the same bytes the key hashes, the source may live in a pack
+    const auto cook = [&](const std::filesystem::path& destination) {
+        CookTexture(file.GetView(), source, destination, options);
+    };
+    // Only the header and level table are parsed, the texels aren't touched until the texture is staged
+    CCookedTexture texture;
+    std::filesystem::path path = DerivedDataCache()->Get(key, cook);
+    if (texture.Load(path)) {
+        return path;
+    }
+
+    // Damaged entry, or one left by a cooker change that forgot to bump TEXTURE_COOKER_VERSION
+    DerivedDataCache()->Invalidate(key);
+    path = DerivedDataCache()->Get(key, cook);
+    if (!texture.Load(path)) {
+        throw std::runtime_error(std::format("Failed to load freshly cooked texture \"{}\"!", source));
+    }
+    return path;
+}
+}
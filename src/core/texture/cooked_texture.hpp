@@ -0,0 +1,119 @@
+#pragma once
+
+#include "block_compression.hpp"
+#include "texture.hpp"
+
+#include "deriveddatacache.hpp"
+#include "mappedfile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace Texture
+{
+// Cooked texture file layout, in the spirit of KTX2:
+// [CCookedTextureHeader][CCookedTextureLevel x levelCount][level data]
+// Levels go from full resolution to 1x1 and are stored exactly as vkCmdCopyBufferToImage consumes them,
+// so the whole data section is copied into staging memory at once and uploaded with one region per level.
+constexpr uint32_t COOKED_TEXTURE_MAGIC = 0x58455453; // "STEX"
+constexpr uint32_t COOKED_TEXTURE_VERSION = 2;
+// Bump when cooking writes different data in the same format, e.g. after an encoder change,
+// so derived data cached by the old code is rebuilt
+constexpr uint32_t TEXTURE_COOKER_VERSION = 1;
+// Satisfies bufferOffset alignment of every format the cooker writes
+constexpr uint64_t COOKED_TEXTURE_ALIGNMENT = 16;
+
+struct CCookedTextureHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    ETextureFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+};
+
+struct CCookedTextureLevel
+{
+    // Relative to the data section
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+class CCookedTexture
+{
+public:
+    // Maps a cooked file. Returns false if it is missing, corrupted or cooked by another version.
+    bool Load(const std::filesystem::path& path);
+    // Uses a cooked file already in memory, e.g. read straight into a staging buffer. `data` must outlive
+    // the texture. `name` only appears in warnings.
+    bool Open(std::span<const std::byte> data, std::string_view name);
+
+    [[nodiscard]] ETextureFormat GetFormat() const { return m_header.format; }
+    [[nodiscard]] uint32_t GetWidth() const { return m_header.width; }
+    [[nodiscard]] uint32_t GetHeight() const { return m_header.height; }
+
+    // At least one level, full resolution first
+    [[nodiscard]] std::span<const CCookedTextureLevel> GetLevels() const { return m_levels; }
+
+    // All levels back to back, CCookedTextureLevel::offset points into it
+    [[nodiscard]] std::span<const std::byte> GetData() const {
+        return m_view.subspan(m_header.dataOffset, m_header.dataSize);
+    }
+    // Where GetData starts within the file
+    [[nodiscard]] uint64_t GetDataOffset() const { return m_header.dataOffset; }
+    [[nodiscard]] std::span<const std::byte> GetLevelData(const CCookedTextureLevel& level) const {
+        return GetData().subspan(level.offset, level.size);
+    }
+
+private:
+    bool _Parse(std::string_view name);
+
+    CMappedFile m_file;
+    // Whole file, either m_file or memory owned by the caller
+    std::span<const std::byte> m_view;
+    CCookedTextureHeader m_header {};
+    std::span<const CCookedTextureLevel> m_levels;
+};
+
+struct CTextureCookOptions
+{
+    // Color data, filtered in linear space and sampled through an sRGB view
+    bool srgb = true;
+    // Full chain down to 1x1, otherwise only the source resolution is stored
+    bool generateMips = true;
+    ETextureCompression compression = ETextureCompression::Bc7;
+    ETextureQuality quality = ETextureQuality::Normal;
+};
+
+void WriteCookedTexture(const std::filesystem::path& path, const CTextureData& texture);
+
+// Decodes source image, builds its mip chain, block compresses it and writes cooked file
+void CookTexture(
+    const std::filesystem::path& source,
+    const std::filesystem::path& destination,
+    const CTextureCookOptions& options = {}
+);
+// Same, from an encoded image already in memory. `name` only shows up in logs and errors.
+void CookTexture(
+    std::span<const std::byte> source,
+    std::string_view name,
+    const std::filesystem::path& destination,
+    const CTextureCookOptions& options = {}
+);
+
+// Derived data cache key of cooking `source`, which holds the source file's contents
+CDerivedDataKey GetTextureCookKey(std::span<const std::byte> source, const CTextureCookOptions& options);
+
+// Path of the cooked result of `source` in DerivedDataCache(), cooked on a miss and validated either way.
+// Returns an empty path if the source doesn't exist.
+// \param source UTF-8 encoded path to file from the application's root
+std::filesystem::path CookCachedTexture(std::string_view source, const CTextureCookOptions& options = {});
+}
@@ -0,0 +1,70 @@
+#include "image_importer.hpp"
+
+#include <stb/stb_image.h>
+
+#include <cstring>
+#include <format>
+#include <limits>
+#include <stdexcept>
+
+namespace Texture
+{
+namespace
+{
+// Takes ownership of `pixels` decoded by stb_image
+CTextureData MakeTexture(
+    stbi_uc* const pixels,
+    const int width,
+    const int height,
+    const ETextureFormat format,
+    const std::string_view name
+) {
+    if (IsBlockCompressedFormat(format)) {
+        throw std::runtime_error("Images can only be imported as RGBA8!");
+    }
+    if (!pixels) {
+        throw std::runtime_error(std::format("Failed to decode \"{}\": {}", name, stbi_failure_reason()));
+    }
+
+    CMipLevel level {};
+    level.width = static_cast<uint32_t>(width);
+    level.height = static_cast<uint32_t>(height);
+    level.pixels.resize(std::size_t { level.width } * level.height * 4);
+    std::memcpy(level.pixels.data(), pixels, level.pixels.size());
+    stbi_image_free(pixels);
+
+    CTextureData texture {};
+    texture.format = format;
+    texture.levels.push_back(std::move(level));
+    return texture;
+}
+}
+
+CTextureData ImportImage(const std::filesystem::path& path, const ETextureFormat format) {
+    int width = 0, height = 0, channels = 0;
+    stbi_uc* pixels = nullptr;
+    if (!IsBlockCompressedFormat(format)) {
+        pixels = stbi_load(path.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    }
+    return MakeTexture(pixels, width, height, format, path.string());
+}
+
+CTextureData ImportImage(const std::span<const std::byte> data, const std::string_view name, const ETextureFormat format) {
+    int width = 0, height = 0, channels = 0;
+    if (data.size() > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+        throw std::runtime_error(std::format("\"{}\" is too large to decode!", name));
+    }
+    stbi_uc* pixels = nullptr;
+    if (!IsBlockCompressedFormat(format)) {
+        pixels = stbi_load_from_memory(
+            reinterpret_cast<const stbi_uc*>(data.data()),
+            static_cast<int>(data.size()),
+            &width,
+            &height,
+            &channels,
+            STBI_rgb_alpha
+        );
+    }
+    return MakeTexture(pixels, width, height, format, name);
+}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "texture.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+namespace Texture
+{
+// Decodes PNG, JPEG, TGA and the other formats stb_image knows into a single RGBA8 level.
+// `format` is Rgba8Unorm or Rgba8Srgb and only tells how the pixels are meant to be sampled.
+CTextureData ImportImage(const std::filesystem::path& path, ETextureFormat format);
+// Same, from an encoded image already in memory. `name` only shows up in errors.
+CTextureData ImportImage(std::span<const std::byte> data, std::string_view name, ETextureFormat format);
+}
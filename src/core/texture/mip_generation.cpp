@@ -0,0 +1,121 @@
+#include "mip_generation.hpp"
+
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+namespace Texture
+{
+namespace
+{
+// Rows of the destination level processed by one pool task
+constexpr uint32_t ROWS_PER_TASK = 16;
+
+float SrgbToLinear(const float value) {
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSrgb(const float value) {
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+const std::array<float, 256>& GetSrgbToLinearTable() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> result {};
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            result[i] = SrgbToLinear(static_cast<float>(i) / 255.0f);
+        }
+        return result;
+    }();
+    return table;
+}
+
+std::byte ToUnorm8(const float value) {
+    return static_cast<std::byte>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+// Source texels covered by destination texel `i`: two of them, three for the last one of an odd size
+void GetFootprint(const uint32_t i, const uint32_t sourceSize, const uint32_t size, uint32_t& begin, uint32_t& end) {
+    begin = std::min(i * 2, sourceSize - 1);
+    end = std::min(begin + 2, sourceSize);
+    if (i == size - 1) {
+        end = sourceSize;
+    }
+}
+
+void Downsample(const CMipLevel& source, CMipLevel& destination, const bool srgb) {
+    const std::array<float, 256>& toLinear = GetSrgbToLinearTable();
+    const std::byte* const sourcePixels = source.pixels.data();
+
+    const auto downsampleRows = [&](const uint32_t firstRow, const uint32_t lastRow) {
+        for (uint32_t y = firstRow; y < lastRow; ++y) {
+            uint32_t rowBegin = 0, rowEnd = 0;
+            GetFootprint(y, source.height, destination.height, rowBegin, rowEnd);
+
+            for (uint32_t x = 0; x < destination.width; ++x) {
+                uint32_t columnBegin = 0, columnEnd = 0;
+                GetFootprint(x, source.width, destination.width, columnBegin, columnEnd);
+
+                std::array<float, 4> sum {};
+                for (uint32_t sy = rowBegin; sy < rowEnd; ++sy) {
+                    const std::byte* texel = sourcePixels + (std::size_t { sy } * source.width + columnBegin) * 4;
+                    for (uint32_t sx = columnBegin; sx < columnEnd; ++sx, texel += 4) {
+                        for (std::size_t c = 0; c < 3; ++c) {
+                            const auto value = static_cast<uint8_t>(texel[c]);
+                            sum[c] += srgb ? toLinear[value] : static_cast<float>(value) / 255.0f;
+                        }
+                        sum[3] += static_cast<float>(texel[3]) / 255.0f;
+                    }
+                }
+
+                const float weight = 1.0f / static_cast<float>((rowEnd - rowBegin) * (columnEnd - columnBegin));
+                std::byte* out = destination.pixels.data() + (std::size_t { y } * destination.width + x) * 4;
+                for (std::size_t c = 0; c < 3; ++c) {
+                    const float average = sum[c] * weight;
+                    out[c] = ToUnorm8(srgb ? LinearToSrgb(average) : average);
+                }
+                out[3] = ToUnorm8(sum[3] * weight);
+            }
+        }
+    };
+
+    const uint32_t taskCount = (destination.height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    if (taskCount == 1) {
+        downsampleRows(0, destination.height);
+        return;
+    }
+    ThreadPool()->ParallelFor(taskCount, [&](const std::size_t task) {
+        const auto firstRow = static_cast<uint32_t>(task) * ROWS_PER_TASK;
+        downsampleRows(firstRow, std::min(firstRow + ROWS_PER_TASK, destination.height));
+    });
+}
+}
+
+void GenerateMipChain(CTextureData& texture) {
+    if (texture.levels.empty()) {
+        throw std::runtime_error("Cannot generate mips of an empty texture!");
+    }
+    if (IsBlockCompressedFormat(texture.format)) {
+        throw std::runtime_error("Mips can only be generated for RGBA8 textures!");
+    }
+
+    texture.levels.resize(1);
+    const uint32_t levelCount = GetMipLevelCount(texture.levels[0].width, texture.levels[0].height);
+    texture.levels.reserve(levelCount);
+
+    for (uint32_t level = 1; level < levelCount; ++level) {
+        const CMipLevel& source = texture.levels[level - 1];
+
+        CMipLevel destination {};
+        destination.width = std::max(source.width / 2, 1u);
+        destination.height = std::max(source.height / 2, 1u);
+        destination.pixels.resize(std::size_t { destination.width } * destination.height * 4);
+        Downsample(source, destination, IsSrgbFormat(texture.format));
+
+        texture.levels.push_back(std::move(destination));
+    }
+}
+}
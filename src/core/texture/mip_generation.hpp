@@ -0,0 +1,11 @@
+#pragma once
+
+#include "texture.hpp"
+
+namespace Texture
+{
+// Replaces everything but the first level with a full chain down to 1x1. Every level is a 2x2 box filter
+// of the previous one; odd sizes fold the last row or column into the one before, so no texel is dropped.
+// sRGB colors are averaged in linear space, alpha is always linear.
+void GenerateMipChain(CTextureData& texture);
+}
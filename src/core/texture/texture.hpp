@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace Texture
+{
+enum class ETextureFormat : uint32_t
+{
+    Rgba8Unorm = 0,
+    Rgba8Srgb = 1,
+    // 4x4 blocks of 8 bytes, RGB without alpha
+    Bc1RgbUnorm = 2,
+    Bc1RgbSrgb = 3,
+    // 4x4 blocks of 16 bytes, BC1 color and interpolated alpha
+    Bc3Unorm = 4,
+    Bc3Srgb = 5,
+    // 4x4 blocks of 16 bytes, two interpolated channels, e.g. normal map XY
+    Bc5Unorm = 6,
+    // 4x4 blocks of 16 bytes, RGBA
+    Bc7Unorm = 7,
+    Bc7Srgb = 8,
+};
+
+constexpr bool IsBlockCompressedFormat(const ETextureFormat format) {
+    return format >= ETextureFormat::Bc1RgbUnorm;
+}
+
+constexpr bool IsSrgbFormat(const ETextureFormat format) {
+    switch (format) {
+        case ETextureFormat::Rgba8Srgb:
+        case ETextureFormat::Bc1RgbSrgb:
+        case ETextureFormat::Bc3Srgb:
+        case ETextureFormat::Bc7Srgb:
+            return true;
+        default:
+            return false;
+    }
+}
+
+constexpr std::string_view GetTextureFormatName(const ETextureFormat format) {
+    switch (format) {
+        case ETextureFormat::Rgba8Unorm:
+            return "RGBA8";
+        case ETextureFormat::Rgba8Srgb:
+            return "RGBA8 sRGB";
+        case ETextureFormat::Bc1RgbUnorm:
+            return "BC1";
+        case ETextureFormat::Bc1RgbSrgb:
+            return "BC1 sRGB";
+        case ETextureFormat::Bc3Unorm:
+            return "BC3";
+        case ETextureFormat::Bc3Srgb:
+            return "BC3 sRGB";
+        case ETextureFormat::Bc5Unorm:
+            return "BC5";
+        case ETextureFormat::Bc7Unorm:
+            return "BC7";
+        case ETextureFormat::Bc7Srgb:
+            return "BC7 sRGB";
+    }
+    return "unknown";
+}
+
+// Bytes of a 4x4 block, or of a single texel for uncompressed formats
+constexpr uint32_t GetTextureFormatBlockSize(const ETextureFormat format) {
+    switch (format) {
+        case ETextureFormat::Rgba8Unorm:
+        case ETextureFormat::Rgba8Srgb:
+            return 4;
+        case ETextureFormat::Bc1RgbUnorm:
+        case ETextureFormat::Bc1RgbSrgb:
+            return 8;
+        default:
+            return 16;
+    }
+}
+
+// Compressed levels are padded to whole blocks, down to a single block for the smallest mips
+constexpr uint64_t GetTextureLevelSize(const ETextureFormat format, const uint32_t width, const uint32_t height) {
+    if (!IsBlockCompressedFormat(format)) {
+        return uint64_t { width } * height * GetTextureFormatBlockSize(format);
+    }
+    return uint64_t { (width + 3) / 4 } * ((height + 3) / 4) * GetTextureFormatBlockSize(format);
+}
+
+// Level of a mip chain, rows of texels or blocks are tightly packed
+struct CMipLevel
+{
+    uint32_t width;
+    uint32_t height;
+    std::vector<std::byte> pixels;
+};
+
+// CPU side texture as it comes out of an importer, full resolution level first
+struct CTextureData
+{
+    ETextureFormat format;
+    std::vector<CMipLevel> levels;
+};
+
+// Number of levels in a full chain down to 1x1
+constexpr uint32_t GetMipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t count = 1;
+    for (; width > 1 || height > 1; ++count) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return count;
+}
+}
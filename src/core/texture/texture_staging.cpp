@@ -0,0 +1,61 @@
+#include "texture_staging.hpp"
+
+#include "resourceloader.hpp"
+
+#include <format>
+#include <optional>
+#include <stdexcept>
+
+namespace Texture
+{
+namespace
+{
+uint64_t AlignUp(const uint64_t value, const uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+}
+
+uint64_t LayoutStagedTextures(const std::span<CStagedTexture> textures) {
+    uint64_t size = 0;
+    for (CStagedTexture& texture : textures) {
+        const std::optional<std::size_t> fileSize = resource_loader::GetFileSize(texture.filename);
+        if (!fileSize) {
+            throw std::runtime_error(std::format("Cannot find texture \"{}\"!", texture.filename));
+        }
+
+        texture.offset = AlignUp(size, COOKED_TEXTURE_ALIGNMENT);
+        texture.size = *fileSize;
+        size = texture.offset + texture.size;
+    }
+    return size;
+}
+
+std::vector<CLoadHandle<CCookedTexture>> LoadStagedTextures(
+    const std::span<const CStagedTexture> textures,
+    const std::span<std::byte> staging,
+    const ELoadPriority priority
+) {
+    std::vector<CLoadHandle<CCookedTexture>> loads;
+    loads.reserve(textures.size());
+
+    for (const CStagedTexture& texture : textures) {
+        if (texture.offset > staging.size() || texture.size > staging.size() - texture.offset) {
+            throw std::runtime_error(std::format("Texture \"{}\" doesn't fit into the staging buffer!", texture.filename));
+        }
+
+        const std::span<std::byte> region = staging.subspan(texture.offset, texture.size);
+        loads.push_back(AsyncLoader()->Submit(priority, [filename = texture.filename, region] {
+            if (!resource_loader::ReadFile(filename, region)) {
+                throw std::runtime_error(std::format("Failed to read texture \"{}\"!", filename));
+            }
+
+            CCookedTexture cooked;
+            if (!cooked.Open(region, filename)) {
+                throw std::runtime_error(std::format("Texture \"{}\" is corrupted!", filename));
+            }
+            return cooked;
+        }));
+    }
+    return loads;
+}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "cooked_texture.hpp"
+
+#include "asyncloader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Texture
+{
+// Region of a shared staging allocation that receives one cooked texture file
+struct CStagedTexture
+{
+    // Relative to the application's root, see resource_loader
+    std::string filename;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Sizes every file and places them back to back, each region starting at COOKED_TEXTURE_ALIGNMENT.
+// Returns the staging size all of them need. Throws if a file is missing.
+uint64_t LayoutStagedTextures(std::span<CStagedTexture> textures);
+
+// Reads every file straight into its region of `staging` and opens it in place, so texels never pass through
+// another buffer. There is one load per texture, the I/O threads fill disjoint regions side by side and packed
+// files decompress in parallel blocks. `staging` must stay mapped until the textures are uploaded.
+std::vector<CLoadHandle<CCookedTexture>> LoadStagedTextures(
+    std::span<const CStagedTexture> textures,
+    std::span<std::byte> staging,
+    ELoadPriority priority
+);
+}
@@ -0,0 +1,176 @@
+#include "texture_streaming.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <stdexcept>
+
+namespace Texture
+{
+namespace
+{
+// Keeps the camera inside the bounding sphere from asking for infinite detail
+constexpr float MIN_STREAMING_DISTANCE = 0.01f;
+}
+
+uint32_t SelectTextureLevel(
+    const uint32_t width,
+    const uint32_t height,
+    const uint32_t levelCount,
+    const glm::vec4& boundingSphere,
+    const glm::vec3& cameraPosition,
+    const float fov,
+    const uint32_t viewportHeight
+) {
+    const float distance = std::max(
+        glm::length(glm::vec3(boundingSphere) - cameraPosition) - boundingSphere.w,
+        MIN_STREAMING_DISTANCE
+    );
+
+    const float pixelsPerUnit =
+        static_cast<float>(viewportHeight) / (2.0f * distance * std::tan(glm::radians(fov) * 0.5f));
+    const float projectedSize = std::max(2.0f * boundingSphere.w * pixelsPerUnit, 1.0f);
+
+    // Every coarser level halves the texels landing on one pixel
+    const float texelsPerPixel = static_cast<float>(std::max(width, height)) / projectedSize;
+    if (texelsPerPixel <= STREAMING_TEXELS_PER_PIXEL) {
+        return 0;
+    }
+    const auto level = static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel / STREAMING_TEXELS_PER_PIXEL)));
+    return std::min(level, levelCount - 1);
+}
+
+CTextureStreamer::CTextureStreamer(const uint64_t budget, const uint32_t evictionDelay)
+    : m_budget(budget), m_evictionDelay(evictionDelay) {}
+
+uint32_t CTextureStreamer::Register(const std::span<const uint64_t> levelSizes, const uint32_t tailLevel) {
+    if (levelSizes.empty()) {
+        throw std::runtime_error("Cannot stream a texture without levels!");
+    }
+
+    CStreamedTexture& texture = m_textures.emplace_back();
+    texture.levelSizes.assign(levelSizes.begin(), levelSizes.end());
+    texture.lastNeeded.resize(levelSizes.size());
+    texture.tailLevel = std::min(tailLevel, static_cast<uint32_t>(levelSizes.size() - 1));
+    texture.residentLevel = texture.tailLevel;
+    texture.wantedLevel = texture.tailLevel;
+
+    for (uint32_t level = texture.tailLevel; level < levelSizes.size(); ++level) {
+        m_residentBytes += levelSizes[level];
+    }
+    return static_cast<uint32_t>(m_textures.size() - 1);
+}
+
+void CTextureStreamer::RequestLevel(const uint32_t texture, const uint32_t level, const uint64_t frame) {
+    CStreamedTexture& streamed = m_textures[texture];
+    const uint32_t clamped = std::min(level, streamed.tailLevel);
+
+    streamed.wantedLevel = std::min(streamed.wantedLevel, clamped);
+    for (uint32_t i = clamped; i < streamed.lastNeeded.size(); ++i) {
+        streamed.lastNeeded[i] = frame;
+    }
+}
+
+void CTextureStreamer::Update(
+    const uint64_t frame,
+    const uint32_t maxLoads,
+    std::vector<CStreamingRequest>& loads,
+    std::vector<CStreamingRequest>& releases
+) {
+    std::erase_if(m_pendingReleases, [&](const CPendingRelease& release) {
+        if (frame < release.frame + m_evictionDelay) {
+            return false;
+        }
+        const uint64_t size = m_textures[release.level.texture].levelSizes[release.level.level];
+        m_residentBytes -= size;
+        m_releasingBytes -= size;
+        releases.push_back(release.level);
+        return true;
+    });
+
+    // The budget may have been lowered
+    while (m_residentBytes - m_releasingBytes > m_budget && _EvictOne(frame)) {}
+
+    // Textures furthest from the detail they need go first
+    std::vector<CStreamingRequest> candidates;
+    for (uint32_t i = 0; i < m_textures.size(); ++i) {
+        CStreamedTexture& texture = m_textures[i];
+        if (!texture.loading && texture.wantedLevel < texture.residentLevel) {
+            candidates.push_back({ i, texture.residentLevel - 1 });
+        }
+    }
+    std::ranges::stable_sort(candidates, [&](const CStreamingRequest& a, const CStreamingRequest& b) {
+        return a.level - m_textures[a.texture].wantedLevel > b.level - m_textures[b.texture].wantedLevel;
+    });
+
+    for (const CStreamingRequest& candidate : candidates) {
+        // Evicted a moment ago and still bound, taking the eviction back costs no upload. An index, evicting
+        // below appends to m_pendingReleases.
+        const auto pending = static_cast<std::size_t>(
+            std::ranges::find_if(m_pendingReleases, [&](const CPendingRelease& release) {
+                return release.level.texture == candidate.texture && release.level.level == candidate.level;
+            }) - m_pendingReleases.begin()
+        );
+        const bool cancelRelease = pending < m_pendingReleases.size();
+        if (!cancelRelease && loads.size() >= maxLoads) {
+            continue;
+        }
+
+        const uint64_t size = m_textures[candidate.texture].levelSizes[candidate.level];
+        while (m_residentBytes - m_releasingBytes + size > m_budget && _EvictOne(frame)) {}
+        if (m_residentBytes - m_releasingBytes + size > m_budget) {
+            continue;
+        }
+
+        if (cancelRelease) {
+            m_pendingReleases.erase(m_pendingReleases.begin() + static_cast<std::ptrdiff_t>(pending));
+            m_releasingBytes -= size;
+            m_textures[candidate.texture].residentLevel = candidate.level;
+            continue;
+        }
+
+        m_textures[candidate.texture].loading = true;
+        m_residentBytes += size;
+        loads.push_back(candidate);
+    }
+
+    for (CStreamedTexture& texture : m_textures) {
+        texture.wantedLevel = texture.tailLevel;
+    }
+}
+
+void CTextureStreamer::OnLevelLoaded(const uint32_t texture, const uint32_t level) {
+    CStreamedTexture& streamed = m_textures[texture];
+    if (!streamed.loading || level + 1 != streamed.residentLevel) {
+        throw std::runtime_error(std::format("Level {} of streamed texture {} wasn't requested!", level, texture));
+    }
+    streamed.loading = false;
+    streamed.residentLevel = level;
+}
+
+bool CTextureStreamer::_EvictOne(const uint64_t frame) {
+    // Only the finest resident level of a texture can go, the rest of its chain stays sampleable
+    CStreamedTexture* victim = nullptr;
+    uint32_t victimIndex = 0;
+    for (uint32_t i = 0; i < m_textures.size(); ++i) {
+        CStreamedTexture& texture = m_textures[i];
+        if (texture.loading || texture.residentLevel >= texture.tailLevel ||
+            texture.lastNeeded[texture.residentLevel] >= frame) {
+            continue;
+        }
+        if (victim == nullptr ||
+            texture.lastNeeded[texture.residentLevel] < victim->lastNeeded[victim->residentLevel]) {
+            victim = &texture;
+            victimIndex = i;
+        }
+    }
+    if (victim == nullptr) {
+        return false;
+    }
+
+    m_pendingReleases.push_back({ { victimIndex, victim->residentLevel }, frame });
+    m_releasingBytes += victim->levelSizes[victim->residentLevel];
+    ++victim->residentLevel;
+    return true;
+}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Texture
+{
+// Texels of the finest level that land on one pixel before a coarser level is enough
+constexpr float STREAMING_TEXELS_PER_PIXEL = 1.0f;
+
+// Finest level an object needs, from the screen-space size of its bounding sphere. Assumes the texture
+// is stretched once over the object, which is how sampler feedback would see a typical unwrapped mesh.
+// `fov` is the vertical field of view in degrees.
+uint32_t SelectTextureLevel(
+    uint32_t width,
+    uint32_t height,
+    uint32_t levelCount,
+    const glm::vec4& boundingSphere,
+    const glm::vec3& cameraPosition,
+    float fov,
+    uint32_t viewportHeight
+);
+
+// Level of one texture the streamer wants uploaded or released
+struct CStreamingRequest
+{
+    uint32_t texture;
+    uint32_t level;
+};
+
+// Decides which mips are resident, doesn't touch the GPU itself. Levels from the mip tail down are
+// resident for the whole lifetime of a texture, finer levels are loaded one at a time coarse to fine
+// and evicted fine to coarse, so resident levels of a texture are always a contiguous chain that
+// sampling can be clamped to with GetMinLod.
+class CTextureStreamer
+{
+public:
+    // `evictionDelay` is the number of frames an evicted level may still be sampled by frames in flight
+    CTextureStreamer(uint64_t budget, uint32_t evictionDelay);
+
+    // `levelSizes` are bytes each level occupies on the GPU, full resolution first. Levels from `tailLevel`
+    // on are considered uploaded already. Returns the texture id.
+    uint32_t Register(std::span<const uint64_t> levelSizes, uint32_t tailLevel);
+
+    // Bytes of streamed and tail levels together, tails are never evicted even if they exceed the budget.
+    // Evicted levels still count towards GetResidentBytes until they are released, but not towards the budget.
+    void SetBudget(uint64_t budget) { m_budget = budget; }
+    [[nodiscard]] uint64_t GetBudget() const { return m_budget; }
+    // Including loads in flight and evicted levels that are still waiting for their delay
+    [[nodiscard]] uint64_t GetResidentBytes() const { return m_residentBytes; }
+
+    // Marks `level` and everything coarser as needed this frame
+    void RequestLevel(uint32_t texture, uint32_t level, uint64_t frame);
+
+    // Call once per frame after the requests. `loads` receives levels to start uploading, at most
+    // `maxLoads` of them, `releases` receives evicted levels whose memory can be freed now.
+    void Update(
+        uint64_t frame,
+        uint32_t maxLoads,
+        std::vector<CStreamingRequest>& loads,
+        std::vector<CStreamingRequest>& releases
+    );
+
+    // The upload of a level returned by Update is done, it can be sampled from the next frame
+    void OnLevelLoaded(uint32_t texture, uint32_t level);
+
+    // Finest level that can be sampled
+    [[nodiscard]] uint32_t GetMinLod(uint32_t texture) const { return m_textures[texture].residentLevel; }
+
+private:
+    struct CStreamedTexture
+    {
+        std::vector<uint64_t> levelSizes;
+        // Frame each level was last requested in
+        std::vector<uint64_t> lastNeeded;
+        uint32_t tailLevel = 0;
+        // Finest resident level
+        uint32_t residentLevel = 0;
+        // Finest level requested since the last Update
+        uint32_t wantedLevel = 0;
+        bool loading = false;
+    };
+
+    struct CPendingRelease
+    {
+        CStreamingRequest level;
+        uint64_t frame;
+    };
+
+    // Evicts the least recently needed level that wasn't needed this frame.
+    // Returns false if there is nothing to evict.
+    bool _EvictOne(uint64_t frame);
+
+    uint64_t m_budget = 0;
+    uint32_t m_evictionDelay = 0;
+    uint64_t m_residentBytes = 0;
+    // Part of m_residentBytes waiting in m_pendingReleases
+    uint64_t m_releasingBytes = 0;
+    std::vector<CStreamedTexture> m_textures;
+    std::vector<CPendingRelease> m_pendingReleases;
+};
+}
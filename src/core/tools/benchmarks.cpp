@@ -0,0 +1,366 @@
+#include "benchmarks.hpp"
+
+#include "../mesh/obj_importer.hpp"
+#include "../mesh/vertex_weld.hpp"
+#include "../texture/block_compression.hpp"
+#include "../texture/image_importer.hpp"
+
+#include "compression.hpp"
+#include "console.hpp"
+#include "mappedfile.hpp"
+#include "packfile.hpp"
+#include "threadpool.hpp"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+#include <tiny_obj_loader.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+// Hash the renderer used to weld vertices before CVertexWeldTable, kept for the reference paths
+template <>
+struct std::hash<CVertex>
+{
+    size_t operator()(CVertex const& vertex) const {
+        return (hash<glm::vec3>()(vertex.pos) >> 1) ^ (hash<glm::vec2>()(vertex.texCoord) << 1);
+    }
+};
+
+namespace Tools
+{
+namespace
+{
+template <typename F>
+double MeasureMilliseconds(F&& function) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Import path the renderer used before the native importer, kept as the reference
+Mesh::CMeshData ImportObjWithTinyObj(const std::filesystem::path& path) {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.string().c_str())) {
+        throw std::runtime_error(warn + err);
+    }
+
+    Mesh::CMeshData mesh;
+    std::unordered_map<CVertex, uint32_t> uniqueVertices {};
+
+    for (const auto& shape : shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            CVertex vertex {};
+
+            vertex.pos = {
+                attrib.vertices[3 * index.vertex_index + 0],
+                attrib.vertices[3 * index.vertex_index + 1],
+                attrib.vertices[3 * index.vertex_index + 2]
+            };
+
+            vertex.texCoord = {
+                attrib.texcoords[2 * index.texcoord_index + 0],
+                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+            };
+
+            if (uniqueVertices.count(vertex) == 0) {
+                uniqueVertices[vertex] = static_cast<uint32_t>(mesh.vertices.size());
+                mesh.vertices.push_back(vertex);
+            }
+
+            mesh.indices.push_back(uniqueVertices[vertex]);
+        }
+    }
+
+    return mesh;
+}
+
+// Writes a textured grid of quads roughly `megabytes` large
+void WriteSyntheticObj(const std::filesystem::path& path, const std::size_t megabytes) {
+    // A grid vertex costs about 90 bytes of text: "v", "vt" and its share of an "f" line
+    const auto side = static_cast<std::size_t>(std::sqrt(static_cast<double>(megabytes) * 1024 * 1024 / 90.0)) + 2;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error(std::format("Cannot open \"{}\" for writing!", path.string()));
+    }
+
+    std::string line;
+    for (std::size_t y = 0; y < side; ++y) {
+        for (std::size_t x = 0; x < side; ++x) {
+            const float u = static_cast<float>(x) / static_cast<float>(side - 1);
+            const float v = static_cast<float>(y) / static_cast<float>(side - 1);
+            line = std::format("v {:.6f} {:.6f} {:.6f}\nvt {:.6f} {:.6f}\n", u, v, std::sin(u * 20.0f) * 0.1f, u, v);
+            file.write(line.data(), static_cast<std::streamsize>(line.size()));
+        }
+    }
+
+    for (std::size_t y = 0; y + 1 < side; ++y) {
+        for (std::size_t x = 0; x + 1 < side; ++x) {
+            const std::size_t a = y * side + x + 1;
+            const std::size_t b = a + 1;
+            const std::size_t c = a + side + 1;
+            const std::size_t d = a + side;
+            line = std::format("f {0}/{0} {1}/{1} {2}/{2} {3}/{3}\n", a, b, c, d);
+            file.write(line.data(), static_cast<std::streamsize>(line.size()));
+        }
+    }
+
+    if (!file) {
+        throw std::runtime_error(std::format("Failed to write \"{}\"!", path.string()));
+    }
+}
+
+// Expands an indexed mesh back into the per-corner vertex stream the importer welds
+std::vector<CVertex> UnweldVertices(const Mesh::CMeshData& mesh) {
+    std::vector<CVertex> corners;
+    corners.reserve(mesh.indices.size());
+    for (const uint32_t index : mesh.indices) {
+        corners.push_back(mesh.vertices[index]);
+    }
+    return corners;
+}
+
+void CompareVertexWelding(const std::filesystem::path& path) {
+    const std::vector<CVertex> corners = UnweldVertices(Mesh::ImportObj(path));
+    Msg("{} ({} corners)", path.string(), corners.size());
+
+    Mesh::CMeshData reference;
+    const double referenceTime = MeasureMilliseconds([&] {
+        std::unordered_map<CVertex, uint32_t> uniqueVertices {};
+        for (const CVertex& vertex : corners) {
+            if (uniqueVertices.count(vertex) == 0) {
+                uniqueVertices[vertex] = static_cast<uint32_t>(reference.vertices.size());
+                reference.vertices.push_back(vertex);
+            }
+            reference.indices.push_back(uniqueVertices[vertex]);
+        }
+    });
+    Msg(
+        "    unordered_map: {:>10.1f} ms {:>8.1f} Mcorners/s  {} vertices",
+        referenceTime,
+        static_cast<double>(corners.size()) / (referenceTime * 1000.0),
+        reference.vertices.size()
+    );
+
+    Mesh::CMeshData welded;
+    const double weldTime = MeasureMilliseconds([&] {
+        Mesh::CVertexWeldTable<CVertex> weldTable(corners.size() / 3);
+        welded.indices.reserve(corners.size());
+        for (const CVertex& vertex : corners) {
+            welded.indices.push_back(weldTable.Insert(vertex, welded.vertices));
+        }
+    });
+    Msg(
+        "    weld table:    {:>10.1f} ms {:>8.1f} Mcorners/s  {} vertices",
+        weldTime,
+        static_cast<double>(corners.size()) / (weldTime * 1000.0),
+        welded.vertices.size()
+    );
+    Msg("    speed-up:      {:>10.2f}x", referenceTime / weldTime);
+
+    if (welded.vertices.size() != reference.vertices.size() || welded.indices != reference.indices) {
+        Warning("    weld table result differs from unordered_map!");
+    }
+}
+
+void MeasureDecompression(const std::filesystem::path& path) {
+    CMappedFile file;
+    if (!file.Open(path, EMappedFileAccess::Sequential)) {
+        throw std::runtime_error(std::format("Cannot open \"{}\"!", path.string()));
+    }
+    const std::span<const std::byte> data = file.GetView();
+    const double megabytes = static_cast<double>(data.size()) / (1024.0 * 1024.0);
+    const std::size_t blockCount = (data.size() + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE;
+    Msg("{} ({:.1f} MB, {} blocks of {} KB)", path.string(), megabytes, blockCount, PACK_BLOCK_SIZE / 1024);
+
+    const auto getBlock = [&](const std::span<std::byte> buffer, const std::size_t i) {
+        return buffer.subspan(i * PACK_BLOCK_SIZE).first(std::min<std::size_t>(PACK_BLOCK_SIZE, buffer.size() - i * PACK_BLOCK_SIZE));
+    };
+    const auto getSourceBlock = [&](const std::size_t i) {
+        return data.subspan(i * PACK_BLOCK_SIZE).first(std::min<std::size_t>(PACK_BLOCK_SIZE, data.size() - i * PACK_BLOCK_SIZE));
+    };
+
+    std::vector<std::vector<std::byte>> blocks(blockCount);
+    const double compressTime = MeasureMilliseconds([&] {
+        ThreadPool()->ParallelFor(blockCount, [&](const std::size_t i) {
+            blocks[i].resize(compression::GetMaxCompressedSize(getSourceBlock(i).size()));
+            blocks[i].resize(compression::CompressBlock(getSourceBlock(i), blocks[i]));
+        });
+    });
+    std::size_t compressedSize = 0;
+    for (const std::vector<std::byte>& block : blocks) {
+        compressedSize += block.size();
+    }
+    Msg(
+        "    compress, {:>2} threads: {:>8.1f} ms {:>8.1f} MB/s  ratio {:.2f}",
+        ThreadPool()->GetThreadCount() + 1,
+        compressTime,
+        megabytes / (compressTime / 1000.0),
+        static_cast<double>(data.size()) / static_cast<double>(compressedSize)
+    );
+
+    // Destination stands in for a staging buffer, touched once so page faults don't count
+    std::vector<std::byte> destination(data.size());
+
+    const double copyTime = MeasureMilliseconds([&] { std::memcpy(destination.data(), data.data(), data.size()); });
+    Msg("    memcpy:                {:>8.1f} ms {:>8.1f} MB/s", copyTime, megabytes / (copyTime / 1000.0));
+
+    std::atomic<bool> corrupted = false;
+    const double singleTime = MeasureMilliseconds([&] {
+        for (std::size_t i = 0; i < blockCount; ++i) {
+            if (!compression::DecompressBlock(blocks[i], getBlock(destination, i))) {
+                corrupted = true;
+            }
+        }
+    });
+    Msg("    decompress, 1 thread:  {:>8.1f} ms {:>8.1f} MB/s", singleTime, megabytes / (singleTime / 1000.0));
+
+    const double parallelTime = MeasureMilliseconds([&] {
+        ThreadPool()->ParallelFor(blockCount, [&](const std::size_t i) {
+            if (!compression::DecompressBlock(blocks[i], getBlock(destination, i))) {
+                corrupted = true;
+            }
+        });
+    });
+    Msg(
+        "    decompress, {:>2} threads:{:>8.1f} ms {:>8.1f} MB/s",
+        ThreadPool()->GetThreadCount() + 1,
+        parallelTime,
+        megabytes / (parallelTime / 1000.0)
+    );
+
+    if (corrupted || std::memcmp(destination.data(), data.data(), data.size()) != 0) {
+        Warning("    decompressed data differs from the source!");
+    }
+}
+
+// Smooth gradients with a band of noise, the mix of easy and hard blocks found in real textures
+Texture::CTextureData GenerateSyntheticTexture(const uint32_t size) {
+    Texture::CMipLevel level { size, size, std::vector<std::byte>(std::size_t { size } * size * 4) };
+    uint32_t noise = 0x12345678;
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            noise = noise * 1664525 + 1013904223;
+            const bool noisy = (y / 64) % 4 == 0;
+            std::byte* texel = level.pixels.data() + (std::size_t { y } * size + x) * 4;
+            texel[0] = static_cast<std::byte>(noisy ? noise >> 24 : x * 255 / size);
+            texel[1] = static_cast<std::byte>(y * 255 / size);
+            texel[2] = static_cast<std::byte>(128 + 127 * std::sin(static_cast<float>(x + y) * 0.02f));
+            texel[3] = static_cast<std::byte>(255);
+        }
+    }
+    return { Texture::ETextureFormat::Rgba8Srgb, { std::move(level) } };
+}
+
+void MeasureBlockCompression(const std::string_view name, const Texture::CTextureData& source) {
+    const Texture::CMipLevel& level = source.levels[0];
+    const double megapixels = static_cast<double>(level.width) * level.height / 1'000'000.0;
+    Msg("{} ({}x{}, {} threads)", name, level.width, level.height, ThreadPool()->GetThreadCount() + 1);
+
+    constexpr Texture::ETextureCompression COMPRESSIONS[] = {
+        Texture::ETextureCompression::Bc1,
+        Texture::ETextureCompression::Bc3,
+        Texture::ETextureCompression::Bc5,
+        Texture::ETextureCompression::Bc7,
+    };
+    constexpr std::pair<Texture::ETextureQuality, std::string_view> QUALITIES[] = {
+        { Texture::ETextureQuality::Fast, "fast" },
+        { Texture::ETextureQuality::Normal, "normal" },
+        { Texture::ETextureQuality::High, "high" },
+    };
+
+    for (const Texture::ETextureCompression compression : COMPRESSIONS) {
+        for (const auto& [quality, qualityName] : QUALITIES) {
+            Texture::CTextureData texture = source;
+            double meanSquaredError = 0.0;
+            const double time = MeasureMilliseconds([&] {
+                meanSquaredError = Texture::CompressTexture(texture, compression, quality);
+            });
+            Msg(
+                "    {:<8} {:<6}: {:>8.1f} ms {:>8.1f} MPix/s  RMSE {:>5.2f}  PSNR {:>5.2f} dB  {} -> {} bytes",
+                Texture::GetTextureFormatName(texture.format),
+                qualityName,
+                time,
+                megapixels / (time / 1000.0),
+                std::sqrt(meanSquaredError),
+                10.0 * std::log10(255.0 * 255.0 / std::max(meanSquaredError, 1e-9)),
+                level.pixels.size(),
+                texture.levels[0].pixels.size()
+            );
+        }
+    }
+}
+
+void CompareObjImporters(const std::filesystem::path& path) {
+    const double megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+    Msg("{} ({:.1f} MB)", path.string(), megabytes);
+
+    Mesh::CMeshData reference;
+    const double referenceTime = MeasureMilliseconds([&] { reference = ImportObjWithTinyObj(path); });
+    Msg(
+        "    tinyobjloader: {:>10.1f} ms {:>8.1f} MB/s  {} vertices, {} indices",
+        referenceTime,
+        megabytes / (referenceTime / 1000.0),
+        reference.vertices.size(),
+        reference.indices.size()
+    );
+    reference = {};
+
+    Mesh::CMeshData native;
+    const double nativeTime = MeasureMilliseconds([&] { native = Mesh::ImportObj(path); });
+    Msg(
+        "    native:        {:>10.1f} ms {:>8.1f} MB/s  {} vertices, {} indices",
+        nativeTime,
+        megabytes / (nativeTime / 1000.0),
+        native.vertices.size(),
+        native.indices.size()
+    );
+    Msg("    speed-up:      {:>10.2f}x", referenceTime / nativeTime);
+}
+}
+
+void BenchmarkObjImport(const std::filesystem::path& assetPath, const std::size_t syntheticMegabytes) {
+    CompareObjImporters(assetPath);
+
+    const std::filesystem::path syntheticPath = std::filesystem::temp_directory_path() / "skylabs_synthetic.obj";
+    Msg("Generating synthetic OBJ...");
+    WriteSyntheticObj(syntheticPath, syntheticMegabytes);
+    CompareObjImporters(syntheticPath);
+    std::filesystem::remove(syntheticPath);
+}
+
+void BenchmarkVertexWeld(const std::filesystem::path& assetPath, const std::size_t syntheticMegabytes) {
+    CompareVertexWelding(assetPath);
+
+    const std::filesystem::path syntheticPath = std::filesystem::temp_directory_path() / "skylabs_synthetic.obj";
+    Msg("Generating synthetic OBJ...");
+    WriteSyntheticObj(syntheticPath, syntheticMegabytes);
+    CompareVertexWelding(syntheticPath);
+    std::filesystem::remove(syntheticPath);
+}
+
+void BenchmarkDecompression(const std::filesystem::path& assetPath, const std::size_t syntheticMegabytes) {
+    MeasureDecompression(assetPath);
+
+    const std::filesystem::path syntheticPath = std::filesystem::temp_directory_path() / "skylabs_synthetic.obj";
+    Msg("Generating synthetic OBJ...");
+    WriteSyntheticObj(syntheticPath, syntheticMegabytes);
+    MeasureDecompression(syntheticPath);
+    std::filesystem::remove(syntheticPath);
+}
+
+void BenchmarkBlockCompression(const std::filesystem::path& assetPath, const uint32_t syntheticSize) {
+    MeasureBlockCompression(assetPath.string(), Texture::ImportImage(assetPath, Texture::ETextureFormat::Rgba8Srgb));
+    MeasureBlockCompression("synthetic", GenerateSyntheticTexture(syntheticSize));
+}
+}
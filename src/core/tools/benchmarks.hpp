@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace Tools
+{
+// Compares the native OBJ importer with tinyobjloader on an asset and on a generated OBJ
+void BenchmarkObjImport(const std::filesystem::path& assetPath, std::size_t syntheticMegabytes);
+
+// Compares CVertexWeldTable with the std::unordered_map welding it replaced
+void BenchmarkVertexWeld(const std::filesystem::path& assetPath, std::size_t syntheticMegabytes);
+
+// Measures pack block compression and decompression in MB/s, on one thread and spread over ThreadPool()
+void BenchmarkDecompression(const std::filesystem::path& assetPath, std::size_t syntheticMegabytes);
+
+// Encodes an image and a generated one with every BCn format and quality preset, reports speed and error
+void BenchmarkBlockCompression(const std::filesystem::path& assetPath, uint32_t syntheticSize);
+}
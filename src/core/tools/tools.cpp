@@ -0,0 +1,215 @@
+#include "tools.hpp"
+
+#include "benchmarks.hpp"
+#include "../mesh/cooked_mesh.hpp"
+#include "../texture/cooked_texture.hpp"
+
+#include "commandline.hpp"
+#include "packfile.hpp"
+
+#include <charconv>
+#include <format>
+#include <stdexcept>
+
+namespace Tools
+{
+namespace
+{
+EVertexFormat ParseVertexFormat(const std::string_view name) {
+    if (name == "float") {
+        return EVertexFormat::Float;
+    }
+    if (name == "half") {
+        return EVertexFormat::Half;
+    }
+    if (name == "snorm16") {
+        return EVertexFormat::Snorm16;
+    }
+    throw std::runtime_error(std::format("Unknown vertex format \"{}\", expected float, half or snorm16", name));
+}
+
+Texture::ETextureCompression ParseTextureCompression(const std::string_view name) {
+    if (name == "rgba8") {
+        return Texture::ETextureCompression::None;
+    }
+    if (name == "bc1") {
+        return Texture::ETextureCompression::Bc1;
+    }
+    if (name == "bc3") {
+        return Texture::ETextureCompression::Bc3;
+    }
+    if (name == "bc5") {
+        return Texture::ETextureCompression::Bc5;
+    }
+    if (name == "bc7") {
+        return Texture::ETextureCompression::Bc7;
+    }
+    throw std::runtime_error(std::format("Unknown texture format \"{}\", expected rgba8, bc1, bc3, bc5 or bc7", name));
+}
+
+Texture::ETextureQuality ParseTextureQuality(const std::string_view name) {
+    if (name == "fast") {
+        return Texture::ETextureQuality::Fast;
+    }
+    if (name == "normal") {
+        return Texture::ETextureQuality::Normal;
+    }
+    if (name == "high") {
+        return Texture::ETextureQuality::High;
+    }
+    throw std::runtime_error(std::format("Unknown texture quality \"{}\", expected fast, normal or high", name));
+}
+
+// -cook <source.obj> <destination> [-no_overdraw] [-no_meshlets] [-lods N] [-vertex_format float|half|snorm16]
+void CookMeshTool(const int param) {
+    const std::string_view source = CommandLine()->GetParam(param + 1);
+    const std::string_view destination = CommandLine()->GetParam(param + 2);
+    if (source.empty() || destination.empty()) {
+        throw std::runtime_error(
+            "Usage: -cook <source.obj> <destination> [-no_overdraw] [-no_meshlets] [-lods N] [-vertex_format float|half|snorm16]"
+        );
+    }
+
+    Mesh::CMeshCookOptions options {};
+    options.optimizeOverdraw = CommandLine()->FindParam("-no_overdraw") == 0;
+    options.buildMeshlets = CommandLine()->FindParam("-no_meshlets") == 0;
+    if (const int lodsParam = CommandLine()->FindParam("-lods")) {
+        const std::string_view lods = CommandLine()->GetParam(lodsParam + 1);
+        std::from_chars(lods.data(), lods.data() + lods.size(), options.lodCount);
+    }
+    if (const int formatParam = CommandLine()->FindParam("-vertex_format")) {
+        options.vertexFormat = ParseVertexFormat(CommandLine()->GetParam(formatParam + 1));
+    }
+    Mesh::CookMesh(source, destination, options);
+}
+
+// -cook_texture <source image> <destination> [-linear] [-no_mips] [-format rgba8|bc1|bc3|bc5|bc7] [-quality fast|normal|high]
+void CookTextureTool(const int param) {
+    const std::string_view source = CommandLine()->GetParam(param + 1);
+    const std::string_view destination = CommandLine()->GetParam(param + 2);
+    if (source.empty() || destination.empty()) {
+        throw std::runtime_error(
+            "Usage: -cook_texture <source image> <destination> [-linear] [-no_mips] [-format rgba8|bc1|bc3|bc5|bc7] "
+            "[-quality fast|normal|high]"
+        );
+    }
+
+    Texture::CTextureCookOptions options {};
+    options.srgb = CommandLine()->FindParam("-linear") == 0;
+    options.generateMips = CommandLine()->FindParam("-no_mips") == 0;
+    if (const int formatParam = CommandLine()->FindParam("-format")) {
+        options.compression = ParseTextureCompression(CommandLine()->GetParam(formatParam + 1));
+    }
+    if (const int qualityParam = CommandLine()->FindParam("-quality")) {
+        options.quality = ParseTextureQuality(CommandLine()->GetParam(qualityParam + 1));
+    }
+    Texture::CookTexture(source, destination, options);
+}
+
+// -pack <source directory> <destination.pack> [-no_compress]
+void PackTool(const int param) {
+    const std::string_view source = CommandLine()->GetParam(param + 1);
+    const std::string_view destination = CommandLine()->GetParam(param + 2);
+    if (source.empty() || destination.empty()) {
+        throw std::runtime_error("Usage: -pack <source directory> <destination.pack> [-no_compress]");
+    }
+
+    pack_file::Build(source, destination, CommandLine()->FindParam("-no_compress") == 0);
+}
+
+// -bench_obj [asset.obj] [synthetic size in MB]
+void BenchmarkObjTool(const int param) {
+    std::string_view assetPath = CommandLine()->GetParam(param + 1);
+    if (assetPath.empty()) {
+        assetPath = "viking_room.obj";
+    }
+
+    std::size_t syntheticMegabytes = 300;
+    const std::string_view size = CommandLine()->GetParam(param + 2);
+    std::from_chars(size.data(), size.data() + size.size(), syntheticMegabytes);
+
+    BenchmarkObjImport(assetPath, syntheticMegabytes);
+}
+
+// -bench_weld [asset.obj] [synthetic size in MB]
+void BenchmarkWeldTool(const int param) {
+    std::string_view assetPath = CommandLine()->GetParam(param + 1);
+    if (assetPath.empty()) {
+        assetPath = "viking_room.obj";
+    }
+
+    std::size_t syntheticMegabytes = 100;
+    const std::string_view size = CommandLine()->GetParam(param + 2);
+    std::from_chars(size.data(), size.data() + size.size(), syntheticMegabytes);
+
+    BenchmarkVertexWeld(assetPath, syntheticMegabytes);
+}
+
+// -bench_lz [asset.obj] [synthetic size in MB]
+void BenchmarkDecompressionTool(const int param) {
+    std::string_view assetPath = CommandLine()->GetParam(param + 1);
+    if (assetPath.empty()) {
+        assetPath = "viking_room.obj";
+    }
+
+    std::size_t syntheticMegabytes = 100;
+    const std::string_view size = CommandLine()->GetParam(param + 2);
+    std::from_chars(size.data(), size.data() + size.size(), syntheticMegabytes);
+
+    BenchmarkDecompression(assetPath, syntheticMegabytes);
+}
+
+// -bench_bc [image] [synthetic size in texels]
+void BenchmarkBlockCompressionTool(const int param) {
+    std::string_view assetPath = CommandLine()->GetParam(param + 1);
+    if (assetPath.empty()) {
+        assetPath = "viking_room.png";
+    }
+
+    uint32_t syntheticSize = 2048;
+    const std::string_view size = CommandLine()->GetParam(param + 2);
+    std::from_chars(size.data(), size.data() + size.size(), syntheticSize);
+
+    BenchmarkBlockCompression(assetPath, syntheticSize);
+}
+}
+
+bool Run() {
+    if (const int param = CommandLine()->FindParam("-cook")) {
+        CookMeshTool(param);
+        return true;
+    }
+
+    if (const int param = CommandLine()->FindParam("-cook_texture")) {
+        CookTextureTool(param);
+        return true;
+    }
+
+    if (const int param = CommandLine()->FindParam("-pack")) {
+        PackTool(param);
+        return true;
+    }
+
+    if (const int param = CommandLine()->FindParam("-bench_obj")) {
+        BenchmarkObjTool(param);
+        return true;
+    }
+
+    if (const int param = CommandLine()->FindParam("-bench_weld")) {
+        BenchmarkWeldTool(param);
+        return true;
+    }
+
+    if (const int param = CommandLine()->FindParam("-bench_lz")) {
+        BenchmarkDecompressionTool(param);
+        return true;
+    }
+
+    if (const int param = CommandLine()->FindParam("-bench_bc")) {
+        BenchmarkBlockCompressionTool(param);
+        return true;
+    }
+
+    return false;
+}
+}
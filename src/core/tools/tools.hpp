@@ -0,0 +1,7 @@
+#pragma once
+
+namespace Tools
+{
+// Runs an offline tool requested on the command line. Returns false if none was requested.
+bool Run();
+}
@@ -0,0 +1,115 @@
+#include "asyncloader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CAsyncLoader final : public IAsyncLoader
+{
+public:
+    explicit CAsyncLoader(std::size_t threadCount);
+    CAsyncLoader(const CAsyncLoader&) = delete;
+    CAsyncLoader(CAsyncLoader&&) = delete;
+    CAsyncLoader& operator=(const CAsyncLoader&) = delete;
+    CAsyncLoader& operator=(CAsyncLoader&&) = delete;
+    ~CAsyncLoader() override;
+
+    void Enqueue(ELoadPriority priority, std::function<void()> task) override;
+    void Post(std::function<void()> callback) override;
+    std::size_t DispatchCallbacks() override;
+    [[nodiscard]] std::size_t GetThreadCount() const override { return m_threads.size(); }
+
+private:
+    void _WorkerMain();
+
+    std::vector<std::thread> m_threads;
+    std::array<std::deque<std::function<void()>>, static_cast<std::size_t>(ELoadPriority::Count)> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop = false;
+
+    std::vector<std::function<void()>> m_callbacks;
+    std::mutex m_callbackMutex;
+};
+
+PLATFORM_INTERFACE IAsyncLoader* AsyncLoader() {
+    // Enough to keep a few requests in flight on an SSD, more threads only add seeks on an HDD
+    static CAsyncLoader loader(2);
+    return &loader;
+}
+
+CAsyncLoader::CAsyncLoader(const std::size_t threadCount) {
+    m_threads.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&CAsyncLoader::_WorkerMain, this);
+    }
+}
+
+CAsyncLoader::~CAsyncLoader() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+        // Nobody is going to wait for queued loads anymore
+        for (auto& tasks : m_tasks) {
+            tasks.clear();
+        }
+    }
+    m_condition.notify_all();
+
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void CAsyncLoader::Enqueue(const ELoadPriority priority, std::function<void()> task) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks[static_cast<std::size_t>(priority)].push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void CAsyncLoader::Post(std::function<void()> callback) {
+    std::lock_guard lock(m_callbackMutex);
+    m_callbacks.push_back(std::move(callback));
+}
+
+std::size_t CAsyncLoader::DispatchCallbacks() {
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard lock(m_callbackMutex);
+        callbacks.swap(m_callbacks);
+    }
+
+    // Callbacks may start new loads, those get dispatched next time
+    for (const std::function<void()>& callback : callbacks) {
+        callback();
+    }
+    return callbacks.size();
+}
+
+void CAsyncLoader::_WorkerMain() {
+    auto hasTasks = [this] {
+        return std::ranges::any_of(m_tasks, [](const auto& tasks) { return !tasks.empty(); });
+    };
+
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [&] { return m_stop || hasTasks(); });
+            if (m_stop) {
+                return;
+            }
+
+            auto tasks = std::ranges::find_if(m_tasks, [](const auto& tasks) { return !tasks.empty(); });
+            task = std::move(tasks->front());
+            tasks->pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include "publicapi.hpp"
+#include "resourceloader.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <format>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Queued loads of a higher class always start before loads of a lower one
+enum class ELoadPriority : uint8_t
+{
+    // Blocks the current frame, e.g. a shader needed to build a pipeline right now
+    Critical = 0,
+    // Needed before the first frame
+    Startup = 1,
+    // Streamed in while the game is running
+    Background = 2,
+    Count
+};
+
+class IAsyncLoader;
+
+// Not deduced, so any callable can be passed where a callback is expected
+template <typename T>
+using CLoadCallback = std::type_identity_t<std::function<void(const T&)>>;
+
+namespace async_loader_detail {
+
+    template <typename T>
+    struct CLoadState : std::enable_shared_from_this<CLoadState<T>>
+    {
+        IAsyncLoader* loader = nullptr;
+        std::function<T()> job;
+        CLoadCallback<T> onLoaded;
+
+        std::atomic<bool> started = false;
+        std::atomic<bool> cancelled = false;
+        std::optional<T> value;
+        std::exception_ptr error;
+        // Becomes ready once value or error is set
+        std::promise<void> promise;
+        std::shared_future<void> finished;
+
+        const T& GetValue() const {
+            finished.wait();
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return *value;
+        }
+
+        // Whoever gets here first runs the job, returns false if it was taken already
+        bool Run();
+    };
+
+} // async_loader_detail
+
+// Shared handle to a load, copies refer to the same request
+template <typename T>
+class CLoadHandle
+{
+public:
+    CLoadHandle() = default;
+
+    [[nodiscard]] bool IsValid() const { return m_state != nullptr; }
+
+    // Finished, failed or cancelled
+    [[nodiscard]] bool IsReady() const {
+        return m_state->finished.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // The completion callback won't run after this. Returns false if the load has already started,
+    // its result is then still available through Get.
+    bool Cancel();
+
+    // Waits for the result. A load still sitting in the queue runs on the calling thread instead,
+    // so waiting on a background load never stalls behind the whole queue.
+    // Throws if the load failed or was cancelled.
+    const T& Get();
+    // Same as Get, but moves the result out of the request. Don't use together with a completion callback.
+    T Take() { return std::move(const_cast<T&>(Get())); }
+
+private:
+    friend class IAsyncLoader;
+
+    std::shared_ptr<async_loader_detail::CLoadState<T>> m_state;
+};
+
+// Small pool of threads that mostly wait on the disk, separate from ThreadPool() so file reads
+// never occupy CPU workers
+class IAsyncLoader
+{
+public:
+    IAsyncLoader() = default;
+    IAsyncLoader(const IAsyncLoader&) = delete;
+    IAsyncLoader(IAsyncLoader&&) = delete;
+    IAsyncLoader& operator=(const IAsyncLoader&) = delete;
+    IAsyncLoader& operator=(IAsyncLoader&&) = delete;
+    virtual ~IAsyncLoader() = default;
+
+    virtual void Enqueue(ELoadPriority priority, std::function<void()> task) = 0;
+    // Queues a callback for the next DispatchCallbacks call
+    virtual void Post(std::function<void()> callback) = 0;
+    // Runs completion callbacks of finished loads, call once per frame from the main thread.
+    // Returns the number of callbacks run.
+    virtual std::size_t DispatchCallbacks() = 0;
+    [[nodiscard]] virtual std::size_t GetThreadCount() const = 0;
+
+    // Runs `job` on an I/O thread. `onLoaded` runs from DispatchCallbacks if the job succeeded
+    // and the load wasn't cancelled.
+    template <typename F, typename T = std::invoke_result_t<F>>
+    CLoadHandle<T> Submit(ELoadPriority priority, F&& job, CLoadCallback<T> onLoaded = {});
+
+    // Maps a file from the application's root and reads it in on an I/O thread, see resource_loader::MapFile
+    CLoadHandle<CMappedFile> LoadFile(
+        std::string_view filename,
+        ELoadPriority priority,
+        std::function<void(const CMappedFile&)> onLoaded = {}
+    );
+
+    // Maps a file on an I/O thread and converts it with decode(CMappedFile&) there too
+    template <typename F, typename T = std::invoke_result_t<F, CMappedFile&>>
+        requires (!std::is_void_v<T>)
+    CLoadHandle<T> LoadFile(
+        std::string_view filename,
+        ELoadPriority priority,
+        F&& decode,
+        CLoadCallback<T> onLoaded = {}
+    );
+
+private:
+    // Touches every page so the first access on the main thread doesn't fault on disk I/O
+    static void _FaultIn(const CMappedFile& file);
+};
+
+template <typename T>
+bool async_loader_detail::CLoadState<T>::Run() {
+    if (started.exchange(true)) {
+        return false;
+    }
+
+    if (cancelled) {
+        error = std::make_exception_ptr(std::runtime_error("Load was cancelled"));
+    } else {
+        try {
+            value.emplace(job());
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+    job = nullptr;
+    promise.set_value();
+
+    if (value && onLoaded) {
+        loader->Post([state = this->shared_from_this()] {
+            if (!state->cancelled) {
+                state->onLoaded(*state->value);
+            }
+        });
+    }
+    return true;
+}
+
+template <typename T>
+bool CLoadHandle<T>::Cancel() {
+    m_state->cancelled = true;
+    // Finish it here, otherwise Get would wait for a worker to pick it up
+    return m_state->Run();
+}
+
+template <typename T>
+const T& CLoadHandle<T>::Get() {
+    m_state->Run();
+    return m_state->GetValue();
+}
+
+template <typename F, typename T>
+CLoadHandle<T> IAsyncLoader::Submit(
+    const ELoadPriority priority,
+    F&& job,
+    CLoadCallback<T> onLoaded
+) {
+    CLoadHandle<T> handle;
+    handle.m_state = std::make_shared<async_loader_detail::CLoadState<T>>();
+    handle.m_state->loader = this;
+    handle.m_state->job = std::forward<F>(job);
+    handle.m_state->onLoaded = std::move(onLoaded);
+    handle.m_state->finished = handle.m_state->promise.get_future().share();
+
+    Enqueue(priority, [state = handle.m_state] { state->Run(); });
+    return handle;
+}
+
+inline CLoadHandle<CMappedFile> IAsyncLoader::LoadFile(
+    const std::string_view filename,
+    const ELoadPriority priority,
+    std::function<void(const CMappedFile&)> onLoaded
+) {
+    return LoadFile(filename, priority, [](CMappedFile& file) { return std::move(file); }, std::move(onLoaded));
+}
+
+template <typename F, typename T>
+    requires (!std::is_void_v<T>)
+CLoadHandle<T> IAsyncLoader::LoadFile(
+    const std::string_view filename,
+    const ELoadPriority priority,
+    F&& decode,
+    CLoadCallback<T> onLoaded
+) {
+    auto job = [filename = std::string(filename), decode = std::forward<F>(decode)]() mutable {
+        CMappedFile file = resource_loader::MapFile(filename, EMappedFileAccess::Sequential);
+        if (!file.IsOpen()) {
+            throw std::runtime_error(std::format("Failed to open \"{}\"!", filename));
+        }
+        _FaultIn(file);
+        return decode(file);
+    };
+    return Submit(priority, std::move(job), std::move(onLoaded));
+}
+
+inline void IAsyncLoader::_FaultIn(const CMappedFile& file) {
+    constexpr std::size_t PAGE_STRIDE = 4096;
+
+    file.Prefetch();
+    volatile std::byte sink {};
+    for (std::size_t offset = 0; offset < file.GetSize(); offset += PAGE_STRIDE) {
+        sink = file.GetData()[offset];
+    }
+    (void)sink;
+}
+
+PLATFORM_INTERFACE IAsyncLoader* AsyncLoader();
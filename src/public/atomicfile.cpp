@@ -0,0 +1,55 @@
+#include "atomicfile.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <system_error>
+#include <thread>
+
+#ifdef PLATFORM_WINDOWS
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace
+{
+// Unique across processes and threads: path.<pid>.<thread>.<counter>.tmp
+std::filesystem::path MakeTempPath(const std::filesystem::path& path) {
+    static std::atomic<uint64_t> counter = 0;
+
+#ifdef PLATFORM_WINDOWS
+    const uint64_t processId = GetCurrentProcessId();
+#else
+    const uint64_t processId = static_cast<uint64_t>(getpid());
+#endif
+    const std::size_t threadId = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    std::filesystem::path tempPath = path;
+    tempPath += std::format(".{}.{:x}.{}.tmp", processId, threadId, counter.fetch_add(1, std::memory_order_relaxed));
+    return tempPath;
+}
+}
+
+bool WriteFileAtomically(const std::filesystem::path& path, const std::function<void(std::ostream&)>& write) {
+    const std::filesystem::path tempPath = MakeTempPath(path);
+
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    write(file);
+    file.close();
+
+    std::error_code error;
+    if (file) {
+        std::filesystem::rename(tempPath, path, error);
+    }
+    if (!file || error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
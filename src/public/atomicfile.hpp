@@ -0,0 +1,16 @@
+#pragma once
+
+#include "publicapi.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+
+// Writes `path` through a temporary file next to it that replaces it once `write` returns, so a crash never
+// leaves a half-written file behind. Every call gets its own temporary file, concurrent writers of the same
+// path don't interleave and the last rename wins.
+// Returns false if the file can't be written, `path` is left as it was.
+PLATFORM_CLASS bool WriteFileAtomically(
+    const std::filesystem::path& path,
+    const std::function<void(std::ostream&)>& write
+);
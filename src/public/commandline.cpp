@@ -9,6 +9,7 @@ class CCommandLine final : public ICommandLine
 public:
     void CreateCmdLine(const std::vector<std::string>& argv) override;
     int FindParam(std::string_view param) override;
+    std::string_view GetParam(int index) override;
 };
 
 namespace { CCommandLine g_cmdLine; }
@@ -25,3 +26,10 @@ int CCommandLine::FindParam(std::string_view param) {
     }
     return static_cast<int>(std::distance(m_argv.begin(), it));
 }
+
+std::string_view CCommandLine::GetParam(int index) {
+    if (index < 0 || index >= static_cast<int>(m_argv.size())) {
+        return {};
+    }
+    return m_argv[index];
+}
@@ -20,6 +20,9 @@ public:
     // Returns index of found parameter. 0 if not found.
     virtual int FindParam(std::string_view param) = 0;
 
+    // Returns parameter at index. Empty if index is out of range.
+    virtual std::string_view GetParam(int index) = 0;
+
 protected:
     std::vector<std::string> m_argv;
 };
@@ -0,0 +1,236 @@
+#include "compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace compression {
+
+    namespace {
+
+        constexpr std::size_t MIN_MATCH = 4;
+        // Blocks end with literals and no match starts close to the end, so the encoder can read
+        // a few bytes past the current position without checks
+        constexpr std::size_t LAST_LITERALS = 5;
+        constexpr std::size_t MATCH_SEARCH_END = 12;
+        constexpr std::size_t MAX_OFFSET = 65535;
+        constexpr int HASH_BITS = 14;
+        // Step grows every 2^SKIP_SHIFT failed lookups, so incompressible data is skipped quickly
+        constexpr int SKIP_SHIFT = 6;
+        // Literals and matches up to this long are copied with one fixed size copy when there's room
+        constexpr std::size_t SHORT_COPY = 16;
+
+        uint32_t Read32(const std::byte* p) {
+            uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        uint64_t Read64(const std::byte* p) {
+            uint64_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        uint32_t HashSequence(const uint32_t sequence) {
+            return (sequence * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        std::byte* WriteLength(std::byte* out, std::size_t length) {
+            for (; length >= 255; length -= 255) {
+                *out++ = std::byte { 255 };
+            }
+            *out++ = static_cast<std::byte>(length);
+            return out;
+        }
+
+        std::byte* WriteSequence(
+            std::byte* out,
+            const std::byte* literals,
+            const std::size_t literalLength,
+            const std::size_t offset,
+            const std::size_t matchLength
+        ) {
+            std::byte* token = out++;
+            const std::size_t literalCode = std::min<std::size_t>(literalLength, 15);
+            if (literalLength >= 15) {
+                out = WriteLength(out, literalLength - 15);
+            }
+            if (literalLength != 0) {
+                std::memcpy(out, literals, literalLength);
+                out += literalLength;
+            }
+
+            std::size_t matchCode = 0;
+            if (matchLength != 0) {
+                *out++ = static_cast<std::byte>(offset & 0xFF);
+                *out++ = static_cast<std::byte>(offset >> 8);
+                matchCode = std::min<std::size_t>(matchLength - MIN_MATCH, 15);
+                if (matchLength - MIN_MATCH >= 15) {
+                    out = WriteLength(out, matchLength - MIN_MATCH - 15);
+                }
+            }
+
+            *token = static_cast<std::byte>((literalCode << 4) | matchCode);
+            return out;
+        }
+
+        // Counts equal bytes, 8 at a time while possible. Assumes a little endian host.
+        const std::byte* ExtendMatch(const std::byte* p, const std::byte* reference, const std::byte* limit) {
+            while (p + sizeof(uint64_t) <= limit) {
+                const uint64_t difference = Read64(p) ^ Read64(reference);
+                if (difference != 0) {
+                    return p + std::countr_zero(difference) / 8;
+                }
+                p += sizeof(uint64_t);
+                reference += sizeof(uint64_t);
+            }
+            while (p < limit && *p == *reference) {
+                ++p;
+                ++reference;
+            }
+            return p;
+        }
+
+        bool ReadLength(const std::byte*& in, const std::byte* end, std::size_t& length) {
+            std::byte extra {};
+            do {
+                if (in == end) {
+                    return false;
+                }
+                extra = *in++;
+                length += static_cast<std::size_t>(extra);
+            } while (extra == std::byte { 255 });
+            return true;
+        }
+
+    } // namespace
+
+    std::size_t CompressBlock(const std::span<const std::byte> source, const std::span<std::byte> destination) {
+        const std::byte* const begin = source.data();
+        const std::byte* const end = begin + source.size();
+        const std::byte* anchor = begin;
+        std::byte* out = destination.data();
+
+        if (source.size() > MATCH_SEARCH_END) {
+            // Stale positions are harmless, every candidate is verified
+            std::array<uint32_t, 1u << HASH_BITS> positions {};
+            const std::byte* const searchEnd = end - MATCH_SEARCH_END;
+            const std::byte* const matchLimit = end - LAST_LITERALS;
+
+            const std::byte* p = begin + 1;
+            uint32_t failedLookups = 0;
+            while (p < searchEnd) {
+                const uint32_t sequence = Read32(p);
+                uint32_t& slot = positions[HashSequence(sequence)];
+                const std::byte* candidate = begin + slot;
+                slot = static_cast<uint32_t>(p - begin);
+
+                if (candidate >= p || static_cast<std::size_t>(p - candidate) > MAX_OFFSET || Read32(candidate) != sequence) {
+                    p += 1 + (failedLookups++ >> SKIP_SHIFT);
+                    continue;
+                }
+                failedLookups = 0;
+
+                while (p > anchor && candidate > begin && p[-1] == candidate[-1]) {
+                    --p;
+                    --candidate;
+                }
+                const std::byte* matchEnd = ExtendMatch(p + MIN_MATCH, candidate + MIN_MATCH, matchLimit);
+
+                out = WriteSequence(
+                    out,
+                    anchor,
+                    static_cast<std::size_t>(p - anchor),
+                    static_cast<std::size_t>(p - candidate),
+                    static_cast<std::size_t>(matchEnd - p)
+                );
+                p = matchEnd;
+                anchor = p;
+
+                // Position inside the match improves the chance of finding the next one
+                if (p < searchEnd) {
+                    positions[HashSequence(Read32(p - 2))] = static_cast<uint32_t>(p - 2 - begin);
+                }
+            }
+        }
+
+        out = WriteSequence(out, anchor, static_cast<std::size_t>(end - anchor), 0, 0);
+        return static_cast<std::size_t>(out - destination.data());
+    }
+
+    bool DecompressBlock(const std::span<const std::byte> source, const std::span<std::byte> destination) {
+        const std::byte* in = source.data();
+        const std::byte* const inEnd = in + source.size();
+        std::byte* out = destination.data();
+        std::byte* const outEnd = out + destination.size();
+
+        while (in < inEnd) {
+            const auto token = static_cast<std::size_t>(*in++);
+
+            std::size_t literalLength = token >> 4;
+            if (literalLength == 15 && !ReadLength(in, inEnd, literalLength)) {
+                return false;
+            }
+            if (literalLength > static_cast<std::size_t>(inEnd - in) ||
+                literalLength > static_cast<std::size_t>(outEnd - out)) {
+                return false;
+            }
+            if (literalLength <= SHORT_COPY && static_cast<std::size_t>(inEnd - in) >= SHORT_COPY &&
+                static_cast<std::size_t>(outEnd - out) >= SHORT_COPY) {
+                // Short runs dominate, a fixed size copy is much cheaper than a variable one
+                std::memcpy(out, in, SHORT_COPY);
+            } else if (literalLength != 0) {
+                std::memcpy(out, in, literalLength);
+            }
+            in += literalLength;
+            out += literalLength;
+
+            // The last sequence has no match
+            if (in == inEnd) {
+                break;
+            }
+
+            if (inEnd - in < 2) {
+                return false;
+            }
+            const std::size_t offset = static_cast<std::size_t>(in[0]) | (static_cast<std::size_t>(in[1]) << 8);
+            in += 2;
+
+            std::size_t matchLength = token & 15;
+            if (matchLength == 15 && !ReadLength(in, inEnd, matchLength)) {
+                return false;
+            }
+            matchLength += MIN_MATCH;
+
+            if (offset == 0 || offset > static_cast<std::size_t>(out - destination.data()) ||
+                matchLength > static_cast<std::size_t>(outEnd - out)) {
+                return false;
+            }
+
+            const std::byte* match = out - offset;
+            if (matchLength <= SHORT_COPY && offset >= SHORT_COPY && static_cast<std::size_t>(outEnd - out) >= SHORT_COPY) {
+                std::memcpy(out, match, SHORT_COPY);
+                out += matchLength;
+            } else if (offset >= sizeof(uint64_t) && static_cast<std::size_t>(outEnd - out) >= matchLength + sizeof(uint64_t)) {
+                // Copies whole words and may write a few bytes past the match, later sequences overwrite them
+                std::byte* const copyEnd = out + matchLength;
+                for (; out < copyEnd; out += sizeof(uint64_t), match += sizeof(uint64_t)) {
+                    std::memcpy(out, match, sizeof(uint64_t));
+                }
+                out = copyEnd;
+            } else {
+                // Overlapping match repeats the last `offset` bytes
+                for (std::size_t i = 0; i < matchLength; ++i) {
+                    out[i] = match[i];
+                }
+                out += matchLength;
+            }
+        }
+
+        return in == inEnd && out == outEnd;
+    }
+
+} // compression
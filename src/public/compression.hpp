@@ -0,0 +1,26 @@
+#pragma once
+
+#include "publicapi.hpp"
+
+#include <cstddef>
+#include <span>
+
+// LZ77 byte-aligned block format in the spirit of LZ4, tuned for decompression speed over ratio.
+// A block is a series of sequences: a token with 4-bit literal and match lengths, the literals,
+// a 16-bit little endian match offset and the length extensions. The last sequence has literals only.
+// Blocks don't reference each other, so they can be decompressed in any order and on any thread.
+namespace compression {
+
+    // Compressed size can exceed the input for incompressible data
+    constexpr std::size_t GetMaxCompressedSize(const std::size_t size) {
+        return size + size / 255 + 16;
+    }
+
+    // Returns the compressed size. `destination` must hold GetMaxCompressedSize(source.size()) bytes.
+    PLATFORM_CLASS std::size_t CompressBlock(std::span<const std::byte> source, std::span<std::byte> destination);
+
+    // Returns false if the block is corrupted or doesn't decompress to exactly destination.size() bytes.
+    // Never reads or writes outside of the spans, even for malicious input.
+    PLATFORM_CLASS bool DecompressBlock(std::span<const std::byte> source, std::span<std::byte> destination);
+
+} // compression
@@ -0,0 +1,166 @@
+#include "deriveddatacache.hpp"
+
+#include "console.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <system_error>
+
+class CDerivedDataCache final : public IDerivedDataCache
+{
+public:
+    CDerivedDataCache() = default;
+    CDerivedDataCache(const CDerivedDataCache&) = delete;
+    CDerivedDataCache(CDerivedDataCache&&) = delete;
+    CDerivedDataCache& operator=(const CDerivedDataCache&) = delete;
+    CDerivedDataCache& operator=(CDerivedDataCache&&) = delete;
+    ~CDerivedDataCache() override = default;
+
+    void SetDirectory(const std::filesystem::path& directory) override;
+    std::filesystem::path Get(
+        const CDerivedDataKey& key,
+        const std::function<void(const std::filesystem::path&)>& build
+    ) override;
+    void Invalidate(const CDerivedDataKey& key) override;
+    void PrintStatistics() const override;
+
+private:
+    std::filesystem::path _GetEntryPath(const CDerivedDataKey& key) const;
+    // Returns true on a hit, whatever was building the entry is done by then
+    bool _Lookup(const std::filesystem::path& path);
+    // Build time is kept next to the entry, so hits in later runs know what they saved
+    static std::filesystem::path _GetTimePath(const std::filesystem::path& entryPath);
+
+    mutable std::mutex m_directoryMutex;
+    std::filesystem::path m_directory = "ddc";
+
+    // Entries being built, other misses of the same key wait for the build instead of writing it again
+    std::mutex m_buildMutex;
+    std::condition_variable m_buildFinished;
+    std::set<std::filesystem::path> m_building;
+
+    std::atomic<uint64_t> m_hits = 0;
+    std::atomic<uint64_t> m_misses = 0;
+    std::atomic<uint64_t> m_invalidations = 0;
+    std::atomic<uint64_t> m_savedMicroseconds = 0;
+    std::atomic<uint64_t> m_buildMicroseconds = 0;
+};
+
+PLATFORM_INTERFACE IDerivedDataCache* DerivedDataCache() {
+    static CDerivedDataCache cache;
+    return &cache;
+}
+
+void CDerivedDataCache::SetDirectory(const std::filesystem::path& directory) {
+    std::lock_guard lock(m_directoryMutex);
+    m_directory = directory;
+}
+
+std::filesystem::path CDerivedDataCache::Get(
+    const CDerivedDataKey& key,
+    const std::function<void(const std::filesystem::path&)>& build
+) {
+    const std::filesystem::path path = _GetEntryPath(key);
+    if (_Lookup(path)) {
+        return path;
+    }
+
+    {
+        std::unique_lock lock(m_buildMutex);
+        m_buildFinished.wait(lock, [&] { return !m_building.contains(path); });
+        // Someone else built it while we waited
+        if (_Lookup(path)) {
+            return path;
+        }
+        m_building.insert(path);
+    }
+    const auto finishBuild = [&] {
+        {
+            std::lock_guard lock(m_buildMutex);
+            m_building.erase(path);
+        }
+        m_buildFinished.notify_all();
+    };
+
+    ++m_misses;
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        std::filesystem::create_directories(path.parent_path());
+        build(path);
+    } catch (...) {
+        finishBuild();
+        throw;
+    }
+    const auto microseconds = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()
+    );
+    m_buildMicroseconds += microseconds;
+
+    // Losing the time only makes the statistics of later hits less accurate
+    {
+        std::ofstream timeFile(_GetTimePath(path), std::ios::trunc);
+        timeFile << microseconds;
+    }
+
+    finishBuild();
+    return path;
+}
+
+void CDerivedDataCache::Invalidate(const CDerivedDataKey& key) {
+    const std::filesystem::path path = _GetEntryPath(key);
+
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    std::filesystem::remove(_GetTimePath(path), error);
+    ++m_invalidations;
+}
+
+void CDerivedDataCache::PrintStatistics() const {
+    const uint64_t hits = m_hits;
+    const uint64_t requests = hits + m_misses;
+    if (requests == 0) {
+        return;
+    }
+
+    Msg(
+        "Derived data cache: {} of {} requests hit ({:.0f}%), {} invalidated, {:.1f} ms of imports skipped, "
+        "{:.1f} ms spent cooking",
+        hits,
+        requests,
+        100.0 * static_cast<double>(hits) / static_cast<double>(requests),
+        m_invalidations.load(),
+        static_cast<double>(m_savedMicroseconds) / 1000.0,
+        static_cast<double>(m_buildMicroseconds) / 1000.0
+    );
+}
+
+std::filesystem::path CDerivedDataCache::_GetEntryPath(const CDerivedDataKey& key) const {
+    std::lock_guard lock(m_directoryMutex);
+    return m_directory / key.GetType() / std::format("{:016x}.{}", key.GetHash(), key.GetType());
+}
+
+bool CDerivedDataCache::_Lookup(const std::filesystem::path& path) {
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error)) {
+        return false;
+    }
+
+    uint64_t microseconds = 0;
+    std::ifstream timeFile(_GetTimePath(path));
+    timeFile >> microseconds;
+
+    ++m_hits;
+    m_savedMicroseconds += microseconds;
+    return true;
+}
+
+std::filesystem::path CDerivedDataCache::_GetTimePath(const std::filesystem::path& entryPath) {
+    std::filesystem::path path = entryPath;
+    path += ".time";
+    return path;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "publicapi.hpp"
+#include "hash.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Identifies a derived data entry by everything the cooked result depends on: source bytes, import settings
+// and the version of the code producing it
+class CDerivedDataKey
+{
+public:
+    // `type` keeps results of different cookers apart and is the entry's file extension. `version` has to be
+    // bumped whenever the cooker produces different output from the same input.
+    CDerivedDataKey(const std::string_view type, const uint32_t version)
+        : m_type(type), m_hash(hash::Hash64(type)) {
+        Add(version);
+    }
+
+    CDerivedDataKey& Add(const std::span<const std::byte> data) {
+        m_hash = hash::Hash64(data.data(), data.size(), m_hash);
+        return *this;
+    }
+    CDerivedDataKey& Add(const std::string_view text) {
+        m_hash = hash::Hash64(text, m_hash);
+        return *this;
+    }
+    // Settings are added field by field, hashing whole structs would pick up their padding
+    template <typename T>
+        requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+    CDerivedDataKey& Add(const T value) {
+        return Add(std::as_bytes(std::span(&value, 1)));
+    }
+
+    [[nodiscard]] const std::string& GetType() const { return m_type; }
+    [[nodiscard]] uint64_t GetHash() const { return m_hash; }
+
+private:
+    std::string m_type;
+    uint64_t m_hash;
+};
+
+// Local cache of cooked assets keyed by content hash, so unchanged sources are never imported twice
+class IDerivedDataCache
+{
+public:
+    IDerivedDataCache() = default;
+    IDerivedDataCache(const IDerivedDataCache&) = delete;
+    IDerivedDataCache(IDerivedDataCache&&) = delete;
+    IDerivedDataCache& operator=(const IDerivedDataCache&) = delete;
+    IDerivedDataCache& operator=(IDerivedDataCache&&) = delete;
+    virtual ~IDerivedDataCache() = default;
+
+    // Relative to the working directory, "ddc" by default. Created on the first miss.
+    virtual void SetDirectory(const std::filesystem::path& directory) = 0;
+
+    // Path of the entry for `key`. On a miss `build(path)` cooks it there first, and the time it took is stored
+    // with the entry as the time every later hit saves. `build` must write the file atomically, so a crash never
+    // leaves a half-written entry. Thread safe, concurrent misses of the same key wait for a single build.
+    virtual std::filesystem::path Get(
+        const CDerivedDataKey& key,
+        const std::function<void(const std::filesystem::path&)>& build
+    ) = 0;
+
+    // Drops an entry that turned out to be unusable, e.g. one that fails validation when loaded
+    virtual void Invalidate(const CDerivedDataKey& key) = 0;
+
+    // Hit rate and import time saved since startup
+    virtual void PrintStatistics() const = 0;
+};
+
+PLATFORM_INTERFACE IDerivedDataCache* DerivedDataCache();
@@ -0,0 +1,194 @@
+#include "filewatcher.hpp"
+
+#include <chrono>
+#include <system_error>
+
+#ifdef PLATFORM_LINUX
+    #include <algorithm>
+    #include <unordered_map>
+
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#else
+    #include <map>
+#endif
+
+namespace
+{
+// How often the watcher thread checks whether it was stopped, and the polling period without inotify
+constexpr int WATCH_INTERVAL_MS = 100;
+
+#ifdef PLATFORM_LINUX
+// Directories report their own creation and renames so new subdirectories get a watch too
+constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE;
+
+// True if `path` is `directory` or lies inside it, both relative to the watched directory
+bool IsWithin(const std::filesystem::path& path, const std::filesystem::path& directory) {
+    return std::mismatch(directory.begin(), directory.end(), path.begin(), path.end()).first == directory.end();
+}
+#endif
+}
+
+CFileWatcher::~CFileWatcher() {
+    Stop();
+}
+
+bool CFileWatcher::Start(const std::filesystem::path& directory, CChangeCallback onChanged) {
+    Stop();
+
+#ifdef PLATFORM_LINUX
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0) {
+        return false;
+    }
+    if (inotify_add_watch(m_inotify, directory.c_str(), WATCH_MASK) < 0) {
+        close(m_inotify);
+        m_inotify = -1;
+        return false;
+    }
+#else
+    std::error_code error;
+    if (!std::filesystem::is_directory(directory, error)) {
+        return false;
+    }
+#endif
+
+    m_stop = false;
+    m_thread = std::thread(&CFileWatcher::_WatcherMain, this, directory, std::move(onChanged));
+    return true;
+}
+
+void CFileWatcher::Stop() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    m_stop = true;
+    m_thread.join();
+
+#ifdef PLATFORM_LINUX
+    close(m_inotify);
+    m_inotify = -1;
+#endif
+}
+
+#ifdef PLATFORM_LINUX
+
+void CFileWatcher::_WatcherMain(const std::filesystem::path directory, const CChangeCallback onChanged) {
+    // Watch descriptor to the directory it watches, relative to `directory`
+    std::unordered_map<int, std::filesystem::path> watches;
+
+    // Files already in a directory that appears while watching were written before its watch existed,
+    // so they are reported right away
+    const auto addTree = [&](const std::filesystem::path& relative, const bool reportFiles) {
+        const std::filesystem::path root = relative.empty() ? directory : directory / relative;
+        const int rootWatch = inotify_add_watch(m_inotify, root.c_str(), WATCH_MASK);
+        if (rootWatch < 0) {
+            return;
+        }
+        watches[rootWatch] = relative;
+
+        std::error_code error;
+        for (std::filesystem::recursive_directory_iterator it(
+                 root, std::filesystem::directory_options::skip_permission_denied, error
+             ), end;
+             !error && it != end; it.increment(error)) {
+            const std::filesystem::path path = it->path().lexically_relative(directory);
+            if (it->is_directory(error) && !it->is_symlink(error)) {
+                const int watch = inotify_add_watch(m_inotify, it->path().c_str(), WATCH_MASK);
+                if (watch >= 0) {
+                    watches[watch] = path;
+                }
+            } else if (reportFiles && it->is_regular_file(error)) {
+                onChanged(path);
+            }
+        }
+    };
+
+    // Watches of a directory renamed away would keep reporting under its old path
+    const auto removeTree = [&](const std::filesystem::path& relative) {
+        std::erase_if(watches, [&](const auto& watch) {
+            if (!IsWithin(watch.second, relative)) {
+                return false;
+            }
+            inotify_rm_watch(m_inotify, watch.first);
+            return true;
+        });
+    };
+
+    addTree({}, false);
+
+    alignas(inotify_event) char buffer[4096];
+    while (!m_stop) {
+        pollfd descriptor { m_inotify, POLLIN, 0 };
+        if (poll(&descriptor, 1, WATCH_INTERVAL_MS) <= 0) {
+            continue;
+        }
+
+        ssize_t size = 0;
+        while ((size = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+            for (const char* p = buffer; p < buffer + size;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(p);
+                p += sizeof(inotify_event) + event->len;
+
+                const auto watch = watches.find(event->wd);
+                if (watch == watches.end()) {
+                    continue;
+                }
+                // The directory itself was deleted or unmounted
+                if (event->mask & IN_IGNORED) {
+                    watches.erase(watch);
+                    continue;
+                }
+                if (event->len == 0) {
+                    continue;
+                }
+
+                const std::filesystem::path path = watch->second / event->name;
+                if (event->mask & IN_ISDIR) {
+                    if (event->mask & IN_MOVED_FROM) {
+                        removeTree(path);
+                    } else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        addTree(path, true);
+                    }
+                } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                    onChanged(path);
+                }
+            }
+        }
+    }
+}
+
+#else
+
+void CFileWatcher::_WatcherMain(const std::filesystem::path directory, const CChangeCallback onChanged) {
+    std::map<std::filesystem::path, std::filesystem::file_time_type> writeTimes;
+    const auto scan = [&](const bool report) {
+        std::error_code error;
+        for (std::filesystem::recursive_directory_iterator entry(
+                 directory, std::filesystem::directory_options::skip_permission_denied, error
+             ), end;
+             !error && entry != end; entry.increment(error)) {
+            if (!entry->is_regular_file(error)) {
+                continue;
+            }
+            const std::filesystem::file_time_type writeTime = entry->last_write_time(error);
+            const auto [it, inserted] = writeTimes.try_emplace(entry->path().lexically_relative(directory), writeTime);
+            if (!inserted && it->second == writeTime) {
+                continue;
+            }
+            it->second = writeTime;
+            if (report) {
+                onChanged(it->first);
+            }
+        }
+    };
+
+    scan(false);
+    while (!m_stop) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL_MS));
+        scan(true);
+    }
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "publicapi.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <thread>
+
+// Reports files written in a directory and its subdirectories, from a thread of its own. Uses inotify on Linux,
+// with a watch per subdirectory including ones created later, and compares modification times elsewhere.
+class PLATFORM_CLASS CFileWatcher
+{
+public:
+    // Called on the watcher thread with the path relative to the watched directory, e.g. "shaders/mesh.vert"
+    using CChangeCallback = std::function<void(const std::filesystem::path&)>;
+
+    CFileWatcher() = default;
+    CFileWatcher(const CFileWatcher&) = delete;
+    CFileWatcher(CFileWatcher&&) = delete;
+    CFileWatcher& operator=(const CFileWatcher&) = delete;
+    CFileWatcher& operator=(CFileWatcher&&) = delete;
+    ~CFileWatcher();
+
+    // Stops watching the previous directory. Returns false if `directory` can't be watched.
+    // A file is reported once its writer closes it or it is renamed into place, as editors do on save.
+    bool Start(const std::filesystem::path& directory, CChangeCallback onChanged);
+    // Waits for a callback that is already running
+    void Stop();
+
+    [[nodiscard]] bool IsWatching() const { return m_thread.joinable(); }
+
+private:
+    void _WatcherMain(std::filesystem::path directory, CChangeCallback onChanged);
+
+    std::thread m_thread;
+    std::atomic<bool> m_stop = false;
+#ifdef PLATFORM_LINUX
+    int m_inotify = -1;
+#endif
+};
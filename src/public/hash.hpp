@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace hash {
+
+    namespace detail {
+
+        constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+        constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+        constexpr uint64_t PRIME3 = 0x165667B19E3779F9ull;
+        constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+        constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+        inline uint64_t Rotl(const uint64_t value, const int bits) {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        inline uint64_t Read64(const std::byte* p) {
+            uint64_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        inline uint32_t Read32(const std::byte* p) {
+            uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        inline uint64_t Round(uint64_t accumulator, const uint64_t input) {
+            accumulator += input * PRIME2;
+            accumulator = Rotl(accumulator, 31);
+            return accumulator * PRIME1;
+        }
+
+        inline uint64_t MergeRound(uint64_t accumulator, const uint64_t value) {
+            accumulator ^= Round(0, value);
+            return accumulator * PRIME1 + PRIME4;
+        }
+
+    } // detail
+
+    // XXH64 of a byte range. Stable across runs and platforms of the same endianness,
+    // so it can be stored in files.
+    inline uint64_t Hash64(const void* data, const std::size_t size, const uint64_t seed = 0) {
+        using namespace detail;
+
+        const auto* p = static_cast<const std::byte*>(data);
+        const std::byte* const end = p + size;
+        uint64_t result;
+
+        if (size >= 32) {
+            uint64_t v1 = seed + PRIME1 + PRIME2;
+            uint64_t v2 = seed + PRIME2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - PRIME1;
+
+            for (const std::byte* limit = end - 32; p <= limit; p += 32) {
+                v1 = Round(v1, Read64(p));
+                v2 = Round(v2, Read64(p + 8));
+                v3 = Round(v3, Read64(p + 16));
+                v4 = Round(v4, Read64(p + 24));
+            }
+
+            result = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+            result = MergeRound(result, v1);
+            result = MergeRound(result, v2);
+            result = MergeRound(result, v3);
+            result = MergeRound(result, v4);
+        } else {
+            result = seed + PRIME5;
+        }
+
+        result += static_cast<uint64_t>(size);
+
+        for (; p + 8 <= end; p += 8) {
+            result ^= Round(0, Read64(p));
+            result = Rotl(result, 27) * PRIME1 + PRIME4;
+        }
+        if (p + 4 <= end) {
+            result ^= static_cast<uint64_t>(Read32(p)) * PRIME1;
+            result = Rotl(result, 23) * PRIME2 + PRIME3;
+            p += 4;
+        }
+        for (; p < end; ++p) {
+            result ^= static_cast<uint64_t>(*p) * PRIME5;
+            result = Rotl(result, 11) * PRIME1;
+        }
+
+        result ^= result >> 33;
+        result *= PRIME2;
+        result ^= result >> 29;
+        result *= PRIME3;
+        result ^= result >> 32;
+        return result;
+    }
+
+    inline uint64_t Hash64(const std::string_view text, const uint64_t seed = 0) {
+        return Hash64(text.data(), text.size(), seed);
+    }
+
+} // hash
@@ -0,0 +1,292 @@
+#include "mappedfile.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#ifdef PLATFORM_WINDOWS
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+CMappedFile::CMappedFile(CMappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+CMappedFile& CMappedFile::operator=(CMappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_isOpen = std::exchange(other.m_isOpen, false);
+        m_parent = std::move(other.m_parent);
+#ifdef PLATFORM_WINDOWS
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+        m_anonymous = std::exchange(other.m_anonymous, false);
+#endif
+    }
+    return *this;
+}
+
+CMappedFile::~CMappedFile() {
+    Close();
+}
+
+CMappedFile CMappedFile::MakeSubview(
+    std::shared_ptr<const CMappedFile> file,
+    const std::size_t offset,
+    const std::size_t size,
+    const EMappedFileAccess access
+) {
+    CMappedFile subview;
+    subview.m_data = file->GetData() + offset;
+    subview.m_size = size;
+    subview.m_isOpen = true;
+    subview.m_parent = std::move(file);
+    if (access != EMappedFileAccess::Normal && size != 0) {
+        subview._Advise(access);
+    }
+    return subview;
+}
+
+#ifdef PLATFORM_WINDOWS
+namespace {
+DWORD GetAccessFlags(const EMappedFileAccess access) {
+    switch (access) {
+        case EMappedFileAccess::Sequential:
+            return FILE_FLAG_SEQUENTIAL_SCAN;
+        case EMappedFileAccess::Random:
+            return FILE_FLAG_RANDOM_ACCESS;
+        case EMappedFileAccess::Normal:
+        default:
+            return 0;
+    }
+}
+}
+#else
+namespace {
+int GetAccessAdvice(const EMappedFileAccess access) {
+    switch (access) {
+        case EMappedFileAccess::Sequential:
+            return MADV_SEQUENTIAL;
+        case EMappedFileAccess::Random:
+            return MADV_RANDOM;
+        case EMappedFileAccess::Normal:
+        default:
+            return MADV_NORMAL;
+    }
+}
+
+// madvise wants a page aligned address
+std::pair<void*, std::size_t> AlignToPages(const std::byte* data, const std::size_t size) {
+    static const auto pageSize = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto begin = reinterpret_cast<std::uintptr_t>(data);
+    const std::uintptr_t alignedBegin = begin & ~(pageSize - 1);
+    return { reinterpret_cast<void*>(alignedBegin), size + (begin - alignedBegin) };
+}
+}
+#endif
+
+#ifdef PLATFORM_WINDOWS
+
+bool CMappedFile::Open(const std::filesystem::path& path, const EMappedFileAccess access) {
+    Close();
+
+    const HANDLE file = CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | GetAccessFlags(access),
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize {};
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // Windows can't map empty files, but an empty view is still a valid result
+    if (fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        m_isOpen = true;
+        return true;
+    }
+
+    const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        return false;
+    }
+
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    m_mapping = mapping;
+    m_data = static_cast<const std::byte*>(view);
+    m_size = static_cast<std::size_t>(fileSize.QuadPart);
+    m_isOpen = true;
+    return true;
+}
+
+void CMappedFile::Prefetch(const std::size_t offset, const std::size_t size) const {
+    if (offset >= m_size) {
+        return;
+    }
+
+    WIN32_MEMORY_RANGE_ENTRY range {};
+    range.VirtualAddress = const_cast<std::byte*>(m_data + offset);
+    range.NumberOfBytes = std::min(size, m_size - offset);
+    // Only a hint, nothing to do if the system doesn't support it
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+CMappedFile CMappedFile::MakeAnonymous(const std::size_t size, const std::function<bool(std::span<std::byte>)>& fill) {
+    CMappedFile file;
+    if (size == 0) {
+        file.m_isOpen = fill({});
+        return file;
+    }
+
+    void* memory = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!memory) {
+        return file;
+    }
+    file.m_data = static_cast<const std::byte*>(memory);
+    file.m_size = size;
+    file.m_anonymous = true;
+
+    DWORD oldProtection = 0;
+    if (!fill({ static_cast<std::byte*>(memory), size }) || !VirtualProtect(memory, size, PAGE_READONLY, &oldProtection)) {
+        file.Close();
+        return file;
+    }
+    file.m_isOpen = true;
+    return file;
+}
+
+void CMappedFile::_Advise(const EMappedFileAccess access) const {
+    // Access pattern of a whole file is set when it's opened, a range can only be read ahead
+    if (access == EMappedFileAccess::Sequential) {
+        Prefetch();
+    }
+}
+
+void CMappedFile::Close() {
+    if (m_data && m_anonymous) {
+        VirtualFree(const_cast<std::byte*>(m_data), 0, MEM_RELEASE);
+    } else if (m_data && !m_parent) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+    m_mapping = nullptr;
+    m_anonymous = false;
+    m_parent = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
+
+#else
+
+bool CMappedFile::Open(const std::filesystem::path& path, const EMappedFileAccess access) {
+    Close();
+
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileStat {};
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // mmap doesn't accept zero length, but an empty view is still a valid result
+    if (fileStat.st_size == 0) {
+        close(fd);
+        m_isOpen = true;
+        return true;
+    }
+
+    void* view = mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+
+    if (access != EMappedFileAccess::Normal) {
+        madvise(view, static_cast<std::size_t>(fileStat.st_size), GetAccessAdvice(access));
+    }
+
+    m_data = static_cast<const std::byte*>(view);
+    m_size = static_cast<std::size_t>(fileStat.st_size);
+    m_isOpen = true;
+    return true;
+}
+
+void CMappedFile::Prefetch(const std::size_t offset, const std::size_t size) const {
+    if (offset >= m_size) {
+        return;
+    }
+
+    const auto [address, length] = AlignToPages(m_data + offset, std::min(size, m_size - offset));
+    madvise(address, length, MADV_WILLNEED);
+}
+
+CMappedFile CMappedFile::MakeAnonymous(const std::size_t size, const std::function<bool(std::span<std::byte>)>& fill) {
+    CMappedFile file;
+    if (size == 0) {
+        file.m_isOpen = fill({});
+        return file;
+    }
+
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return file;
+    }
+    // Close unmaps it like a file view
+    file.m_data = static_cast<const std::byte*>(memory);
+    file.m_size = size;
+
+    if (!fill({ static_cast<std::byte*>(memory), size }) || mprotect(memory, size, PROT_READ) != 0) {
+        file.Close();
+        return file;
+    }
+    file.m_isOpen = true;
+    return file;
+}
+
+void CMappedFile::_Advise(const EMappedFileAccess access) const {
+    const auto [address, length] = AlignToPages(m_data, m_size);
+    madvise(address, length, GetAccessAdvice(access));
+}
+
+void CMappedFile::Close() {
+    if (m_data && !m_parent) {
+        munmap(const_cast<std::byte*>(m_data), m_size);
+    }
+    m_parent = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "publicapi.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+
+// How the view is going to be read, passed to the OS so it can tune readahead and page eviction
+enum class EMappedFileAccess
+{
+    Normal,
+    // Read once front to back, e.g. copied into a staging buffer
+    Sequential,
+    // Read in scattered pieces, e.g. looked up through a table of contents
+    Random,
+};
+
+// Read-only view of a file mapped into the address space
+class PLATFORM_CLASS CMappedFile
+{
+public:
+    CMappedFile() = default;
+    CMappedFile(const CMappedFile&) = delete;
+    CMappedFile(CMappedFile&& other) noexcept;
+    CMappedFile& operator=(const CMappedFile&) = delete;
+    CMappedFile& operator=(CMappedFile&& other) noexcept;
+    ~CMappedFile();
+
+    // Returns false if the file cannot be opened or mapped
+    bool Open(const std::filesystem::path& path, EMappedFileAccess access = EMappedFileAccess::Normal);
+    void Close();
+
+    // View of a range of `file` that shares its mapping and keeps it alive, e.g. an entry of a pack file.
+    // The range must be within the file.
+    static CMappedFile MakeSubview(
+        std::shared_ptr<const CMappedFile> file,
+        std::size_t offset,
+        std::size_t size,
+        EMappedFileAccess access = EMappedFileAccess::Normal
+    );
+
+    // Memory not backed by a file, e.g. a decompressed pack entry. `fill` writes the contents before the
+    // memory becomes read-only. The result is not open if allocation fails or `fill` returns false.
+    static CMappedFile MakeAnonymous(std::size_t size, const std::function<bool(std::span<std::byte>)>& fill);
+
+    // Asks the OS to start reading the range in the background so the first touch doesn't stall on IO
+    void Prefetch(std::size_t offset, std::size_t size) const;
+    void Prefetch() const { Prefetch(0, m_size); }
+
+    [[nodiscard]] bool IsOpen() const { return m_isOpen; }
+    [[nodiscard]] const std::byte* GetData() const { return m_data; }
+    [[nodiscard]] std::size_t GetSize() const { return m_size; }
+    [[nodiscard]] std::span<const std::byte> GetView() const { return { m_data, m_size }; }
+
+private:
+    void _Advise(EMappedFileAccess access) const;
+
+    const std::byte* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_isOpen = false;
+    // Set for subviews, which don't own a mapping
+    std::shared_ptr<const CMappedFile> m_parent;
+#ifdef PLATFORM_WINDOWS
+    void* m_mapping = nullptr;
+    // Allocated with VirtualAlloc instead of mapped
+    bool m_anonymous = false;
+#endif
+};
@@ -0,0 +1,384 @@
+#include "packfile.hpp"
+
+#include "compression.hpp"
+#include "console.hpp"
+#include "hash.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+uint64_t AlignUp(const uint64_t value, const uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+uint64_t GetBlockCount(const uint64_t decompressedSize) {
+    return (decompressedSize + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE;
+}
+
+bool IsCompressed(const CPackEntry& entry) {
+    return (entry.flags & static_cast<uint32_t>(EPackEntryFlags::Compressed)) != 0;
+}
+
+// Compressed blocks of an entry, each one is kept as is if compression doesn't shrink it
+std::vector<std::vector<std::byte>> CompressBlocks(const std::span<const std::byte> data) {
+    std::vector<std::vector<std::byte>> blocks(GetBlockCount(data.size()));
+    ThreadPool()->ParallelFor(blocks.size(), [&](const std::size_t i) {
+        const std::span<const std::byte> block = data.subspan(i * PACK_BLOCK_SIZE).first(
+            std::min<std::size_t>(PACK_BLOCK_SIZE, data.size() - i * PACK_BLOCK_SIZE)
+        );
+
+        std::vector<std::byte>& compressed = blocks[i];
+        compressed.resize(compression::GetMaxCompressedSize(block.size()));
+        compressed.resize(compression::CompressBlock(block, compressed));
+        if (compressed.size() >= block.size()) {
+            compressed.assign(block.begin(), block.end());
+        }
+    });
+    return blocks;
+}
+
+std::vector<std::shared_ptr<const CPackFile>> g_mountedPacks;
+std::shared_mutex g_mountedPacksMutex;
+
+// Pack that takes precedence for the file, nullptr if none contains it
+std::pair<std::shared_ptr<const CPackFile>, const CPackEntry*> FindMounted(const std::string_view filename) {
+    std::shared_lock lock(g_mountedPacksMutex);
+    for (auto pack = g_mountedPacks.rbegin(); pack != g_mountedPacks.rend(); ++pack) {
+        if (const CPackEntry* entry = (*pack)->Find(filename)) {
+            return { *pack, entry };
+        }
+    }
+    return { nullptr, nullptr };
+}
+
+} // namespace
+
+bool CPackFile::Open(const std::filesystem::path& path) {
+    m_file = nullptr;
+    m_table = {};
+    m_names = {};
+
+    auto file = std::make_shared<CMappedFile>();
+    // Lookups jump around the table and entries are advised on their own when mapped
+    if (!file->Open(path, EMappedFileAccess::Random)) {
+        return false;
+    }
+
+    const auto fail = [&](const std::string_view reason) {
+        Warning("Pack file \"{}\" is ignored: {}", path.string(), reason);
+        return false;
+    };
+
+    const std::span<const std::byte> view = file->GetView();
+    if (view.size() < sizeof(CPackHeader)) {
+        return fail("file is truncated");
+    }
+
+    std::memcpy(&m_header, view.data(), sizeof(m_header));
+    if (m_header.magic != PACK_FILE_MAGIC) {
+        return fail("not a pack file");
+    }
+    if (m_header.version != PACK_FILE_VERSION) {
+        return fail(std::format("version {} is not supported, expected {}", m_header.version, PACK_FILE_VERSION));
+    }
+
+    const uint64_t tableBytes = static_cast<uint64_t>(m_header.tableSize) * sizeof(CPackEntry);
+    if (!std::has_single_bit(m_header.tableSize) || m_header.entryCount > m_header.tableSize ||
+        m_header.tableOffset % alignof(CPackEntry) != 0 ||
+        m_header.tableOffset > view.size() || tableBytes > view.size() - m_header.tableOffset ||
+        m_header.namesOffset > view.size() || m_header.namesSize > view.size() - m_header.namesOffset) {
+        return fail("table of contents is out of bounds");
+    }
+
+    m_table = { reinterpret_cast<const CPackEntry*>(view.data() + m_header.tableOffset), m_header.tableSize };
+    m_names = { reinterpret_cast<const char*>(view.data() + m_header.namesOffset), m_header.namesSize };
+
+    uint32_t occupiedSlots = 0;
+    for (const CPackEntry& entry : m_table) {
+        if (entry.nameSize == 0) {
+            continue;
+        }
+        ++occupiedSlots;
+        // Stored entries are exactly their file, compressed ones at least hold the block size table
+        const bool sizeMatches = IsCompressed(entry)
+            ? entry.size >= GetBlockCount(entry.decompressedSize) * sizeof(uint32_t)
+            : entry.size == entry.decompressedSize;
+        if (entry.offset > view.size() || entry.size > view.size() - entry.offset || !sizeMatches ||
+            entry.nameOffset > m_names.size() || entry.nameSize > m_names.size() - entry.nameOffset) {
+            m_table = {};
+            m_names = {};
+            return fail("entry is out of bounds");
+        }
+    }
+
+    // Find relies on at least one empty slot to stop probing
+    if (occupiedSlots != m_header.entryCount || occupiedSlots >= m_header.tableSize) {
+        m_table = {};
+        m_names = {};
+        return fail("table of contents doesn't match the entry count");
+    }
+
+    m_file = std::move(file);
+    return true;
+}
+
+const CPackEntry* CPackFile::Find(const std::string_view filename) const {
+    if (m_table.empty()) {
+        return nullptr;
+    }
+
+    const std::string path = pack_file::NormalizePath(filename);
+    const uint64_t pathHash = hash::Hash64(path);
+    const std::size_t mask = m_table.size() - 1;
+
+    // Open guarantees an empty slot, the probe limit only guards against a table that changed on disk
+    std::size_t slot = pathHash & mask;
+    for (std::size_t probe = 0; probe < m_table.size(); ++probe, slot = (slot + 1) & mask) {
+        const CPackEntry& entry = m_table[slot];
+        if (entry.nameSize == 0) {
+            return nullptr;
+        }
+        if (entry.pathHash == pathHash && m_names.substr(entry.nameOffset, entry.nameSize) == path) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+CMappedFile CPackFile::Map(const std::string_view filename, const EMappedFileAccess access) const {
+    const CPackEntry* entry = Find(filename);
+    if (!entry) {
+        return {};
+    }
+    if (IsCompressed(*entry)) {
+        return CMappedFile::MakeAnonymous(entry->decompressedSize, [&](const std::span<std::byte> destination) {
+            return Read(*entry, destination);
+        });
+    }
+    return CMappedFile::MakeSubview(m_file, entry->offset, entry->size, access);
+}
+
+bool CPackFile::Read(const CPackEntry& entry, const std::span<std::byte> destination) const {
+    if (destination.size() != entry.decompressedSize) {
+        return false;
+    }
+
+    const std::span<const std::byte> stored = m_file->GetView().subspan(entry.offset, entry.size);
+    if (!IsCompressed(entry)) {
+        if (!destination.empty()) {
+            std::memcpy(destination.data(), stored.data(), destination.size());
+        }
+        return true;
+    }
+
+    const auto fail = [&] {
+        Warning("Pack entry \"{}\" is corrupted", m_names.substr(entry.nameOffset, entry.nameSize));
+        return false;
+    };
+
+    const std::size_t blockCount = GetBlockCount(entry.decompressedSize);
+    std::vector<uint32_t> blockSizes(blockCount);
+    std::memcpy(blockSizes.data(), stored.data(), blockCount * sizeof(uint32_t));
+
+    std::vector<uint64_t> blockOffsets(blockCount);
+    uint64_t offset = blockCount * sizeof(uint32_t);
+    for (std::size_t i = 0; i < blockCount; ++i) {
+        blockOffsets[i] = offset;
+        offset += blockSizes[i];
+    }
+    if (offset > stored.size()) {
+        return fail();
+    }
+
+    std::atomic<bool> corrupted = false;
+    ThreadPool()->ParallelFor(blockCount, [&](const std::size_t i) {
+        const std::span<const std::byte> source = stored.subspan(blockOffsets[i], blockSizes[i]);
+        const std::span<std::byte> block = destination.subspan(i * PACK_BLOCK_SIZE).first(
+            std::min<std::size_t>(PACK_BLOCK_SIZE, destination.size() - i * PACK_BLOCK_SIZE)
+        );
+
+        if (source.size() == block.size()) {
+            std::memcpy(block.data(), source.data(), block.size());
+        } else if (!compression::DecompressBlock(source, block)) {
+            corrupted = true;
+        }
+    });
+    return corrupted ? fail() : true;
+}
+
+namespace pack_file {
+
+    std::string NormalizePath(const std::string_view filename) {
+        std::string path(filename);
+        std::ranges::replace(path, '\\', '/');
+
+        std::string_view view = path;
+        while (view.starts_with("./") || view.starts_with('/')) {
+            view.remove_prefix(view.starts_with('/') ? 1 : 2);
+        }
+        return std::string(view);
+    }
+
+    void Build(const std::filesystem::path& sourceDirectory, const std::filesystem::path& destination, const bool compress) {
+        std::vector<std::filesystem::path> files;
+        for (const auto& item : std::filesystem::recursive_directory_iterator(sourceDirectory)) {
+            if (item.is_regular_file()) {
+                files.push_back(item.path());
+            }
+        }
+        // Same input always gives the same pack
+        std::ranges::sort(files);
+
+        std::ofstream output(destination, std::ios::binary | std::ios::trunc);
+        if (!output.is_open()) {
+            throw std::runtime_error(std::format("Failed to create pack file \"{}\"!", destination.string()));
+        }
+
+        const auto writePadding = [&](const uint64_t alignment) {
+            static constexpr char ZEROES[PACK_ALIGNMENT] {};
+            const auto position = static_cast<uint64_t>(output.tellp());
+            output.write(ZEROES, static_cast<std::streamsize>(AlignUp(position, alignment) - position));
+        };
+
+        CPackHeader header {};
+        header.magic = PACK_FILE_MAGIC;
+        header.version = PACK_FILE_VERSION;
+        header.entryCount = static_cast<uint32_t>(files.size());
+        // Half empty at most, so probe sequences stay short
+        header.tableSize = std::bit_ceil(std::max<uint32_t>(header.entryCount * 2, 1));
+
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writePadding(PACK_ALIGNMENT);
+
+        std::vector<CPackEntry> table(header.tableSize);
+        std::string names;
+        uint64_t dataSize = 0;
+        uint64_t storedSize = 0;
+        uint32_t compressedCount = 0;
+        for (const std::filesystem::path& file : files) {
+            const auto relative = std::filesystem::relative(file, sourceDirectory).generic_u8string();
+            const std::string path = NormalizePath({ reinterpret_cast<const char*>(relative.data()), relative.size() });
+
+            CMappedFile source;
+            if (!source.Open(file, EMappedFileAccess::Sequential)) {
+                throw std::runtime_error(std::format("Failed to read \"{}\"!", file.string()));
+            }
+
+            CPackEntry entry {};
+            entry.pathHash = hash::Hash64(path);
+            entry.offset = static_cast<uint64_t>(output.tellp());
+            entry.size = source.GetSize();
+            entry.decompressedSize = source.GetSize();
+            entry.nameOffset = static_cast<uint32_t>(names.size());
+            entry.nameSize = static_cast<uint32_t>(path.size());
+            names += path;
+
+            std::vector<std::vector<std::byte>> blocks;
+            if (compress && source.GetSize() != 0) {
+                blocks = CompressBlocks(source.GetView());
+                uint64_t compressedSize = blocks.size() * sizeof(uint32_t);
+                for (const std::vector<std::byte>& block : blocks) {
+                    compressedSize += block.size();
+                }
+
+                // Decompression isn't free, small savings aren't worth it
+                if (compressedSize <= source.GetSize() - source.GetSize() / 8) {
+                    entry.size = compressedSize;
+                    entry.flags |= static_cast<uint32_t>(EPackEntryFlags::Compressed);
+                } else {
+                    blocks.clear();
+                }
+            }
+
+            if (IsCompressed(entry)) {
+                for (const std::vector<std::byte>& block : blocks) {
+                    const auto blockSize = static_cast<uint32_t>(block.size());
+                    output.write(reinterpret_cast<const char*>(&blockSize), sizeof(blockSize));
+                }
+                for (const std::vector<std::byte>& block : blocks) {
+                    output.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+                }
+                ++compressedCount;
+            } else {
+                output.write(reinterpret_cast<const char*>(source.GetData()), static_cast<std::streamsize>(source.GetSize()));
+            }
+            writePadding(PACK_ALIGNMENT);
+            dataSize += entry.decompressedSize;
+            storedSize += entry.size;
+
+            const std::size_t mask = table.size() - 1;
+            std::size_t slot = entry.pathHash & mask;
+            while (table[slot].nameSize != 0) {
+                slot = (slot + 1) & mask;
+            }
+            table[slot] = entry;
+        }
+
+        header.tableOffset = static_cast<uint64_t>(output.tellp());
+        output.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(CPackEntry)));
+        header.namesOffset = static_cast<uint64_t>(output.tellp());
+        header.namesSize = names.size();
+        output.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+        output.seekp(0);
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!output.good()) {
+            throw std::runtime_error(std::format("Failed to write pack file \"{}\"!", destination.string()));
+        }
+
+        Msg(
+            "Packed {} files ({} compressed), {} KB of data stored in {} KB, into \"{}\" ({} KB)",
+            files.size(),
+            compressedCount,
+            dataSize / 1024,
+            storedSize / 1024,
+            destination.string(),
+            (header.namesOffset + header.namesSize) / 1024
+        );
+    }
+
+    bool Mount(const std::filesystem::path& path) {
+        auto pack = std::make_shared<CPackFile>();
+        if (!pack->Open(path)) {
+            return false;
+        }
+
+        Msg("Mounted pack \"{}\" with {} files", path.string(), pack->GetEntryCount());
+        std::unique_lock lock(g_mountedPacksMutex);
+        g_mountedPacks.push_back(std::move(pack));
+        return true;
+    }
+
+    CMappedFile MapMounted(const std::string_view filename, const EMappedFileAccess access) {
+        const auto [pack, entry] = FindMounted(filename);
+        if (!pack) {
+            return {};
+        }
+        return pack->Map(filename, access);
+    }
+
+    std::optional<uint64_t> GetMountedSize(const std::string_view filename) {
+        const auto [pack, entry] = FindMounted(filename);
+        if (!pack) {
+            return std::nullopt;
+        }
+        return entry->decompressedSize;
+    }
+
+    bool ReadMounted(const std::string_view filename, const std::span<std::byte> destination) {
+        const auto [pack, entry] = FindMounted(filename);
+        return pack && pack->Read(*entry, destination);
+    }
+
+} // pack_file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "publicapi.hpp"
+#include "mappedfile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Pack file layout:
+//   CPackHeader, padded to PACK_ALIGNMENT
+//   entry data, every entry starts at a multiple of PACK_ALIGNMENT
+//   table of contents, an open addressing hash table of CPackEntry with a power of two size
+//   names of all entries, UTF-8 without terminators
+// Entries are page aligned, so every one of them can be advised, prefetched or read with direct I/O on its own.
+//
+// Compressed entries start with the uint32_t compressed size of every PACK_BLOCK_SIZE block, followed by
+// the blocks. A block as large as its decompressed size is stored as is.
+constexpr uint32_t PACK_FILE_MAGIC = 0x4B50'4B53; // "SKPK"
+constexpr uint32_t PACK_FILE_VERSION = 2;
+constexpr uint64_t PACK_ALIGNMENT = 4096;
+// Decompressed size of a block, the last one of an entry may be shorter
+constexpr uint64_t PACK_BLOCK_SIZE = 64 * 1024;
+
+enum class EPackEntryFlags : uint32_t
+{
+    None = 0,
+    // Blocks compressed with compression::CompressBlock
+    Compressed = 1 << 0,
+};
+
+struct CPackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    // Number of table slots, a power of two
+    uint32_t tableSize;
+    uint64_t tableOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+struct CPackEntry
+{
+    // Hash64 of the normalized path
+    uint64_t pathHash;
+    uint64_t offset;
+    // Bytes stored in the pack
+    uint64_t size;
+    uint64_t decompressedSize;
+    uint32_t flags;
+    uint32_t nameOffset;
+    // Zero marks an empty slot
+    uint32_t nameSize;
+    uint32_t padding;
+};
+
+static_assert(sizeof(CPackHeader) == 40);
+static_assert(sizeof(CPackEntry) == 48);
+
+// Read-only archive of files addressed by their path relative to the application's root
+class PLATFORM_CLASS CPackFile
+{
+public:
+    // Returns false if the file is missing, corrupted or built by another version
+    bool Open(const std::filesystem::path& path);
+
+    // nullptr if the pack doesn't contain the file
+    [[nodiscard]] const CPackEntry* Find(std::string_view filename) const;
+
+    // View of an entry that shares the mapping of the pack, compressed entries are decompressed into
+    // anonymous memory. Not open if the pack doesn't contain the file or it is corrupted.
+    [[nodiscard]] CMappedFile Map(std::string_view filename, EMappedFileAccess access) const;
+
+    // Decompresses an entry straight into `destination`, e.g. a mapped staging buffer, spreading blocks
+    // over ThreadPool(). `destination` must be entry.decompressedSize bytes. Returns false if the entry is corrupted.
+    bool Read(const CPackEntry& entry, std::span<std::byte> destination) const;
+
+    [[nodiscard]] uint32_t GetEntryCount() const { return m_header.entryCount; }
+
+private:
+    std::shared_ptr<const CMappedFile> m_file;
+    CPackHeader m_header {};
+    std::span<const CPackEntry> m_table;
+    std::string_view m_names;
+};
+
+namespace pack_file {
+
+    // Forward slashes, no leading "./" or "/", the form paths are hashed and stored in
+    PLATFORM_CLASS std::string NormalizePath(std::string_view filename);
+
+    // Packs every file under `sourceDirectory`, named by its path relative to it. Files are compressed
+    // when it saves at least an eighth of their size.
+    PLATFORM_CLASS void Build(
+        const std::filesystem::path& sourceDirectory,
+        const std::filesystem::path& destination,
+        bool compress = true
+    );
+
+    // Packs mounted later take precedence, so a patch can override files of the packs before it.
+    // Returns false if the pack can't be opened.
+    PLATFORM_CLASS bool Mount(const std::filesystem::path& path);
+
+    // Looks through the mounted packs. Not open if none of them contains the file.
+    PLATFORM_CLASS CMappedFile MapMounted(std::string_view filename, EMappedFileAccess access);
+
+    // Decompressed size of a file in the mounted packs, nullopt if none of them contains it
+    PLATFORM_CLASS std::optional<uint64_t> GetMountedSize(std::string_view filename);
+
+    // See CPackFile::Read. Returns false if no mounted pack contains the file, its size differs or it is corrupted.
+    PLATFORM_CLASS bool ReadMounted(std::string_view filename, std::span<std::byte> destination);
+
+} // pack_file
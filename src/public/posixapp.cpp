@@ -1,15 +1,20 @@
-#ifdef PLATFORM_POSIX
+#ifdef PLATFORM_LINUX
+    #include <algorithm>
+    #include <cstring>
+    #include <optional>
+    #include <span>
     #include <vector>
     #include <fstream>
     #include <filesystem>
+    #include <string>
     #include <string_view>
 
     #include "resourceloader.hpp"
-    #include "platform.hpp"
+    #include "packfile.hpp"
 
 namespace resource_loader {
 
-std::vector<char> ReadFile(const std::string_view filename) {
+const std::filesystem::path& GetRootDir() {
     static std::filesystem::path rootDir;
 
     if (rootDir.empty()) {
@@ -17,7 +22,19 @@ std::vector<char> ReadFile(const std::string_view filename) {
         rootDir.remove_filename();
     }
 
-    std::ifstream file(rootDir.string() + filename.data(), std::ios::ate | std::ios::binary);
+    return rootDir;
+}
+
+std::vector<char> ReadFile(const std::string_view filename) {
+    if (const std::optional<uint64_t> packedSize = pack_file::GetMountedSize(filename)) {
+        std::vector<char> buffer(*packedSize);
+        if (!pack_file::ReadMounted(filename, std::as_writable_bytes(std::span(buffer)))) {
+            return {};
+        }
+        return buffer;
+    }
+
+    std::ifstream file(GetRootDir().string() + std::string(filename), std::ios::ate | std::ios::binary);
 
     if (!file.is_open()) {
         file.close();
@@ -32,6 +49,56 @@ std::vector<char> ReadFile(const std::string_view filename) {
     return buffer;
 }
 
+std::optional<std::size_t> GetFileSize(const std::string_view filename) {
+    if (const std::optional<uint64_t> packedSize = pack_file::GetMountedSize(filename)) {
+        return *packedSize;
+    }
+
+    std::error_code error;
+    const std::uintmax_t size = std::filesystem::file_size(GetRootDir().string() + std::string(filename), error);
+    if (error) {
+        return std::nullopt;
+    }
+    return size;
+}
+
+bool ReadFile(const std::string_view filename, const std::span<std::byte> destination) {
+    if (pack_file::GetMountedSize(filename)) {
+        return pack_file::ReadMounted(filename, destination);
+    }
+
+    const CMappedFile file = MapFile(filename, EMappedFileAccess::Sequential);
+    if (!file.IsOpen() || file.GetSize() != destination.size()) {
+        return false;
+    }
+    if (!destination.empty()) {
+        std::memcpy(destination.data(), file.GetData(), destination.size());
+    }
+    return true;
+}
+
+CMappedFile MapFile(const std::string_view filename, const EMappedFileAccess access) {
+    if (CMappedFile packed = pack_file::MapMounted(filename, access); packed.IsOpen()) {
+        return packed;
+    }
+
+    CMappedFile file;
+    file.Open(GetRootDir().string() + std::string(filename), access);
+    return file;
+}
+
+std::size_t MountPacks() {
+    std::vector<std::filesystem::path> packs;
+    for (const auto& item : std::filesystem::directory_iterator(GetRootDir())) {
+        if (item.is_regular_file() && item.path().extension() == ".pack") {
+            packs.push_back(item.path());
+        }
+    }
+    std::ranges::sort(packs);
+
+    return std::ranges::count_if(packs, [](const std::filesystem::path& pack) { return pack_file::Mount(pack); });
+}
+
 } // resource_loader
 
 #else
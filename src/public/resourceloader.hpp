@@ -1,12 +1,42 @@
 #pragma once
 #include "publicapi.hpp"
+#include "mappedfile.hpp"
 
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
 #include <vector>
 #include <string_view>
 
 namespace resource_loader {
 
+    // Directory of the executable, loose files are looked up relative to it
+    PLATFORM_CLASS const std::filesystem::path& GetRootDir();
+
+    // Mounted packs are searched first, then the file is read from disk
     // \param filename UTF-8 encoded path to file from the application's root
     PLATFORM_CLASS std::vector<char> ReadFile(std::string_view filename);
 
+    // Size ReadFile would return, nullopt if the file doesn't exist
+    // \param filename UTF-8 encoded path to file from the application's root
+    PLATFORM_CLASS std::optional<std::size_t> GetFileSize(std::string_view filename);
+
+    // Reads straight into caller memory, e.g. a mapped staging buffer. Compressed packed files are
+    // decompressed into it on ThreadPool(). Returns false unless the file exists and is destination.size() bytes.
+    // \param filename UTF-8 encoded path to file from the application's root
+    PLATFORM_CLASS bool ReadFile(std::string_view filename, std::span<std::byte> destination);
+
+    // Same lookup as ReadFile, but maps the file instead of copying it, the view stays valid while the returned file is alive.
+    // The result is not open if the file doesn't exist or can't be mapped.
+    // \param filename UTF-8 encoded path to file from the application's root
+    PLATFORM_CLASS CMappedFile MapFile(
+        std::string_view filename,
+        EMappedFileAccess access = EMappedFileAccess::Sequential
+    );
+
+    // Mounts every *.pack file in the application's root in name order, see pack_file::Mount.
+    // Returns the number of mounted packs.
+    PLATFORM_CLASS std::size_t MountPacks();
+
 } // resource_loader
@@ -0,0 +1,83 @@
+#include "threadpool.hpp"
+
+#include <deque>
+#include <thread>
+#include <vector>
+
+class CThreadPool final : public IThreadPool
+{
+public:
+    explicit CThreadPool(std::size_t threadCount);
+    CThreadPool(const CThreadPool&) = delete;
+    CThreadPool(CThreadPool&&) = delete;
+    CThreadPool& operator=(const CThreadPool&) = delete;
+    CThreadPool& operator=(CThreadPool&&) = delete;
+    ~CThreadPool() override;
+
+    void Enqueue(std::function<void()> task) override;
+    [[nodiscard]] std::size_t GetThreadCount() const override { return m_threads.size(); }
+
+private:
+    void _WorkerMain();
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop = false;
+};
+
+PLATFORM_INTERFACE IThreadPool* ThreadPool() {
+    // The calling thread always helps in ParallelFor, so leave one hardware thread for it
+    static CThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return &pool;
+}
+
+CThreadPool::CThreadPool(const std::size_t threadCount) {
+    m_threads.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&CThreadPool::_WorkerMain, this);
+    }
+}
+
+CThreadPool::~CThreadPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void CThreadPool::Enqueue(std::function<void()> task) {
+    // Without workers the task still has to run somewhere
+    if (m_threads.empty()) {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void CThreadPool::_WorkerMain() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+            if (m_stop && m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
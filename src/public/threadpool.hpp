@@ -0,0 +1,99 @@
+#pragma once
+
+#include "publicapi.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+class IThreadPool
+{
+public:
+    IThreadPool() = default;
+    IThreadPool(const IThreadPool&) = delete;
+    IThreadPool(IThreadPool&&) = delete;
+    IThreadPool& operator=(const IThreadPool&) = delete;
+    IThreadPool& operator=(IThreadPool&&) = delete;
+    virtual ~IThreadPool() = default;
+
+    virtual void Enqueue(std::function<void()> task) = 0;
+    [[nodiscard]] virtual std::size_t GetThreadCount() const = 0;
+
+    template <typename F>
+    auto Submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+        auto packagedTask = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(task));
+        auto future = packagedTask->get_future();
+        Enqueue([packagedTask] { (*packagedTask)(); });
+        return future;
+    }
+
+    // Runs body(i) for every i in [0, count) on the workers and the calling thread.
+    // Returns when all iterations are done and rethrows the first exception thrown by body.
+    template <typename F>
+    void ParallelFor(std::size_t count, F&& body);
+};
+
+template <typename F>
+void IThreadPool::ParallelFor(const std::size_t count, F&& body) {
+    if (count == 0) {
+        return;
+    }
+
+    struct CState
+    {
+        std::atomic<std::size_t> next = 0;
+        std::size_t completed = 0;
+        std::exception_ptr exception;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    // Helpers that get scheduled after the loop is drained must still find valid state
+    auto state = std::make_shared<CState>();
+    auto run = [state, count, &body] {
+        std::size_t finished = 0;
+        for (std::size_t i = state->next++; i < count; i = state->next++) {
+            try {
+                body(i);
+            } catch (...) {
+                std::lock_guard lock(state->mutex);
+                if (!state->exception) {
+                    state->exception = std::current_exception();
+                }
+            }
+            ++finished;
+        }
+
+        if (finished != 0) {
+            std::lock_guard lock(state->mutex);
+            state->completed += finished;
+            if (state->completed == count) {
+                state->done.notify_all();
+            }
+        }
+    };
+
+    const std::size_t helperCount = std::min(GetThreadCount(), count - 1);
+    for (std::size_t i = 0; i < helperCount; ++i) {
+        Enqueue(run);
+    }
+
+    // The calling thread takes part too, so nested loops never wait on a busy pool
+    run();
+
+    std::unique_lock lock(state->mutex);
+    state->done.wait(lock, [&] { return state->completed == count; });
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+// Shared pool for CPU bound jobs, sized to the number of hardware threads
+PLATFORM_INTERFACE IThreadPool* ThreadPool();
@@ -1,7 +1,11 @@
 #ifdef PLATFORM_WINDOWS
-    #include "unicode.hpp"
-    #include "platform.hpp"
+    #include "resourceloader.hpp"
+    #include "packfile.hpp"
 
+    #include <algorithm>
+    #include <cstring>
+    #include <optional>
+    #include <span>
     #include <vector>
     #include <string_view>
     #include <filesystem>
@@ -12,7 +16,7 @@
 
 namespace resource_loader {
 
-    PLATFORM_CLASS std::vector<char> ReadFile(const std::string_view filename) {
+    PLATFORM_CLASS const std::filesystem::path& GetRootDir() {
         static std::filesystem::path rootDir;
 
         if (rootDir.empty()) {
@@ -22,8 +26,27 @@ namespace resource_loader {
             rootDir.remove_filename();
         }
 
+        return rootDir;
+    }
+
+    namespace {
+        // Going through char8_t keeps the UTF-8 filename from being read in the ANSI code page
+        std::wstring GetLoosePath(const std::string_view filename) {
+            return GetRootDir().wstring() + std::filesystem::path(std::u8string(filename.begin(), filename.end())).wstring();
+        }
+    }
+
+    PLATFORM_CLASS std::vector<char> ReadFile(const std::string_view filename) {
+        if (const std::optional<uint64_t> packedSize = pack_file::GetMountedSize(filename)) {
+            std::vector<char> buffer(*packedSize);
+            if (!pack_file::ReadMounted(filename, std::as_writable_bytes(std::span(buffer)))) {
+                return {};
+            }
+            return buffer;
+        }
+
         // todo: use boost.nowide here
-        std::ifstream file((rootDir.wstring() + widen(filename)).c_str(), std::ios::ate | std::ios::binary);
+        std::ifstream file(GetLoosePath(filename).c_str(), std::ios::ate | std::ios::binary);
 
         if (!file.is_open()) {
             file.close();
@@ -38,6 +61,56 @@ namespace resource_loader {
         return buffer;
     }
 
+    PLATFORM_CLASS std::optional<std::size_t> GetFileSize(const std::string_view filename) {
+        if (const std::optional<uint64_t> packedSize = pack_file::GetMountedSize(filename)) {
+            return *packedSize;
+        }
+
+        std::error_code error;
+        const std::uintmax_t size = std::filesystem::file_size(GetLoosePath(filename), error);
+        if (error) {
+            return std::nullopt;
+        }
+        return size;
+    }
+
+    PLATFORM_CLASS bool ReadFile(const std::string_view filename, const std::span<std::byte> destination) {
+        if (pack_file::GetMountedSize(filename)) {
+            return pack_file::ReadMounted(filename, destination);
+        }
+
+        const CMappedFile file = MapFile(filename, EMappedFileAccess::Sequential);
+        if (!file.IsOpen() || file.GetSize() != destination.size()) {
+            return false;
+        }
+        if (!destination.empty()) {
+            std::memcpy(destination.data(), file.GetData(), destination.size());
+        }
+        return true;
+    }
+
+    PLATFORM_CLASS CMappedFile MapFile(const std::string_view filename, const EMappedFileAccess access) {
+        if (CMappedFile packed = pack_file::MapMounted(filename, access); packed.IsOpen()) {
+            return packed;
+        }
+
+        CMappedFile file;
+        file.Open(GetLoosePath(filename), access);
+        return file;
+    }
+
+    PLATFORM_CLASS std::size_t MountPacks() {
+        std::vector<std::filesystem::path> packs;
+        for (const auto& item : std::filesystem::directory_iterator(GetRootDir())) {
+            if (item.is_regular_file() && item.path().extension() == L".pack") {
+                packs.push_back(item.path());
+            }
+        }
+        std::ranges::sort(packs);
+
+        return std::ranges::count_if(packs, [](const std::filesystem::path& pack) { return pack_file::Mount(pack); });
+    }
+
 } // resource_loader
 
 #else
@@ -1,12 +1,14 @@
 #version 450
 
-layout(location = 0) in vec3 fragColor;
-layout(location = 1) in vec2 fragTexCoord;
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) flat in float fragMinLod;
 
 layout(location = 0) out vec4 outColor;
 
 layout(binding = 1) uniform sampler2D texSampler;
 
 void main() {
-    outColor = vec4(fragColor* texture(texSampler, fragTexCoord).rgb, 1.0);
+    // Mips finer than fragMinLod may not be resident yet, never sample them
+    float lod = max(textureQueryLod(texSampler, fragTexCoord).x, fragMinLod);
+    outColor = vec4(textureLod(texSampler, fragTexCoord, lod).rgb, 1.0);
 }